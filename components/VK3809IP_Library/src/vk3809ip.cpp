@@ -17,358 +17,161 @@
 
 #include "vk3809ip.hpp"
 
-VK3809IP::VK3809IP() {}
+// 驱动逻辑在 vk3809ip_impl.hpp 中，函数指针版本在此实例化
+template class VK3809IPT<VKCallbackTransport>;
 
 int VK3809IP::begin(vk_com_fptr_t read_cb, vk_com_fptr_t write_cb, uint8_t addr)
 {
   if (read_cb == nullptr || write_cb == nullptr)
     return -1;
-  _read_cb = read_cb;
-  _write_cb = write_cb;
-  _address = addr;
-  return init();
+  _bus.read_cb = read_cb;
+  _bus.write_cb = write_cb;
+  return VK3809IPT::begin(addr, _busHz);
 }
 
-bool VK3809IP::init()
+/**
+ * @brief 使用带超时的读写接口初始化:
+ * 每次传输的超时由总线频率下的理论传输时间加上余量得到，避免一次卡死的传输阻塞整条总线
+ * 
+ * @param read_cb 
+ * @param write_cb 
+ * @param addr 
+ * @param bus_hz 总线频率，与 I2C_MASTER_FREQ_HZ 保持一致
+ * @return int 
+ */
+int VK3809IP::begin(vk_com_timeout_fptr_t read_cb, vk_com_timeout_fptr_t write_cb, uint8_t addr, uint32_t bus_hz)
 {
-  // Default setting commands
-  uint8_t settingDataByte1 = settingCommandsDataByte1(
-      SLIDE_APP_MODE,
-      SETING_COMMANDS,
-      SINGLE,
-      AUTO_ADJUST_ENABALE,
-      POWER_SAVE_DISABLE,
-      DYNAMIC_THRESHOLD_DISABLE,
-      AOTO_RESTET_TIME_15S
-      );
-  uint8_t settingDataByte2 = settingCommandsDataByte2(
-      KEY_NUM_0_DISABLE,
-      KEY_ACK_TIME_4
-      );
-  uint8_t settingDataByte3 = settingCommandsDataByte3(
-      SLIDE_X_NUM_DISABLE,
-      SLIDE_X_NUM_9
-      );
-  uint8_t settingDataByte4 = settingCommandsDataByte4(
-      KEY_OFF_NUM_1_DISABLE,
-      SLIDE_X_NUM_DISABLE
-      );
-  settingCommandsData(settingDataByte1, settingDataByte2, settingDataByte3, settingDataByte4);
-
-  // Default custom threshold commands
-  for (int i = TP_NUM_0; i <= TP_NUM_9; i++)
-  {
-    settingTpxThresholdData(16, (tpx_setting_number_t)i);
-  }
-  
-  // Default sleep threshold Setting
-  settingSleepThresholdData(2);
-
-  return 0;
+  if (read_cb == nullptr || write_cb == nullptr || bus_hz == 0)
+    return -1;
+  _bus.read_timeout_cb = read_cb;
+  _bus.write_timeout_cb = write_cb;
+  return VK3809IPT::begin(addr, bus_hz);
 }
 
+#if VK3809IP_LAYOUT
 /**************************************************************************/
 /*!
-    @brief The VK3809IP write function.
+    @brief The VK3809IP layout function.
 */
 /**************************************************************************/
 
-uint8_t VK3809IP::settingCommandsDataByte1(
-    i2c_data_mode_t i2c_data_mode_slide,
-    custom_threshold_t custom_threshold_set,
-    key_output_mode_t key_output_mode,
-    aoto_adjust_en_t aoto_adjust,
-    power_save_mode_en_t power_save_mode,
-    dynamic_threshold_en_t dynamic_threshold,
-    aoto_reset_time_t aoto_reset_time)
-{
-  uint8_t setbyte1 = 0B00000000;
-
-  // 设置 setbyte1 命令
-  setbyte1 |= (i2c_data_mode_slide << 7);     // bit 7
-  setbyte1 |= (custom_threshold_set << 6);  // bit 6
-  setbyte1 |= (key_output_mode << 5);   // bit 5
-  setbyte1 |= (aoto_adjust << 4);       // bit 4
-  setbyte1 |= (power_save_mode << 3);   // bit 3
-  setbyte1 |= (dynamic_threshold << 2); // bit 2
-  setbyte1 |= aoto_reset_time;          // bit 1-0
-
-  return setbyte1;
-}
-uint8_t VK3809IP::settingCommandsDataByte2(
-    key_number_t key_number,
-    key_acknowledge_times_t key_acknowledge_times)
-{
-  uint8_t setbyte2 = 0B00000000;
-
-  // 设置 setbyte2 命令
-  setbyte2 |= (key_number << 3);            // bit 7-3
-  setbyte2 |= key_acknowledge_times;        // bit 2-0
-
-  return setbyte2;
-}
-uint8_t VK3809IP::settingCommandsDataByte3(
-        slide_x_number_t  slide_2_number,
-        slide_x_number_t slide_1_number)
+VK3809IPLayout::VK3809IPLayout()
 {
-  uint8_t setbyte3 = 0B00000000;
-
-  // 设置 setbyte3 命令
-  setbyte3 |= (slide_2_number << 4);            // bit 7-4
-  setbyte3 |= slide_1_number;             // bit 3-0
-
-  return setbyte3;
+  configure(SLIDE_X_NUM_9, SLIDE_X_NUM_DISABLE, SLIDE_X_NUM_DISABLE, KEY_NUM_0_DISABLE);
 }
-uint8_t VK3809IP::settingCommandsDataByte4(
-    key_off_number_t  key_off_number,
-    slide_x_number_t slide_3_number)
-{
-  uint8_t setbyte4 = 0B00000000;
-
-  // 设置 setbyte4 命令
-  setbyte4 |= (key_off_number << 4);            // bit 7-4
-  setbyte4 |= slide_3_number; // bit 3-0
 
-  return setbyte4;
-}
 /**
- * @brief 应用模式命令设置
+ * @brief 按配置划分TP脚位:
+ * 滑条按键按 Slide1、Slide2、Slide3 的顺序依次占用TP0开始的脚位，剩余脚位从Key 1开始
+ * 依次作为普通按键，普通按键数不超过 9 减去滑条按键数
  * 
- * @param DataByte1 
- * @param DataByte2 
- * @param DataByte3 
- * @param DataByte4 
- * @return true 
- * @return false 
+ * @param slide_1_number 
+ * @param slide_2_number 
+ * @param slide_3_number 
+ * @param key_number 
  */
-bool VK3809IP::settingCommandsData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4)
+void VK3809IPLayout::configure(slide_x_number_t slide_1_number, slide_x_number_t slide_2_number,
+                               slide_x_number_t slide_3_number, key_number_t key_number)
 {
-  return writeFourByteData(DataByte1, DataByte2, DataByte3, DataByte4);
-}
+  const slide_x_number_t slides[3] = {slide_1_number, slide_2_number, slide_3_number};
+  uint8_t tp = 0;
 
-/**
- * @brief 按键阈值设定:
- * 按键承认阀值越小灵敏度越高，越大灵敏度越低。预设的阀值为010H，建议的最小值为008H，若
- * 调整到008H按键灵敏度仍然不够，则建议加大CS电容，CS电容的值则建议小于39nF
- * 
- * @param thresholdValue 按键承认阀值(Define : 010H) 
- * @param tpNum 按键键值
- * @return true 
- * @return false 
- */
-bool VK3809IP::settingTpxThresholdData(uint16_t thresholdValue, tpx_setting_number_t tpNum)
-{
-    // 确保 thresholdValue 是三位十进制数的范围
-    if (thresholdValue <= 8) {
-        thresholdValue = 8;
-    }else if(thresholdValue >= 999) {
-        thresholdValue = 999;
+  memset(_tpMap, 0, sizeof(_tpMap));
+  _sliderMask = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    // SLIDE_X_NUM_3 = 0B0010，编码值加1为滑条按键数
+    uint8_t keys = (slides[i] >= SLIDE_X_NUM_3) ? (uint8_t)(slides[i] + 1) : 0;
+    if (keys > 9 - tp)
+    {
+      keys = 9 - tp;
     }
-
-    // 将 thresholdValue 转换为12位二进制字符串
-    char binary_12bit[13]; // 12位二进制 + 结束符 '\0'
-    int num = thresholdValue;
-    for (int i = 11; i >= 0; --i) {
-        binary_12bit[i] = (num & 1) ? '1' : '0';
-        num >>= 1;
+    if (keys < 3)
+    {
+      keys = 0;
     }
-    binary_12bit[12] = '\0'; // 添加字符串结束符
-
-    // 拆分为 h, m, l 三部分
-    char l[5], m[5], h[5];
-    strncpy(l, binary_12bit, 4); l[4] = '\0';
-    strncpy(m, binary_12bit + 4, 4); m[4] = '\0';
-    strncpy(h, binary_12bit + 8, 4); h[4] = '\0';
+    _sliderKeys[i] = keys;
+    _sliderFirstTp[i] = tp;
+    for (uint8_t seg = 0; seg < keys; seg++, tp++)
+    {
+      _tpMap[tp].role = VK_TP_SLIDER;
+      _tpMap[tp].index = i;
+      _tpMap[tp].segment = seg + 1;
+    }
+    _sliderMask |= (keys != 0) << i;
+  }
 
-    // 构造 byte2 和 byte3
-    uint8_t data[3];
-    data[0] = tpNum;
-    data[1] = (uint8_t)(strtol(m, NULL, 2) << 4 | strtol(l, NULL, 2));
-    data[2] = (uint8_t)(strtol(h, NULL, 2) << 4);
-    writeThreeByteData(data[0], data[1], data[2]);
-    return VK_PASS;
+  _keyFirstTp = tp;
+  _keyCount = (key_number > 9 - tp) ? (uint8_t)(9 - tp) : (uint8_t)key_number;
+  for (uint8_t k = 0; k < _keyCount; k++)
+  {
+    _tpMap[tp + k].role = VK_TP_KEY;
+    _tpMap[tp + k].index = k;
+    _tpMap[tp + k].segment = 0;
+  }
+  _keyMask = (uint16_t)((1 << _keyCount) - 1);
 }
-
 /**
- * @brief 睡眠唤醒阀值设定
+ * @brief 由应用设定的 Byte2~Byte4 推出布局
  * 
- * @param thresholdValue 省电模式唤醒阀值(Define : 002H) 
- * @return true 
- * @return false 
+ * @param DataByte2 
+ * @param DataByte3 
+ * @param DataByte4 
  */
-bool VK3809IP::settingSleepThresholdData(uint16_t thresholdValue)
+void VK3809IPLayout::configure(uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4)
 {
-    if (thresholdValue <= 0) {
-        thresholdValue = 0;
-    }else if(thresholdValue >= 999) {
-        thresholdValue = 999;
-    }
-
-    char binary_12bit[13];
-    int num = thresholdValue;
-    for (int i = 11; i >= 0; --i) {
-        binary_12bit[i] = (num & 1) ? '1' : '0';
-        num >>= 1;
-    }
-    binary_12bit[12] = '\0';
-
-    char l[5], m[5], h[5];
-    strncpy(l, binary_12bit, 4); l[4] = '\0';
-    strncpy(m, binary_12bit + 4, 4); m[4] = '\0';
-    strncpy(h, binary_12bit + 8, 4); h[4] = '\0';
-
-    uint8_t data[3];
-    data[0] = 0xD0;
-    data[1] = (uint8_t)(strtol(m, NULL, 2) << 4 | strtol(l, NULL, 2));
-    data[2] = (uint8_t)(strtol(h, NULL, 2) << 4);
-    writeThreeByteData(data[0], data[1], data[2]);
-    return VK_PASS;
+  configure((slide_x_number_t)(DataByte3 & 0x0F),
+            (slide_x_number_t)(DataByte3 >> 4),
+            (slide_x_number_t)(DataByte4 & 0x0F),
+            (key_number_t)(DataByte2 >> 3));
 }
 
-/**************************************************************************/
-/*!
-    @brief The VK3809IP read function.
-*/
-/**************************************************************************/
-
-/**
- * @brief 系统校正标志:
- * 当值为0时，表示系统校正中，键值读取无效。当值为1时，键值有效。
- * @return true 
- * @return false 
- */
-bool VK3809IP::getSystemCorrectionFlagState()
-{
-  uint8_t data[6];
-  _readByte(sizeof(data), data);
-  return (bool)extractBits(data[0], 7, 1);
-}
-/**
- * @brief 系统写入标志:
- * 上电为1，写入设定后该标志设置为0。
- * @return true 
- * @return false 
- */
-bool VK3809IP::getSystemWriteFlagState()
-{
-  uint8_t data[6];
-  _readByte(sizeof(data), data);
-  return (bool)extractBits(data[0], 6, 1);
-}
-/**
- * @brief 滑条触摸标志:
- * 无触摸时为0，有触摸时为1
- * @param sliderNum 
- * @return true 
- * @return false 
- */
-bool VK3809IP::getSliderPressedState(slider_x_touch_state_t sliderNum)
-{
-  uint8_t data[6];
-  _readByte(sizeof(data), data);
-  return (bool)extractBits(data[0], sliderNum, 1);
-}
-/**
- * @brief 触摸按键标志:
- * 无按键为0，有按键为1
- * @param keyNum 
- * @return true 
- * @return false 
- */
-bool VK3809IP::getKeyPressedState(key_number_t keyNum)
-{
-  uint8_t data[6];
-  _readByte(sizeof(data), data);
-  // return (bool)extractBits(data[1], keyNum - 1, 1);
-  return (keyNum == KEY_NUM_9) ? ((bool)extractBits(data[2], 0, 1)) : ((bool)extractBits(data[1], keyNum - 1, 1));
-}
 /**
- * @brief 滑条位置标志:
- * 预设为0，触摸滑条后输出按键位置，放开后保留最后按压位置
- * @param position 
- * @return uint16_t 
- */
-uint16_t VK3809IP::getSliderData(slider_x_position_t position)
-{
-  uint8_t data[6];
-  _readByte(sizeof(data), data);
-  return data[position];
-}
-/**
- * @brief byte转换成bit
- * 调试时候用的
- * @param byte 
- */
-void VK3809IP::print_byte_as_binary(uint8_t byte) {
-    for (int i = 7; i >= 0; i--) {
-        printf("%c", (byte & (1 << i)) ? '1' : '0');
-    }
-}
-/**
- * @brief 读寄存器的所有值:
- * delete[] data; // 记得在使用完毕后释放动态分配的内存
- * @return uint8_t* 
+ * @brief 解码一帧:
+ * Byte0 bit0~bit2 为滑条触摸标志，Byte1 bit0~bit7 为Key1~Key8，Byte2 bit0 为Key9，
+ * Byte3~Byte5 为 Slide1~Slide3 位置。未启用的控件用掩码清零，不需要逐个判断
+ * 
+ * @param frame 6字节状态帧
+ * @param state 
  */
-uint8_t* VK3809IP::getAllData()
+void VK3809IPLayout::decode(const uint8_t *frame, vk_touch_state_t *state) const
 {
-  // uint8_t data[6];
-  uint8_t* data = new uint8_t[6]; // 动态分配 6 个字节的空间
-  _readByte(sizeof(data), data);
-  return data;
+  state->slider_touch = frame[0] & _sliderMask;
+  state->key_mask = (uint16_t)(frame[1] | ((frame[2] & 0x01) << 8)) & _keyMask;
+  state->slider_position[0] = frame[SLIDE_1_POSITION] & -(uint8_t)(_sliderMask & 0x01);
+  state->slider_position[1] = frame[SLIDE_2_POSITION] & -(uint8_t)((_sliderMask >> 1) & 0x01);
+  state->slider_position[2] = frame[SLIDE_3_POSITION] & -(uint8_t)((_sliderMask >> 2) & 0x01);
 }
 
-/**************************************************************************/
-/*!
-    @brief The VK3809IP port function.
-*/
-/**************************************************************************/
-
 /**
- * @brief 从一个字节中截取指定的位段
+ * @brief 查询滑条某一段对应的物理TP脚位
  * 
- * @param byte 要截取的字节
- * @param start_bit 目标开始位
- * @param num_bits 截取位数
- * @return uint8_t 
+ * @param sliderIndex 滑条序号(0~2)
+ * @param segment 滑条内第几个按键(1起)
+ * @return int TP脚位，未启用时返回-1
  */
-uint8_t VK3809IP::extractBits(uint8_t byte, int startBit, int numBits) {
-    // 计算掩码
-    uint8_t mask = (1 << numBits) - 1; // 生成指定长度的全1掩码
-    mask <<= startBit;                 // 将掩码移到起始位
-    // 使用掩码提取位段并右移到最低位
-    return (uint8_t)((byte & mask) >> startBit);
-}
-
-bool VK3809IP::writeThreeByteData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3)
-{
-  uint8_t settingData[] = {DataByte1, DataByte2, DataByte3};
-  _writeByte(sizeof(settingData), settingData);
-  return VK_PASS;
-}
-bool VK3809IP::writeFourByteData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4)
+int VK3809IPLayout::getSliderTp(uint8_t sliderIndex, uint8_t segment) const
 {
-  uint8_t settingData[] = {DataByte1, DataByte2, DataByte3, DataByte4};
-  _writeByte(sizeof(settingData), settingData);
-  return VK_PASS;
-}
-
-int VK3809IP::_readByte(uint8_t nbytes, uint8_t *data)
-{
-  if (_read_cb != nullptr)
+  if (sliderIndex >= 3 || segment == 0 || segment > _sliderKeys[sliderIndex])
   {
-    return _read_cb(_address, REG_ADDR_NONE, data, nbytes);
+    return -1;
   }
-
-  return 0;
+  return _sliderFirstTp[sliderIndex] + segment - 1;
 }
-int VK3809IP::_writeByte(uint8_t nbytes, uint8_t *data)
+/**
+ * @brief 查询普通按键对应的物理TP脚位
+ * 
+ * @param keyIndex 按键序号(0起，对应Key 1)
+ * @return int TP脚位，未启用时返回-1
+ */
+int VK3809IPLayout::getKeyTp(uint8_t keyIndex) const
 {
-  if (_write_cb != nullptr)
+  if (keyIndex >= _keyCount)
   {
-    return _write_cb(_address, REG_ADDR_NONE, data, nbytes);
+    return -1;
   }
-
-  return 0;
+  return _keyFirstTp + keyIndex;
 }
+#endif
 
 VK3809IP slider;
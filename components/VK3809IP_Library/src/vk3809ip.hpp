@@ -17,6 +17,60 @@
 #include <stdint.h>
 #include <string.h>
 #include <cstdio>
+#include <utility>
+#endif
+
+#include "vk3809ip_transport.hpp"
+
+#if defined(ESP_PLATFORM) && __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+
+/*
+    ! 驱动核心的可选功能，menuconfig 中默认全部关闭，此时只保留与原驱动相同的接口。
+    ! 没有 sdkconfig 的主机构建默认全部打开，可以用 -DVK3809IP_xxx=0 单独关闭。
+*/
+#ifndef VK3809IP_RECOVERY
+#if defined(CONFIG_VK3809IP_RECOVERY) || !defined(ESP_PLATFORM)
+#define VK3809IP_RECOVERY 1     // 意外重置检测、配置重写与重试
+#else
+#define VK3809IP_RECOVERY 0
+#endif
+#endif
+#ifndef VK3809IP_PROFILE
+#if defined(CONFIG_VK3809IP_PROFILE) || !defined(ESP_PLATFORM)
+#define VK3809IP_PROFILE 1      // 运行环境配置与差量切换，依赖 VK3809IP_RECOVERY 确认切换完成
+#else
+#define VK3809IP_PROFILE 0
+#endif
+#endif
+#ifndef VK3809IP_LAYOUT
+#if defined(CONFIG_VK3809IP_LAYOUT) || !defined(ESP_PLATFORM)
+#define VK3809IP_LAYOUT 1       // 布局解码与 getTouchState()
+#else
+#define VK3809IP_LAYOUT 0
+#endif
+#endif
+#ifndef VK3809IP_KEYMASK
+#if defined(CONFIG_VK3809IP_KEYMASK) || !defined(ESP_PLATFORM)
+#define VK3809IP_KEYMASK 1      // 按键掩码与按下/松开跟踪，依赖 VK3809IP_LAYOUT
+#else
+#define VK3809IP_KEYMASK 0
+#endif
+#endif
+#ifndef VK3809IP_DEVICE
+#if defined(CONFIG_VK3809IP_DEVICE) || !defined(ESP_PLATFORM)
+#define VK3809IP_DEVICE 1       // 模块使用的 VK3809IPDevice 虚接口，依赖 VK3809IP_LAYOUT
+#else
+#define VK3809IP_DEVICE 0
+#endif
+#endif
+
+#if VK3809IP_PROFILE && !VK3809IP_RECOVERY
+#error "VK3809IP_PROFILE requires VK3809IP_RECOVERY"
+#endif
+#if (VK3809IP_KEYMASK || VK3809IP_DEVICE) && !VK3809IP_LAYOUT
+#error "VK3809IP_KEYMASK and VK3809IP_DEVICE require VK3809IP_LAYOUT"
 #endif
 
 #ifdef __cplusplus
@@ -39,6 +93,17 @@ extern "C"
 #define VK_PASS 1
 #define VK_FAIL 0
 
+#define VK3809IP_FRAME_LEN 6            // 滑条应用模式状态帧长度 Byte0~Byte5
+#define VK3809IP_TP_NUM 10              // 阈值设定 TP0~TP9
+#define VK3809IP_DEFAULT_THRESHOLD 16   // 芯片出厂按键阈值 010H
+#define VK3809IP_DEFAULT_SLEEP_THRESHOLD 2 // 芯片出厂唤醒阈值 002H
+#define VK3809IP_REAPPLY_RETRIES 3      // 重置恢复时配置未生效的最多重写次数
+#define VK3809IP_REAPPLY_SETTLE 8       // 重写后未看到校正过程时，连续多少帧仍有写入标志才重写
+
+#define VK3809IP_DEFAULT_BUS_HZ 400000          // 未指定总线频率时按400kHz估算传输时间
+#define VK3809IP_READ_SLACK_US 2000             // 状态帧读取的超时余量
+#define VK3809IP_WRITE_SLACK_US 5000            // 配置包写入的超时余量
+
 /**
  * @brief IIC 数据模式选择：
  * 默认使用 `SLIDE_APP_MODE`
@@ -220,22 +285,158 @@ typedef enum{
 }slider_x_touch_state_t;
 
 /**
- * @brief I2C读写函数指针接口，对接相应芯片开发平台的I2C读写函数
+ * @brief TP脚位在当前配置下的用途
+ * 
+ */
+typedef enum{
+    VK_TP_UNUSED,
+    VK_TP_SLIDER,
+    VK_TP_KEY,
+}vk_tp_role_t;
+/**
+ * @brief TP脚位映射:
+ * role 为 `VK_TP_SLIDER` 时 index 为滑条序号(0~2)，segment 为滑条内的第几个按键(1起)；
+ * role 为 `VK_TP_KEY` 时 index 为普通按键序号(0起，对应Key 1)
+ */
+typedef struct{
+    uint8_t role;
+    uint8_t index;
+    uint8_t segment;
+}vk_tp_map_t;
+/**
+ * @brief 一帧解码后的全部滑条与按键状态
  * 
  */
-typedef uint32_t (*vk_com_fptr_t)(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len); //! 类型错误：int
+typedef struct{
+    uint32_t timestamp;             // 读取该帧时的时间(us)，未设置时间源时为0
+    uint8_t slider_touch;           // bit0~bit2 对应 Slide1~Slide3 触摸标志
+    uint8_t slider_position[3];     // Slide1~Slide3 位置，未启用的滑条为0
+    uint16_t key_mask;              // bit0~bit8 对应 Key1~Key9
+}vk_touch_state_t;
+
+/**
+ * @brief 运行环境配置(正常/戴手套/潮湿等):
+ * 由 VK3809IP::buildProfile() 预先生成全部配置包，切换时只写入与当前配置不同的包
+ */
+typedef struct{
+    const char *name;
+    uint8_t setting[4];                             // 应用设定 Byte1~Byte4
+    uint16_t threshold[VK3809IP_TP_NUM];            // TP0~TP9 按键阈值
+    uint16_t sleep_threshold;                       // 唤醒阈值
+    uint8_t threshold_packet[VK3809IP_TP_NUM][3];   // 预先编码的阈值包
+    uint8_t sleep_packet[3];                        // 预先编码的唤醒阈值包
+}vk_profile_t;
+
+/**
+ * @brief 按键掩码工具:
+ * 掩码 bit0~bit8 对应 Key1~Key9，VK_KEY_BIT(KEY_NUM_1) 为 Key1 的位
+ */
+#define VK_KEY_BIT(keyNum) ((uint16_t)(1U << ((keyNum) - 1)))
+#define VK_KEY_MASK_ALL 0x01FF
+/**
+ * @brief 取出最低位被置位的按键并清除该位，用于遍历掩码:
+ * while ((key = vk_mask_next(&mask)) >= 0) { ... }
+ * @return int 按键序号(0起，对应Key 1)，没有置位时返回-1
+ */
+static inline int vk_mask_next(uint16_t *mask)
+{
+    if (*mask == 0)
+    {
+        return -1;
+    }
+    int index = __builtin_ctz(*mask);
+    *mask &= (uint16_t)(*mask - 1);
+    return index;
+}
+/**
+ * @brief 掩码中被置位的按键数
+ */
+static inline int vk_mask_count(uint16_t mask)
+{
+    return __builtin_popcount(mask);
+}
+/**
+ * @brief 组合键判断:当前按下的按键恰好为 chord 中的按键
+ */
+static inline bool vk_mask_is_chord(uint16_t mask, uint16_t chord)
+{
+    return chord != 0 && mask == chord;
+}
+/**
+ * @brief 组合键判断:chord 中的按键全部按下(允许同时按下其它按键)
+ */
+static inline bool vk_mask_has_chord(uint16_t mask, uint16_t chord)
+{
+    return chord != 0 && (mask & chord) == chord;
+}
+
+/**
+ * @brief 时间源函数指针接口，返回单调递增的微秒计数(允许32位回绕)
+ * ESP-IDF下可以对接 esp_timer_get_time()
+ */
+typedef uint32_t (*vk_time_fptr_t)(void);
+/**
+ * @brief 芯片意外重置回调:
+ * 检测到写入标志重新置1(自动重置时间到、ESD、掉电)时调用，reset_count为累计重置次数
+ */
+typedef void (*vk_reset_cb_t)(uint32_t reset_count, void *arg);
+
+/**************************************************************************/
+/*!
+    @brief 按键与滑条布局:
+    由滑条按键数与普通按键数推出每个TP脚位的用途，一次解码出整帧状态。
+*/
+/**************************************************************************/
+#if VK3809IP_LAYOUT
+class VK3809IPLayout
+{
+public:
+    VK3809IPLayout(void);
+
+    void configure(slide_x_number_t slide_1_number, slide_x_number_t slide_2_number,
+                   slide_x_number_t slide_3_number, key_number_t key_number);
+    void configure(uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4);
+
+    void decode(const uint8_t *frame, vk_touch_state_t *state) const;
+
+    uint8_t getSliderMask() const { return _sliderMask; }
+    uint16_t getKeyMask() const { return _keyMask; }
+    uint8_t getSliderKeyCount(uint8_t sliderIndex) const { return (sliderIndex < 3) ? _sliderKeys[sliderIndex] : 0; }
+    uint8_t getKeyCount() const { return _keyCount; }
+
+    const vk_tp_map_t &getTpMap(uint8_t tp) const { return _tpMap[(tp < 9) ? tp : 0]; }
+    int getSliderTp(uint8_t sliderIndex, uint8_t segment) const;
+    int getKeyTp(uint8_t keyIndex) const;
+
+private:
+    vk_tp_map_t _tpMap[9];
+    uint8_t _sliderKeys[3];
+    uint8_t _sliderFirstTp[3];
+    uint8_t _keyFirstTp;
+    uint8_t _keyCount;
+    uint8_t _sliderMask;
+    uint16_t _keyMask;
+};
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 /**************************************************************************/
 /*!
     @brief The VK3809IP driver class.
+    Transport 为编译期绑定的总线传输策略(见 vk3809ip_transport.hpp)，读写调用可以直接内联。
 */
 /**************************************************************************/
-class VK3809IP
+template <class Transport>
+class VK3809IPT
 {
 public:
-    VK3809IP(void);
+    constexpr explicit VK3809IPT(Transport bus = Transport());
 
-    int begin(vk_com_fptr_t read_cb, vk_com_fptr_t write_cb, uint8_t addr = VK3809IP_ADDR);
+    int begin(uint8_t addr = VK3809IP_ADDR, uint32_t bus_hz = VK3809IP_DEFAULT_BUS_HZ);
+    Transport &getTransport() { return _bus; }
 
     // bool begin(TwoWire *theWire = &Wire);
 
@@ -280,6 +481,18 @@ public:
 
     bool settingTpxThresholdData(uint16_t thresholdValue, tpx_setting_number_t tpNum);
     bool settingSleepThresholdData(uint16_t thresholdValue);
+    static void encodeThresholdData(uint16_t thresholdValue, uint8_t *data);
+
+#if VK3809IP_PROFILE
+    static void buildProfile(vk_profile_t *profile, const char *name,
+                             uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4,
+                             const uint16_t *thresholds = nullptr,
+                             uint16_t sleepThreshold = VK3809IP_DEFAULT_SLEEP_THRESHOLD);
+    int applyProfile(const vk_profile_t *profile);
+    const vk_profile_t *getActiveProfile() const { return _profile; }
+    bool isSwitching() const { return _switching; }
+    uint32_t getLastSwitchLatency() const { return _lastSwitchLatency; }
+#endif
 
     bool getSystemCorrectionFlagState();
     bool getSystemWriteFlagState();
@@ -291,10 +504,55 @@ public:
     void print_byte_as_binary(uint8_t byte);
     uint8_t* getAllData();
 
+    bool updateFrame();
+    const uint8_t *getFrame() const { return _frame; }
+    uint32_t getFrameTime() const { return _frameTime; }
+
+#if VK3809IP_LAYOUT
+    bool getTouchState(vk_touch_state_t *state, bool refresh = true);
+    const VK3809IPLayout &getLayout() const { return _layout; }
+#endif
+
+#if VK3809IP_KEYMASK
+    uint16_t getKeyMask(bool refresh = true);
+    uint16_t getKeysPressed() const { return _keyMask & ~_prevKeyMask; }
+    uint16_t getKeysReleased() const { return _prevKeyMask & ~_keyMask; }
+    uint16_t getKeysHeld() const { return _keyMask & _prevKeyMask; }
+#endif
+
+    bool setDataMode(i2c_data_mode_t mode);
+    i2c_data_mode_t getDataMode() const { return (i2c_data_mode_t)extractBits(_settingData[0], 7, 1); }
+    int readRawData(uint8_t *data, uint8_t len);
+
+    void setTimeSource(vk_time_fptr_t time_cb) { _time_cb = time_cb; }
+#if VK3809IP_RECOVERY
+    void setResetCallback(vk_reset_cb_t reset_cb, void *arg = nullptr);
+    uint32_t getResetCount() const { return _resetCount; }
+    bool isRecovering() const { return _recovering; }
+    bool isRecoveryFailed() const { return _recoveryFailed; }
+    uint32_t getLastRecoveryTime() const { return _lastRecoveryTime; }
+#endif
+
+    void setTransferBudget(uint32_t read_slack_us, uint32_t write_slack_us);
+    void setBusHz(uint32_t bus_hz) { _busHz = bus_hz ? bus_hz : _busHz; }  // 总线切换频率后更新超时计算
+    uint32_t getBusHz() const { return _busHz; }
+    uint32_t getTransferTimeout(uint8_t nbytes, bool write) const;
+    uint32_t getBusErrorCount() const { return _busErrorCount; }
+
+protected:
+    Transport _bus;
+    uint8_t _address = VK3809IP_ADDR;
+    uint32_t _busHz = VK3809IP_DEFAULT_BUS_HZ;
+
 private:
-    uint8_t _address;
 
-    uint8_t extractBits(uint8_t byte, int startBit, int numBits);
+    static uint8_t extractBits(uint8_t byte, int startBit, int numBits);
+
+    bool _readFrame();
+#if VK3809IP_RECOVERY
+    void _checkFrameState();
+    bool _reapplyConfig();
+#endif
 
     int _readByte(uint8_t nbytes, uint8_t *data);
     int _writeByte(uint8_t nbytes, uint8_t *data);
@@ -302,13 +560,146 @@ private:
     bool writeThreeByteData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3);
     bool writeFourByteData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4);
 
-    vk_com_fptr_t _read_cb = nullptr;
-    vk_com_fptr_t _write_cb = nullptr;
+    uint32_t _readSlack = VK3809IP_READ_SLACK_US;
+    uint32_t _writeSlack = VK3809IP_WRITE_SLACK_US;
+    uint32_t _busErrorCount = 0;
+
+    uint8_t _raw[VK3809IP_FRAME_LEN] = {0};   // 最近一次读到的原始帧
+    uint8_t _frame[VK3809IP_FRAME_LEN] = {0}; // 最近一次有效帧，重置恢复期间不更新
+    uint32_t _frameTime = 0;
+#if VK3809IP_LAYOUT
+    VK3809IPLayout _layout;
+#endif
+#if VK3809IP_KEYMASK
+    uint16_t _keyMask = 0;      // 最近一帧的按键掩码
+    uint16_t _prevKeyMask = 0;  // 上一帧的按键掩码
+
+    void _updateKeyMask();
+#endif
+
+    uint8_t _settingData[4] = {0x80, 0, 0, 0};  // 最近一次写入的应用设定
+#if VK3809IP_RECOVERY
+    // 最近一次写入的阈值，用于芯片意外重置后的恢复
+    uint16_t _tpThreshold[VK3809IP_TP_NUM];
+    uint16_t _sleepThreshold = VK3809IP_DEFAULT_SLEEP_THRESHOLD;
+    bool _configStored = false;
+
+    bool _resetArmed = false;   // 已确认配置生效，开始监测写入标志
+    bool _recovering = false;   // 已重新写入配置，等待校正完成
+    uint32_t _resetCount = 0;
+    uint32_t _recoveryStart = 0;
+    uint32_t _lastRecoveryTime = 0;
+    uint8_t _reapplyAttempts = 0;   // 本次恢复已重写配置的次数
+    uint8_t _settleFrames = 0;      // 重写后已读取的帧数
+    bool _reapplyOk = false;        // 最近一次重写的全部配置包都写入成功
+    bool _sawCalibration = false;   // 重写后看到过校正中(校正标志为0)的帧
+    bool _recoveryFailed = false;   // 重写 VK3809IP_REAPPLY_RETRIES 次后配置仍未生效
+    vk_reset_cb_t _reset_cb = nullptr;
+    void *_reset_arg = nullptr;
+#endif
+
+#if VK3809IP_PROFILE
+    const vk_profile_t *_profile = nullptr;
+    bool _switching = false;    // 切换配置后等待校正完成
+    uint32_t _lastSwitchLatency = 0;
+#endif
+
+    vk_time_fptr_t _time_cb = nullptr;
     // I2CDevice *i2c_dev = NULL; ///< Pointer to I2C bus interface
 };
 
-extern VK3809IP slider;
+#if VK3809IP_DEVICE
+/**************************************************************************/
+/*!
+    @brief 模块使用的芯片接口:
+    事件订阅、双核流水、原始计数、协程、所有者任务与遥测只通过该接口访问芯片，
+    任意传输的驱动用 VK3809IPDeviceT<Transport> 声明后都可以交给这些模块。
+*/
+/**************************************************************************/
+class VK3809IPDevice
+{
+public:
+    virtual bool getTouchState(vk_touch_state_t *state, bool refresh = true) = 0;
+    virtual bool settingCommandsData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4) = 0;
+    virtual bool settingTpxThresholdData(uint16_t thresholdValue, tpx_setting_number_t tpNum) = 0;
+    virtual bool settingSleepThresholdData(uint16_t thresholdValue) = 0;
+    virtual int applyProfile(const vk_profile_t *profile) = 0;
+    virtual bool setDataMode(i2c_data_mode_t mode) = 0;
+    virtual int readRawData(uint8_t *data, uint8_t len) = 0;
+    virtual bool isSwitching() const = 0;
+    virtual uint32_t getLastSwitchLatency() const = 0;
+    virtual uint32_t getResetCount() const = 0;
+    virtual bool isRecoveryFailed() const = 0;
+    virtual uint32_t getBusErrorCount() const = 0;
 
-#ifdef __cplusplus
-}
+protected:
+    ~VK3809IPDevice() = default;
+};
+
+/**************************************************************************/
+/*!
+    @brief 实现模块接口的驱动:
+    接口函数转发到 VK3809IPT，并标记为 final，直接通过驱动对象调用时仍可以内联。
+*/
+/**************************************************************************/
+template <class Transport>
+class VK3809IPDeviceT : public VK3809IPT<Transport>, public VK3809IPDevice
+{
+    typedef VK3809IPT<Transport> Driver;
+
+public:
+    using Driver::Driver;
+
+    bool getTouchState(vk_touch_state_t *state, bool refresh = true) override final { return Driver::getTouchState(state, refresh); }
+    bool settingCommandsData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4) override final
+    {
+        return Driver::settingCommandsData(DataByte1, DataByte2, DataByte3, DataByte4);
+    }
+    bool settingTpxThresholdData(uint16_t thresholdValue, tpx_setting_number_t tpNum) override final { return Driver::settingTpxThresholdData(thresholdValue, tpNum); }
+    bool settingSleepThresholdData(uint16_t thresholdValue) override final { return Driver::settingSleepThresholdData(thresholdValue); }
+    bool setDataMode(i2c_data_mode_t mode) override final { return Driver::setDataMode(mode); }
+    int readRawData(uint8_t *data, uint8_t len) override final { return Driver::readRawData(data, len); }
+    uint32_t getBusErrorCount() const override final { return Driver::getBusErrorCount(); }
+#if VK3809IP_PROFILE
+    int applyProfile(const vk_profile_t *profile) override final { return Driver::applyProfile(profile); }
+    bool isSwitching() const override final { return Driver::isSwitching(); }
+    uint32_t getLastSwitchLatency() const override final { return Driver::getLastSwitchLatency(); }
+#else
+    // 未打开 VK3809IP_PROFILE 时配置切换总是失败
+    int applyProfile(const vk_profile_t *) override final { return -1; }
+    bool isSwitching() const override final { return false; }
+    uint32_t getLastSwitchLatency() const override final { return 0; }
+#endif
+#if VK3809IP_RECOVERY
+    uint32_t getResetCount() const override final { return Driver::getResetCount(); }
+    bool isRecoveryFailed() const override final { return Driver::isRecoveryFailed(); }
+#else
+    uint32_t getResetCount() const override final { return 0; }
+    bool isRecoveryFailed() const override final { return false; }
 #endif
+};
+#endif
+
+/**************************************************************************/
+/*!
+    @brief 函数指针接口的驱动:
+    与原有接口兼容的薄适配层，可以直接交给以 VK3809IPDevice 为参数的模块。
+*/
+/**************************************************************************/
+#if VK3809IP_DEVICE
+class VK3809IP : public VK3809IPDeviceT<VKCallbackTransport>
+#else
+class VK3809IP : public VK3809IPT<VKCallbackTransport>
+#endif
+{
+public:
+    int begin(vk_com_fptr_t read_cb, vk_com_fptr_t write_cb, uint8_t addr = VK3809IP_ADDR);
+    int begin(vk_com_timeout_fptr_t read_cb, vk_com_timeout_fptr_t write_cb, uint8_t addr = VK3809IP_ADDR, uint32_t bus_hz = VK3809IP_DEFAULT_BUS_HZ);
+};
+
+#include "vk3809ip_impl.hpp"
+
+// 函数指针版本只在 vk3809ip.cpp 中实例化一次
+extern template class VK3809IPT<VKCallbackTransport>;
+
+extern VK3809IP slider;
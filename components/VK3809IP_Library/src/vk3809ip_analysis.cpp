@@ -0,0 +1,204 @@
+/**
+ * @file vk3809ip_analysis.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip per-channel raw count signal analysis
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_analysis.hpp"
+
+static const int32_t W = VK_ANALYSIS_WINDOW;
+
+typedef int32_t vk_v4si __attribute__((vector_size(16)));
+typedef int64_t vk_v2di __attribute__((vector_size(16)));
+
+static uint32_t vk_isqrt64(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+VK3809IPRawAnalysis::VK3809IPRawAnalysis()
+{
+  reset();
+}
+
+/**
+ * @brief 清空窗口，下一个采样会作为初始值填满窗口
+ * 
+ */
+void VK3809IPRawAnalysis::reset()
+{
+  memset(_window, 0, sizeof(_window));
+  memset(_baseline, 0, sizeof(_baseline));
+  memset(_sum, 0, sizeof(_sum));
+  memset(_sumXY, 0, sizeof(_sumXY));
+  memset(_sumSq, 0, sizeof(_sumSq));
+  _pos = 0;
+  _samples = 0;
+}
+
+/**
+ * @brief 第一个采样填满整个窗口，避免启动阶段的统计量偏差
+ */
+void VK3809IPRawAnalysis::_prime(const uint16_t *counts)
+{
+  for (int c = 0; c < VK3809IP_RAW_CHANNELS; c++)
+  {
+    int32_t x = counts[c];
+    for (int i = 0; i < W; i++)
+    {
+      _window[i][c] = x;
+    }
+    _baseline[c] = x << 8;
+    _sum[c] = x * W;
+    _sumXY[c] = x * (W * (W - 1) / 2);
+    _sumSq[c] = (int64_t)x * x * W;
+  }
+}
+
+/**
+ * @brief 批量处理(向量版本):
+ * 每个采样把 TP0~TP8 作为一行，补齐到 VK_ANALYSIS_LANES 后按128位向量更新全部统计量。
+ * 窗口滑动时 Σi*x 的更新为 Σi*x - (Σx - x_old) + (W-1)*x_new
+ * 
+ * @param frames 连续的原始帧
+ * @param count 帧数
+ */
+void VK3809IPRawAnalysis::process(const vk_raw_frame_t *frames, uint32_t count)
+{
+  for (uint32_t n = 0; n < count; n++)
+  {
+    if (_samples++ == 0)
+    {
+      _prime(frames[n].counts);
+      continue;
+    }
+
+    alignas(16) int32_t x[VK_ANALYSIS_LANES] = {0};
+    for (int c = 0; c < VK3809IP_RAW_CHANNELS; c++)
+    {
+      x[c] = frames[n].counts[c];
+    }
+    int32_t *old = _window[_pos];
+
+    for (int v = 0; v < VK_ANALYSIS_LANES / 4; v++)
+    {
+      vk_v4si xn = *(const vk_v4si *)&x[v * 4];
+      vk_v4si xo = *(const vk_v4si *)&old[v * 4];
+      vk_v4si *sum = (vk_v4si *)&_sum[v * 4];
+      vk_v4si *sxy = (vk_v4si *)&_sumXY[v * 4];
+      vk_v4si *base = (vk_v4si *)&_baseline[v * 4];
+
+      *sxy = *sxy - (*sum - xo) + xn * (W - 1);
+      *sum = *sum + xn - xo;
+      *base = *base + (((xn << 8) - *base) >> VK_ANALYSIS_BASELINE_SHIFT);
+
+      for (int h = 0; h < 2; h++)
+      {
+        vk_v2di xn2 = {xn[h * 2], xn[h * 2 + 1]};
+        vk_v2di xo2 = {xo[h * 2], xo[h * 2 + 1]};
+        vk_v2di *ssq = (vk_v2di *)&_sumSq[v * 4 + h * 2];
+        *ssq = *ssq + xn2 * xn2 - xo2 * xo2;
+      }
+      *(vk_v4si *)&old[v * 4] = xn;
+    }
+    _pos = (_pos + 1) % W;
+  }
+}
+/**
+ * @brief 批量处理(标量版本):
+ * 逐通道计算，结果与 process() 完全一致，用于对照与没有向量支持的平台
+ * 
+ * @param frames 连续的原始帧
+ * @param count 帧数
+ */
+void VK3809IPRawAnalysis::processScalar(const vk_raw_frame_t *frames, uint32_t count)
+{
+  for (uint32_t n = 0; n < count; n++)
+  {
+    if (_samples++ == 0)
+    {
+      _prime(frames[n].counts);
+      continue;
+    }
+
+    int32_t *old = _window[_pos];
+    for (int c = 0; c < VK3809IP_RAW_CHANNELS; c++)
+    {
+      int32_t xn = frames[n].counts[c];
+      int32_t xo = old[c];
+      _sumXY[c] = _sumXY[c] - (_sum[c] - xo) + xn * (W - 1);
+      _sum[c] = _sum[c] + xn - xo;
+      _sumSq[c] = _sumSq[c] + (int64_t)xn * xn - (int64_t)xo * xo;
+      _baseline[c] = _baseline[c] + (((xn << 8) - _baseline[c]) >> VK_ANALYSIS_BASELINE_SHIFT);
+      old[c] = xn;
+    }
+    _pos = (_pos + 1) % W;
+  }
+}
+
+/**
+ * @brief 取得全部通道的分析结果:
+ * 方差 = (W*Σx² - (Σx)²) / W²，斜率 = (W*Σi*x - Σi*Σx) / (W*Σi² - (Σi)²)
+ * 
+ * @param result 
+ * @return true 
+ * @return false 还没有采样
+ */
+bool VK3809IPRawAnalysis::getResult(vk_analysis_result_t *result) const
+{
+  if (_samples == 0)
+  {
+    return VK_FAIL;
+  }
+
+  const int64_t sumI = W * (W - 1) / 2;
+  const int64_t sumI2 = (int64_t)(W - 1) * W * (2 * W - 1) / 6;
+  const int64_t slopeDen = W * sumI2 - sumI * sumI;
+
+  for (int c = 0; c < VK3809IP_RAW_CHANNELS; c++)
+  {
+    int64_t var = ((int64_t)W * _sumSq[c] - (int64_t)_sum[c] * _sum[c]);  // W² * 方差
+    uint32_t rms_q4 = vk_isqrt64((uint64_t)(var < 0 ? 0 : var) << 8) / W;
+    int32_t mean = _sum[c] / W;
+    int32_t base = _baseline[c] >> 8;
+    int32_t signal = (mean > base) ? mean - base : base - mean;
+
+    result->baseline[c] = (uint16_t)base;
+    result->mean[c] = (uint16_t)mean;
+    result->noise_rms_q4[c] = (uint16_t)((rms_q4 > 0xFFFF) ? 0xFFFF : rms_q4);
+    if (rms_q4 == 0)
+    {
+      result->snr_q4[c] = signal ? 0xFFFF : 0;
+    }
+    else
+    {
+      uint32_t snr = ((uint32_t)signal << 8) / rms_q4;
+      result->snr_q4[c] = (uint16_t)((snr > 0xFFFF) ? 0xFFFF : snr);
+    }
+    result->drift_q16[c] = (int32_t)((((int64_t)W * _sumXY[c] - sumI * _sum[c]) << 16) / slopeDen);
+  }
+  return VK_PASS;
+}
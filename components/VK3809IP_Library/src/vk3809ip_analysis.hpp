@@ -0,0 +1,60 @@
+/**
+ * @file vk3809ip_analysis.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip per-channel raw count signal analysis
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include "vk3809ip_raw.hpp"
+
+#define VK_ANALYSIS_WINDOW 32           // 滑动窗口采样数
+#define VK_ANALYSIS_LANES 12            // 通道数补齐到4的倍数，方便按128位向量处理
+#define VK_ANALYSIS_BASELINE_SHIFT 6    // 基准值跟随速度，每个采样靠近 1/2^n
+
+/**
+ * @brief 全部通道的分析结果，按指标分组存放
+ * 
+ */
+typedef struct{
+    uint16_t baseline[VK3809IP_RAW_CHANNELS];       // 基准值(慢速跟随)
+    uint16_t mean[VK3809IP_RAW_CHANNELS];           // 窗口均值
+    uint16_t noise_rms_q4[VK3809IP_RAW_CHANNELS];   // 窗口内噪声均方根，Q4
+    uint16_t snr_q4[VK3809IP_RAW_CHANNELS];         // |均值-基准值| / 噪声，Q4，噪声为0时取最大值
+    int32_t drift_q16[VK3809IP_RAW_CHANNELS];       // 窗口内线性拟合斜率，counts/采样，Q16
+}vk_analysis_result_t;
+
+/**************************************************************************/
+/*!
+    @brief 原始计数分析:
+    对 TP0~TP8 同时计算基准值、噪声RMS、信噪比与漂移斜率。数据按指标分组、通道连续存放，
+    每个采样对所有通道做同样的运算，编译器可以按向量处理；窗口统计量滑动更新，每个采样O(1)。
+*/
+/**************************************************************************/
+class VK3809IPRawAnalysis
+{
+public:
+    VK3809IPRawAnalysis(void);
+
+    void reset();
+    void process(const vk_raw_frame_t *frames, uint32_t count);
+    void processScalar(const vk_raw_frame_t *frames, uint32_t count);
+
+    bool getResult(vk_analysis_result_t *result) const;
+    uint32_t getSampleCount() const { return _samples; }
+
+private:
+    void _prime(const uint16_t *counts);
+
+    alignas(16) int32_t _window[VK_ANALYSIS_WINDOW][VK_ANALYSIS_LANES];
+    alignas(16) int32_t _baseline[VK_ANALYSIS_LANES];   // Q8
+    alignas(16) int32_t _sum[VK_ANALYSIS_LANES];        // Σx
+    alignas(16) int32_t _sumXY[VK_ANALYSIS_LANES];      // Σi*x，i=0为窗口内最旧的采样
+    alignas(16) int64_t _sumSq[VK_ANALYSIS_LANES];      // Σx²
+    uint32_t _pos;
+    uint32_t _samples;
+};
@@ -0,0 +1,263 @@
+/**
+ * @file vk3809ip_broker.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip touch event publish/subscribe fan-out
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_broker.hpp"
+
+VK3809IPBroker::VK3809IPBroker()
+{
+  static_assert((VK_BROKER_DEPTH & (VK_BROKER_DEPTH - 1)) == 0, "VK_BROKER_DEPTH must be a power of 2");
+  for (int i = 0; i < VK_BROKER_DEPTH; i++)
+  {
+    _slots[i].seq.store(0, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < VK_BROKER_MAX_SUBSCRIBERS; i++)
+  {
+    _subs[i].claimed.store(false, std::memory_order_relaxed);
+    _subs[i].active.store(false, std::memory_order_relaxed);
+    _subs[i].dropped.store(0, std::memory_order_relaxed);
+  }
+  _head.store(0, std::memory_order_relaxed);
+  memset(&_last, 0, sizeof(_last));
+  _lastResetCount = 0;
+}
+
+/**
+ * @brief 回调方式订阅:
+ * 回调在发布者任务中同步执行，直接拿到共享缓冲中的记录，适合很短的处理
+ * 
+ * @param filter 过滤条件
+ * @param cb 
+ * @param arg 回调透传参数
+ * @return int 订阅号，订阅者已满时返回-1
+ */
+int VK3809IPBroker::subscribe(const vk_event_filter_t &filter, vk_event_cb_t cb, void *arg)
+{
+  if (cb == nullptr)
+    return -1;
+  return _add(filter, cb, nullptr, arg);
+}
+/**
+ * @brief 队列方式订阅:
+ * 订阅者在自己的任务里用 poll() 取记录，有匹配的记录发布时调用 notify 唤醒订阅者
+ * 
+ * @param filter 过滤条件
+ * @param notify 可选唤醒通知
+ * @param arg 通知透传参数
+ * @return int 订阅号，订阅者已满时返回-1
+ */
+int VK3809IPBroker::subscribeQueue(const vk_event_filter_t &filter, vk_notify_fptr_t notify, void *arg)
+{
+  return _add(filter, nullptr, notify, arg);
+}
+/**
+ * @brief 取消订阅
+ * 
+ * @param id 
+ */
+void VK3809IPBroker::unsubscribe(int id)
+{
+  if (id < 0 || id >= VK_BROKER_MAX_SUBSCRIBERS)
+    return;
+  _subs[id].active.store(false, std::memory_order_release);
+  _subs[id].claimed.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief 取出下一条匹配的记录:
+ * 只能在订阅者自己的任务中调用。记录在读取时复制出来，复制过程中被发布者覆盖的记录
+ * 会被丢弃并计入丢弃数
+ * 
+ * @param id 订阅号
+ * @param event 
+ * @return true 取到记录
+ * @return false 没有新记录
+ */
+bool VK3809IPBroker::poll(int id, vk_touch_event_t *event)
+{
+  if (id < 0 || id >= VK_BROKER_MAX_SUBSCRIBERS)
+    return false;
+  Subscriber &sub = _subs[id];
+
+  for (;;)
+  {
+    uint32_t head = _head.load(std::memory_order_acquire);
+    if (sub.cursor == head)
+    {
+      return false;
+    }
+    if (head - sub.cursor > VK_BROKER_DEPTH)
+    {
+      sub.dropped.fetch_add(head - sub.cursor - VK_BROKER_DEPTH, std::memory_order_relaxed);
+      sub.cursor = head - VK_BROKER_DEPTH;
+    }
+
+    Slot &slot = _slots[sub.cursor & (VK_BROKER_DEPTH - 1)];
+    uint32_t expect = sub.cursor * 2 + 2;
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == expect)
+    {
+      memcpy(event, &slot.event, sizeof(*event));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq = slot.seq.load(std::memory_order_relaxed);
+    }
+    sub.cursor++;
+    if (seq != expect)
+    {
+      sub.dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    if (match(sub.filter, *event))
+    {
+      return true;
+    }
+  }
+}
+/**
+ * @brief 订阅者累计丢弃的记录数:
+ * 订阅者落后超过 VK_BROKER_DEPTH 条时旧记录被覆盖，覆盖的记录无法再判断是否匹配过滤条件，全部计入
+ * 
+ * @param id 
+ * @return uint32_t 
+ */
+uint32_t VK3809IPBroker::getDropCount(int id) const
+{
+  if (id < 0 || id >= VK_BROKER_MAX_SUBSCRIBERS)
+    return 0;
+  return _subs[id].dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 读取一帧并发布:
+ * 由唯一持有芯片的读取任务调用，例如在INT中断通知之后。芯片意外重置时也会发布一条重置事件
+ * 
+ * @param chip 
+ * @return true 发布了记录
+ * @return false 
+ */
+bool VK3809IPBroker::process(VK3809IPDevice &chip)
+{
+  vk_touch_state_t state;
+  bool valid = chip.getTouchState(&state);
+  uint32_t reset_count = chip.getResetCount();
+  if (!valid && reset_count == _lastResetCount)
+  {
+    return false;
+  }
+  publish(state, reset_count, valid);
+  return true;
+}
+/**
+ * @brief 发布一帧:
+ * 与上一次发布的状态比较得到事件，写入广播缓冲一次，然后通知所有匹配的订阅者
+ * 
+ * @param state 解码后的状态
+ * @param reset_count 芯片累计重置次数，变化时带上 `VK_EVT_CHIP_RESET`
+ * @param frame_valid 是否为有效帧，决定是否带上 `VK_EVT_FRAME`
+ */
+void VK3809IPBroker::publish(const vk_touch_state_t &state, uint32_t reset_count, bool frame_valid)
+{
+  uint32_t n = _head.load(std::memory_order_relaxed);
+  Slot &slot = _slots[n & (VK_BROKER_DEPTH - 1)];
+  vk_touch_event_t &event = slot.event;
+
+  slot.seq.store(n * 2 + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint8_t held = state.slider_touch & _last.slider_touch;
+  uint8_t moved = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    moved |= (uint8_t)((state.slider_position[i] != _last.slider_position[i]) << i);
+  }
+  event.seq = n;
+  event.slider_touched = state.slider_touch & ~_last.slider_touch;
+  event.slider_released = _last.slider_touch & ~state.slider_touch;
+  event.slider_moved = held & moved;
+  event.keys_pressed = state.key_mask & ~_last.key_mask;
+  event.keys_released = _last.key_mask & ~state.key_mask;
+  event.reset_count = reset_count;
+  event.state = state;
+  event.events = (event.keys_pressed ? VK_EVT_KEY_PRESS : 0) |
+                 (event.keys_released ? VK_EVT_KEY_RELEASE : 0) |
+                 (event.slider_touched ? VK_EVT_SLIDER_TOUCH : 0) |
+                 (event.slider_moved ? VK_EVT_SLIDER_MOVE : 0) |
+                 (event.slider_released ? VK_EVT_SLIDER_RELEASE : 0) |
+                 (reset_count != _lastResetCount ? VK_EVT_CHIP_RESET : 0) |
+                 (frame_valid ? VK_EVT_FRAME : 0);
+
+  slot.seq.store(n * 2 + 2, std::memory_order_release);
+  _head.store(n + 1, std::memory_order_release);
+  _last = state;
+  _lastResetCount = reset_count;
+
+  for (int i = 0; i < VK_BROKER_MAX_SUBSCRIBERS; i++)
+  {
+    Subscriber &sub = _subs[i];
+    if (!sub.active.load(std::memory_order_acquire) || !match(sub.filter, event))
+    {
+      continue;
+    }
+    if (sub.cb != nullptr)
+    {
+      sub.cb(&event, sub.arg);
+    }
+    else if (sub.notify != nullptr)
+    {
+      sub.notify(sub.arg);
+    }
+  }
+}
+
+/**
+ * @brief 占用一个空位并填写订阅者:
+ * 多个任务可以同时订阅，先用CAS占用位置再填写，填写完成后才置 active 让发布者看到
+ * 
+ */
+int VK3809IPBroker::_add(const vk_event_filter_t &filter, vk_event_cb_t cb, vk_notify_fptr_t notify, void *arg)
+{
+  for (int i = 0; i < VK_BROKER_MAX_SUBSCRIBERS; i++)
+  {
+    Subscriber &sub = _subs[i];
+    bool expected = false;
+    if (!sub.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+    {
+      continue;
+    }
+    sub.filter = filter;
+    sub.cb = cb;
+    sub.notify = notify;
+    sub.arg = arg;
+    sub.cursor = _head.load(std::memory_order_acquire);
+    sub.dropped.store(0, std::memory_order_relaxed);
+    sub.active.store(true, std::memory_order_release);
+    return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief 事件是否符合过滤条件
+ * 
+ * @param filter 
+ * @param event 
+ * @return true 
+ * @return false 
+ */
+bool VK3809IPBroker::match(const vk_event_filter_t &filter, const vk_touch_event_t &event)
+{
+  uint8_t events = event.events & filter.events;
+  uint16_t keys = ((events & VK_EVT_KEY_PRESS) ? event.keys_pressed : 0) |
+                  ((events & VK_EVT_KEY_RELEASE) ? event.keys_released : 0);
+  uint8_t sliders = ((events & VK_EVT_SLIDER_TOUCH) ? event.slider_touched : 0) |
+                    ((events & VK_EVT_SLIDER_MOVE) ? event.slider_moved : 0) |
+                    ((events & VK_EVT_SLIDER_RELEASE) ? event.slider_released : 0);
+  return (keys & filter.key_mask) || (sliders & filter.slider_mask) ||
+         (events & (VK_EVT_CHIP_RESET | VK_EVT_FRAME));
+}
@@ -0,0 +1,116 @@
+/**
+ * @file vk3809ip_broker.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip touch event publish/subscribe fan-out
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include "vk3809ip.hpp"
+
+#define VK_BROKER_DEPTH 16          // 广播环形缓冲深度，必须为2的幂
+#define VK_BROKER_MAX_SUBSCRIBERS 8 // 最大订阅者数量
+
+/**
+ * @brief 触摸事件类型，可以按位组合作为订阅过滤条件
+ *
+ */
+typedef enum{
+    VK_EVT_KEY_PRESS = 1 << 0,
+    VK_EVT_KEY_RELEASE = 1 << 1,
+    VK_EVT_SLIDER_TOUCH = 1 << 2,
+    VK_EVT_SLIDER_MOVE = 1 << 3,
+    VK_EVT_SLIDER_RELEASE = 1 << 4,
+    VK_EVT_CHIP_RESET = 1 << 5,
+    VK_EVT_FRAME = 1 << 6,          // 每一帧有效数据都会带上该标志
+    VK_EVT_ALL = 0x7F,
+}vk_event_type_t;
+/**
+ * @brief 一帧产生的全部事件:
+ * 与上一帧比较得到，同一帧内的多个事件合并为一条记录
+ */
+typedef struct{
+    uint32_t seq;                   // 发布序号
+    uint8_t events;                 // vk_event_type_t 组合
+    uint8_t slider_touched;         // 新触摸的滑条 bit0~bit2
+    uint8_t slider_moved;           // 位置变化的滑条
+    uint8_t slider_released;        // 松开的滑条
+    uint16_t keys_pressed;          // 新按下的按键 bit0~bit8
+    uint16_t keys_released;         // 新松开的按键
+    uint32_t reset_count;           // 芯片累计重置次数
+    vk_touch_state_t state;         // 该帧解码后的完整状态
+}vk_touch_event_t;
+/**
+ * @brief 订阅过滤条件:
+ * 按键与滑条事件还需要涉及的按键/滑条落在掩码内才会投递，重置与帧事件只看类型
+ */
+typedef struct{
+    uint8_t events;                 // vk_event_type_t 组合
+    uint8_t slider_mask;            // bit0~bit2 对应 Slide1~Slide3
+    uint16_t key_mask;              // bit0~bit8 对应 Key1~Key9
+}vk_event_filter_t;
+
+/**
+ * @brief 回调订阅，在发布者(读取芯片的任务)中同步调用，回调内不要阻塞
+ */
+typedef void (*vk_event_cb_t)(const vk_touch_event_t *event, void *arg);
+/**
+ * @brief 队列订阅的唤醒通知，例如对接 xTaskNotifyGive()
+ */
+typedef void (*vk_notify_fptr_t)(void *arg);
+
+/**************************************************************************/
+/*!
+    @brief 触摸事件分发:
+    只有一个任务读取芯片并发布，多个任务订阅。事件只写入一次共享的广播环形缓冲，
+    各订阅者维护自己的读取位置；订阅者跟不上时旧记录被覆盖并计入丢弃数，不会阻塞发布者。
+*/
+/**************************************************************************/
+class VK3809IPBroker
+{
+public:
+    VK3809IPBroker(void);
+
+    int subscribe(const vk_event_filter_t &filter, vk_event_cb_t cb, void *arg = nullptr);
+    int subscribeQueue(const vk_event_filter_t &filter, vk_notify_fptr_t notify = nullptr, void *arg = nullptr);
+    void unsubscribe(int id);
+
+    bool poll(int id, vk_touch_event_t *event);
+    uint32_t getDropCount(int id) const;
+
+    bool process(VK3809IPDevice &chip);
+    void publish(const vk_touch_state_t &state, uint32_t reset_count, bool frame_valid = true);
+
+    static bool match(const vk_event_filter_t &filter, const vk_touch_event_t &event);
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq;  // 2n+1 写入中，2n+2 第n条记录写入完成
+        vk_touch_event_t event;
+    };
+    struct Subscriber
+    {
+        std::atomic<bool> claimed;  // 订阅时先用CAS占用，防止两个任务同时填写同一位置
+        std::atomic<bool> active;   // 填写完成后才置位，发布者只看这个标志
+        vk_event_filter_t filter;
+        vk_event_cb_t cb;
+        vk_notify_fptr_t notify;
+        void *arg;
+        uint32_t cursor;            // 下一条要读取的记录序号
+        std::atomic<uint32_t> dropped;
+    };
+
+    int _add(const vk_event_filter_t &filter, vk_event_cb_t cb, vk_notify_fptr_t notify, void *arg);
+
+    Slot _slots[VK_BROKER_DEPTH];
+    Subscriber _subs[VK_BROKER_MAX_SUBSCRIBERS];
+    std::atomic<uint32_t> _head;    // 已发布的记录数
+    vk_touch_state_t _last;
+    uint32_t _lastResetCount;
+};
@@ -0,0 +1,241 @@
+/**
+ * @file vk3809ip_busprobe.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip bus clock self-characterization and speed selection
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_busprobe.hpp"
+
+static const uint32_t vk_busprobe_default_speeds[] = {100000, 200000, 400000, 600000, 800000, 1000000};
+
+VK3809IPBusProbe::VK3809IPBusProbe()
+{
+  _time_cb = nullptr;
+  _resultCount = 0;
+  _rttSum = 0;
+  _haveReference = false;
+  _passed = false;
+  configure(defaultConfig());
+}
+
+/**
+ * @brief 默认参数：100k~1MHz 六档，错误率不超过0.1%(每档3000次读取)，不留余量
+ *
+ * @return vk_busprobe_config_t
+ */
+vk_busprobe_config_t VK3809IPBusProbe::defaultConfig()
+{
+  vk_busprobe_config_t config;
+  config.speeds = vk_busprobe_default_speeds;
+  config.count = sizeof(vk_busprobe_default_speeds) / sizeof(vk_busprobe_default_speeds[0]);
+  config.samples = VK_BUSPROBE_SAMPLES;
+  config.error_budget_ppm = VK_BUSPROBE_BUDGET_PPM;
+  config.margin_steps = 0;
+  return config;
+}
+
+/**
+ * @brief 设置自检参数
+ *
+ * @param config
+ * @return true
+ * @return false 候选频率为空、超过 VK_BUSPROBE_MAX_SPEEDS、未按升序排列，
+ *               或错误预算小到 65535 次读取也无法说明(约46ppm以下)
+ */
+bool VK3809IPBusProbe::configure(const vk_busprobe_config_t &config)
+{
+  if (config.speeds == nullptr || config.count == 0 || config.count > VK_BUSPROBE_MAX_SPEEDS || config.samples == 0 ||
+      (uint64_t)0xFFFF * config.error_budget_ppm < (uint64_t)VK_BUSPROBE_CONFIDENCE_ERRORS * 1000000)
+  {
+    return VK_FAIL;
+  }
+  for (uint8_t i = 0; i < config.count; i++)
+  {
+    if (config.speeds[i] == 0 || (i > 0 && config.speeds[i] <= config.speeds[i - 1]))
+    {
+      return VK_FAIL;
+    }
+  }
+  for (uint8_t i = 0; i < config.count; i++)
+  {
+    _speeds[i] = config.speeds[i];
+  }
+  _count = config.count;
+  uint16_t required = getRequiredSamples(config.error_budget_ppm);
+  _samples = (config.samples > required) ? config.samples : required;
+  _budgetPpm = config.error_budget_ppm;
+  _margin = config.margin_steps;
+  _selected = _speeds[0];
+  return VK_PASS;
+}
+
+/**
+ * @brief 从热启动缓存恢复，缓存有效且参数未改变时不需要再次自检
+ *
+ * @param cache
+ * @return true 已恢复，getSelectedSpeed() 为缓存的频率
+ */
+bool VK3809IPBusProbe::restore(const vk_busprobe_cache_t &cache)
+{
+  if (cache.magic != VK_BUSPROBE_CACHE_MAGIC || cache.key != _key() ||
+      cache.check != ~(cache.magic ^ cache.hz ^ cache.key))
+  {
+    return VK_FAIL;
+  }
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_speeds[i] == cache.hz)
+    {
+      _selected = cache.hz;
+      _passed = true;
+      return VK_PASS;
+    }
+  }
+  return VK_FAIL;
+}
+/**
+ * @brief 保存自检结果，未满足错误预算时写入无效缓存，下次启动重新自检
+ *
+ * @param cache
+ */
+void VK3809IPBusProbe::store(vk_busprobe_cache_t *cache) const
+{
+  cache->magic = _passed ? VK_BUSPROBE_CACHE_MAGIC : 0;
+  cache->hz = _selected;
+  cache->key = _key();
+  cache->check = ~(cache->magic ^ cache->hz ^ cache->key);
+}
+
+/**
+ * @brief 状态帧读取的超时：总线频率下的理论传输时间加上 VK3809IP_READ_SLACK_US，与驱动相同
+ *
+ * @param hz
+ * @return uint32_t us
+ */
+uint32_t VK3809IPBusProbe::getReadTimeout(uint32_t hz)
+{
+  uint32_t clocks = (VK3809IP_FRAME_LEN + 2) * 9 + 4;
+  return (uint32_t)(((uint64_t)clocks * 1000000 + hz - 1) / hz) + VK3809IP_READ_SLACK_US;
+}
+
+/**
+ * @brief 零错误时能说明错误率不超过预算所需的读取次数：3/预算，向上取整，超出计数范围时取 0xFFFF
+ *
+ * @param budget_ppm 错误预算(百万分之一)
+ * @return uint16_t
+ */
+uint16_t VK3809IPBusProbe::getRequiredSamples(uint32_t budget_ppm)
+{
+  if (budget_ppm == 0)
+  {
+    return 0xFFFF;
+  }
+  uint64_t n = ((uint64_t)VK_BUSPROBE_CONFIDENCE_ERRORS * 1000000 + budget_ppm - 1) / budget_ppm;
+  return (n > 0xFFFF) ? 0xFFFF : (uint16_t)n;
+}
+
+void VK3809IPBusProbe::_begin(uint8_t index)
+{
+  vk_busprobe_result_t &r = _results[index];
+  r.hz = _speeds[index];
+  r.samples = 0;
+  r.bus_errors = 0;
+  r.data_errors = 0;
+  r.rtt_avg_us = 0;
+  r.rtt_max_us = 0;
+  r.pass = true;
+  _rttSum = 0;
+  _resultCount = index + 1;
+}
+
+/**
+ * @brief 记录一次读取
+ *
+ * @param index 候选频率序号
+ * @param ret 传输返回值
+ * @param frame 读到的状态帧
+ * @param rtt 往返时间(us)
+ * @return true 继续读取
+ * @return false 错误数已超出预算，该频率不合格
+ */
+bool VK3809IPBusProbe::_sample(uint8_t index, int ret, const uint8_t *frame, uint32_t rtt)
+{
+  vk_busprobe_result_t &r = _results[index];
+  r.samples++;
+  if (ret != 0)
+  {
+    r.bus_errors++;
+  }
+  else if (!_haveReference)
+  {
+    memcpy(_reference, frame, VK3809IP_FRAME_LEN);
+    _haveReference = true;
+  }
+  else if (memcmp(_reference, frame, VK3809IP_FRAME_LEN) != 0)
+  {
+    r.data_errors++;
+  }
+  _rttSum += rtt;
+  r.rtt_avg_us = (uint32_t)(_rttSum / r.samples);
+  if (rtt > r.rtt_max_us)
+  {
+    r.rtt_max_us = rtt;
+  }
+
+  // 读完全部次数后仍要满足 (错误数 + 3) <= 次数 × 预算，提前超出时不必继续
+  uint64_t errors = (uint64_t)r.bus_errors + r.data_errors + VK_BUSPROBE_CONFIDENCE_ERRORS;
+  if (errors * 1000000 > (uint64_t)_samples * _budgetPpm)
+  {
+    r.pass = false;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 选出最快的合格频率，再按 margin_steps 降档
+ *
+ */
+void VK3809IPBusProbe::_finish()
+{
+  int best = -1;
+  for (uint8_t i = 0; i < _resultCount && _results[i].pass; i++)
+  {
+    best = i;
+  }
+  _passed = best >= 0;
+  if (!_passed)
+  {
+    _selected = _speeds[0];
+    return;
+  }
+  best -= _margin;
+  _selected = _speeds[(best > 0) ? best : 0];
+}
+
+uint32_t VK3809IPBusProbe::_key() const
+{
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  uint32_t values[VK_BUSPROBE_MAX_SPEEDS + 3];
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    values[n++] = _speeds[i];
+  }
+  values[n++] = _samples;
+  values[n++] = _budgetPpm;
+  values[n++] = _margin;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    for (int b = 0; b < 32; b += 8)
+    {
+      hash = (hash ^ ((values[i] >> b) & 0xFF)) * 16777619u;
+    }
+  }
+  return hash;
+}
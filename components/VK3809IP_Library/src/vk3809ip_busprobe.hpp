@@ -0,0 +1,160 @@
+/**
+ * @file vk3809ip_busprobe.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip bus clock self-characterization and speed selection
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+
+#define VK_BUSPROBE_MAX_SPEEDS 8        // 候选频率最多个数
+#define VK_BUSPROBE_SAMPLES 200         // 每个频率读取状态帧的最少次数，实际次数见 getRequiredSamples()
+#define VK_BUSPROBE_BUDGET_PPM 1000     // 允许的错误率，百万分之一
+#define VK_BUSPROBE_CONFIDENCE_ERRORS 3 // 三分之一法则：n 次读取零错误时，错误率的95%置信上限约为 3/n
+#define VK_BUSPROBE_CACHE_MAGIC 0x564B4250  // "VKBP"
+
+/*
+    ! 自检在上电初始化时运行，期间不要触摸：读取成功但与基准帧(最低频率下的第一帧)不同的帧计为数据错误。
+    ! 从低到高逐个测试候选频率，遇到第一个超出错误预算的频率即停止，选择它之前最快的频率，
+    ! 不会跳过一个失败的频率去选择更快的频率。
+    ! 合格条件为 (错误数 + 3) <= 读取次数 × 预算。每档至少读取 3/预算 次(默认0.1%时3000次)，
+    ! 零错误通过时错误率的95%置信上限不超过预算；只读几百次且不允许错误只能说明错误率低于约1%。
+*/
+
+/**
+ * @brief 切换总线频率的接口，例如对接 i2c_master_set_speed()
+ */
+typedef bool (*vk_bus_speed_fptr_t)(uint32_t hz, void *arg);
+
+/**
+ * @brief 自检参数
+ *
+ */
+typedef struct{
+    const uint32_t *speeds;             // 候选频率(Hz)，按从小到大排列
+    uint8_t count;
+    uint16_t samples;                   // 每个频率的最少读取次数，少于 getRequiredSamples() 时取后者
+    uint32_t error_budget_ppm;          // 总线错误与数据错误合计的允许比例，不能小于约46ppm
+    uint8_t margin_steps;               // 从最快的合格频率再降低的档数，给温度与电压变化留余量
+}vk_busprobe_config_t;
+/**
+ * @brief 一个候选频率的测量结果
+ *
+ */
+typedef struct{
+    uint32_t hz;
+    uint16_t samples;                   // 实际读取次数，超出预算后提前结束
+    uint16_t bus_errors;                // 传输返回错误(NACK、超时)
+    uint16_t data_errors;               // 读取成功但数据与基准帧不同
+    uint32_t rtt_avg_us;                // 一次状态帧读取的平均往返时间，需要 setTimeSource()
+    uint32_t rtt_max_us;
+    bool pass;
+}vk_busprobe_result_t;
+/**
+ * @brief 热启动缓存，放在 RTC_NOINIT_ATTR 变量中，软件复位与唤醒后保留，上电时内容随机
+ *
+ */
+typedef struct{
+    uint32_t magic;
+    uint32_t hz;
+    uint32_t key;                       // 候选频率与预算的摘要，参数改变后缓存失效
+    uint32_t check;
+}vk_busprobe_cache_t;
+
+/**************************************************************************/
+/*!
+    @brief 总线频率自检:
+    在每个候选频率下连续读取状态帧，统计错误率与往返时间，选出满足错误预算的最快频率，
+    结果可以缓存到热启动后直接使用。传输在编译期绑定，主机上可以用 VKSimBusTransport 模拟。
+*/
+/**************************************************************************/
+class VK3809IPBusProbe
+{
+public:
+    VK3809IPBusProbe(void);
+
+    static vk_busprobe_config_t defaultConfig();
+    bool configure(const vk_busprobe_config_t &config);
+    void setTimeSource(vk_time_fptr_t time_cb) { _time_cb = time_cb; }
+
+    template <class Transport>
+    uint32_t run(Transport &bus, vk_bus_speed_fptr_t set_speed, void *arg = nullptr, uint8_t addr = VK3809IP_ADDR);
+
+    bool restore(const vk_busprobe_cache_t &cache);
+    void store(vk_busprobe_cache_t *cache) const;
+
+    uint32_t getSelectedSpeed() const { return _selected; }
+    bool isPassed() const { return _passed; }
+    uint8_t getResultCount() const { return _resultCount; }
+    const vk_busprobe_result_t *getResult(uint8_t index) const { return (index < _resultCount) ? &_results[index] : nullptr; }
+
+    static uint32_t getReadTimeout(uint32_t hz);
+    static uint16_t getRequiredSamples(uint32_t budget_ppm);
+
+private:
+    void _begin(uint8_t index);
+    bool _sample(uint8_t index, int ret, const uint8_t *frame, uint32_t rtt);
+    void _finish();
+    uint32_t _key() const;
+    uint32_t _now() const { return (_time_cb != nullptr) ? _time_cb() : 0; }
+
+    uint32_t _speeds[VK_BUSPROBE_MAX_SPEEDS];
+    uint8_t _count;
+    uint16_t _samples;
+    uint32_t _budgetPpm;
+    uint8_t _margin;
+    vk_time_fptr_t _time_cb;
+
+    vk_busprobe_result_t _results[VK_BUSPROBE_MAX_SPEEDS];
+    uint8_t _resultCount;
+    uint64_t _rttSum;
+    uint8_t _reference[VK3809IP_FRAME_LEN];
+    bool _haveReference;
+    uint32_t _selected;
+    bool _passed;
+};
+
+/**
+ * @brief 运行自检，结束时总线切换到选出的频率
+ *
+ * @param bus 与驱动相同的传输
+ * @param set_speed 切换总线频率，返回 false 视为该频率不可用
+ * @param arg set_speed 的参数
+ * @param addr 设备地址
+ * @return uint32_t 选出的频率；最低频率也不满足预算时返回最低频率，isPassed() 为 false
+ */
+template <class Transport>
+uint32_t VK3809IPBusProbe::run(Transport &bus, vk_bus_speed_fptr_t set_speed, void *arg, uint8_t addr)
+{
+  _resultCount = 0;
+  _haveReference = false;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (!set_speed(_speeds[i], arg))
+    {
+      break;
+    }
+    _begin(i);
+    uint32_t timeout = getReadTimeout(_speeds[i]);
+    uint8_t frame[VK3809IP_FRAME_LEN];
+    bool ok = true;
+    for (uint16_t n = 0; n < _samples && ok; n++)
+    {
+      uint32_t start = _now();
+      int ret = bus.read(addr, frame, VK3809IP_FRAME_LEN, timeout);
+      ok = _sample(i, ret, frame, _now() - start);
+    }
+    if (!ok)
+    {
+      break;
+    }
+  }
+  _finish();
+  set_speed(_selected, arg);
+  return _selected;
+}
@@ -0,0 +1,277 @@
+/**
+ * @file vk3809ip_coro.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip C++20 coroutine API for frame reads and configuration
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_coro.hpp"
+
+#if VK3809IP_HAS_CORO
+
+#include <atomic>
+
+static_assert(VK_CORO_POOL_BLOCKS <= 32, "VK_CORO_POOL_BLOCKS must not exceed 32");
+
+alignas(max_align_t) static uint8_t vk_coro_pool[VK_CORO_POOL_BLOCKS][VK_CORO_BLOCK_SIZE];
+static std::atomic<uint32_t> vk_coro_used(0);  // 每位对应一个块
+static std::atomic<uint32_t> vk_coro_max_frame(0);
+
+/**
+ * @brief 从内存池分配一个协程帧
+ *
+ * @param size 编译器给出的协程帧大小
+ * @return void* 失败返回 nullptr，协程不会启动
+ */
+void *vk_coro_alloc(size_t size)
+{
+  uint32_t max_frame = vk_coro_max_frame.load(std::memory_order_relaxed);
+  while (size > max_frame && !vk_coro_max_frame.compare_exchange_weak(max_frame, (uint32_t)size, std::memory_order_relaxed))
+  {
+  }
+  if (size > VK_CORO_BLOCK_SIZE)
+  {
+    return nullptr;
+  }
+  uint32_t used = vk_coro_used.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    uint32_t free = ~used & (uint32_t)((1ULL << VK_CORO_POOL_BLOCKS) - 1);
+    if (free == 0)
+    {
+      return nullptr;
+    }
+    uint32_t bit = free & (0u - free);
+    if (vk_coro_used.compare_exchange_weak(used, used | bit, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+      return vk_coro_pool[__builtin_ctz(bit)];
+    }
+  }
+}
+
+void vk_coro_free(void *ptr)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+  size_t index = ((uint8_t *)ptr - &vk_coro_pool[0][0]) / VK_CORO_BLOCK_SIZE;
+  vk_coro_used.fetch_and(~(1u << index), std::memory_order_release);
+}
+
+/**
+ * @brief 正在使用的协程帧数
+ *
+ * @return uint32_t
+ */
+uint32_t vk_coro_get_in_use()
+{
+  return (uint32_t)__builtin_popcount(vk_coro_used.load(std::memory_order_relaxed));
+}
+/**
+ * @brief 创建过的最大协程帧字节数(包括因超过 VK_CORO_BLOCK_SIZE 而没有启动的)，用于调整 VK_CORO_BLOCK_SIZE
+ *
+ * @return uint32_t
+ */
+uint32_t vk_coro_get_max_frame()
+{
+  return vk_coro_max_frame.load(std::memory_order_relaxed);
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP coroutine awaiters.
+*/
+/**************************************************************************/
+
+VK3809IPCoroScheduler::Awaiter::Awaiter(VK3809IPCoroScheduler &sched, uint8_t kind, const vk_event_filter_t &filter)
+    : _sched(sched)
+{
+  _waiter.next = nullptr;
+  _waiter.kind = kind;
+  _waiter.filter = filter;
+}
+
+/**
+ * @brief 挂起协程，加入等待链表。等待节点在协程帧内，不需要额外分配
+ *
+ * @param handle
+ */
+void VK3809IPCoroScheduler::Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+  _waiter.handle = handle;
+  _waiter.next = _sched._waiters;
+  _sched._waiters = &_waiter;
+}
+
+VK3809IPCoroScheduler::ConfigAwaiter::ConfigAwaiter(VK3809IPCoroScheduler &sched, const vk_profile_t *profile)
+    : Awaiter(sched, WAIT_CONFIG, vk_event_filter_t{VK_EVT_FRAME, 0, 0}), _profile(profile), _result(-1)
+{
+}
+
+/**
+ * @brief 写入配置，写入失败或与当前配置相同(没有写入任何包)时不挂起
+ *
+ * @return true 不需要等待校正
+ */
+bool VK3809IPCoroScheduler::ConfigAwaiter::await_ready()
+{
+  if (_sched._chip == nullptr || _profile == nullptr)
+  {
+    return true;
+  }
+  _result = _sched._chip->applyProfile(_profile);
+  return _result <= 0 || !_sched._chip->isSwitching();
+}
+
+/**
+ * @brief 配置生效
+ *
+ * @return int32_t 从写入到校正完成的时间(us)，需要先 setTimeSource()；与当前配置相同时为0，
+ * 写入失败或重写多次仍未生效时为-1
+ */
+int32_t VK3809IPCoroScheduler::ConfigAwaiter::await_resume() const
+{
+  if (_result <= 0)
+  {
+    return _result < 0 ? -1 : 0;
+  }
+  if (_sched._chip->isRecoveryFailed())
+  {
+    return -1;
+  }
+  return (int32_t)_sched._chip->getLastSwitchLatency();
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP coroutine scheduler.
+*/
+/**************************************************************************/
+
+VK3809IPCoroScheduler::VK3809IPCoroScheduler()
+{
+  _chip = nullptr;
+  _waiters = nullptr;
+}
+
+/**
+ * @brief 绑定芯片，芯片需要已完成 begin() 与配置
+ *
+ * @param chip
+ * @return true
+ */
+bool VK3809IPCoroScheduler::begin(VK3809IPDevice &chip)
+{
+  vk_event_filter_t all = {VK_EVT_ALL, 0x07, VK_KEY_MASK_ALL};
+  if (_chip == nullptr && _broker.subscribe(all, _onEvent, this) < 0)
+  {
+    return VK_FAIL;
+  }
+  _chip = &chip;
+  return VK_PASS;
+}
+
+/**
+ * @brief 读取一帧并恢复满足条件的协程，在INT通知之后调用
+ *
+ * @return true 读到了有效帧或重置事件
+ */
+bool VK3809IPCoroScheduler::poll()
+{
+  if (_chip == nullptr)
+  {
+    return false;
+  }
+  return _broker.process(*_chip);
+}
+
+/**
+ * @brief 等待下一帧有效数据
+ *
+ * @return FrameAwaiter co_await 结果为 vk_touch_state_t
+ */
+VK3809IPCoroScheduler::FrameAwaiter VK3809IPCoroScheduler::nextFrame()
+{
+  return FrameAwaiter(*this, WAIT_FRAME, vk_event_filter_t{VK_EVT_FRAME, 0, 0});
+}
+/**
+ * @brief 等待下一个符合过滤条件的事件
+ *
+ * @param filter 与 VK3809IPBroker 的订阅条件相同
+ * @return EventAwaiter co_await 结果为 vk_touch_event_t
+ */
+VK3809IPCoroScheduler::EventAwaiter VK3809IPCoroScheduler::nextEvent(const vk_event_filter_t &filter)
+{
+  return EventAwaiter(*this, WAIT_EVENT, filter);
+}
+/**
+ * @brief 切换配置并等待芯片校正完成
+ *
+ * @param profile 预先生成的配置
+ * @return ConfigAwaiter co_await 结果为切换耗时(us)，失败时为-1
+ */
+VK3809IPCoroScheduler::ConfigAwaiter VK3809IPCoroScheduler::applyConfig(const vk_profile_t *profile)
+{
+  return ConfigAwaiter(*this, profile);
+}
+
+uint32_t VK3809IPCoroScheduler::getWaiterCount() const
+{
+  uint32_t count = 0;
+  for (const Waiter *w = _waiters; w != nullptr; w = w->next)
+  {
+    count++;
+  }
+  return count;
+}
+
+void VK3809IPCoroScheduler::_onEvent(const vk_touch_event_t *event, void *arg)
+{
+  ((VK3809IPCoroScheduler *)arg)->_dispatch(*event);
+}
+
+bool VK3809IPCoroScheduler::_ready(const Waiter &waiter, const vk_touch_event_t &event) const
+{
+  switch (waiter.kind)
+  {
+  case WAIT_FRAME:
+    return event.events & VK_EVT_FRAME;
+  case WAIT_CONFIG:
+    return (event.events & VK_EVT_FRAME) && !_chip->isSwitching();
+  default:
+    return VK3809IPBroker::match(waiter.filter, event);
+  }
+}
+
+/**
+ * @brief 恢复满足条件的协程:
+ * 先摘下整条等待链表，恢复的协程再次 co_await 时挂到新链表上，同一帧内不会被重复恢复
+ *
+ * @param event
+ */
+void VK3809IPCoroScheduler::_dispatch(const vk_touch_event_t &event)
+{
+  Waiter *w = _waiters;
+  _waiters = nullptr;
+  while (w != nullptr)
+  {
+    Waiter *next = w->next;
+    if (_ready(*w, event))
+    {
+      w->event = event;
+      w->handle.resume();
+    }
+    else
+    {
+      w->next = _waiters;
+      _waiters = w;
+    }
+    w = next;
+  }
+}
+
+#endif // VK3809IP_HAS_CORO
@@ -0,0 +1,146 @@
+/**
+ * @file vk3809ip_coro.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip C++20 coroutine API for frame reads and configuration
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+#include "vk3809ip_broker.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define VK3809IP_HAS_CORO 1
+
+#include <coroutine>
+#include <stddef.h>
+
+#define VK_CORO_POOL_BLOCKS 8           // 同时存在的协程数上限，不超过32
+#define VK_CORO_BLOCK_SIZE 256          // 每个协程帧的最大字节数，超出时协程创建失败
+
+/*
+    ! 协程帧从固定内存池分配，不使用堆；内存池耗尽或协程帧超过 VK_CORO_BLOCK_SIZE 时协程不会启动，
+    ! 用 VK3809IPTask::isStarted() 检查。
+    ! 协程只能在调用 VK3809IPCoroScheduler::poll() 的任务中创建，所有协程都在该任务中恢复，共用它的栈。
+*/
+
+void *vk_coro_alloc(size_t size);
+void vk_coro_free(void *ptr);
+uint32_t vk_coro_get_in_use();
+uint32_t vk_coro_get_max_frame();
+
+/**************************************************************************/
+/*!
+    @brief 触摸处理协程:
+    立即开始执行，运行到第一个 co_await 时挂起，结束后自动释放协程帧。
+*/
+/**************************************************************************/
+class VK3809IPTask
+{
+public:
+    struct promise_type
+    {
+        VK3809IPTask get_return_object() noexcept { return VK3809IPTask(true); }
+        static VK3809IPTask get_return_object_on_allocation_failure() noexcept { return VK3809IPTask(false); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+
+        static void *operator new(size_t size) noexcept { return vk_coro_alloc(size); }
+        static void operator delete(void *ptr) noexcept { vk_coro_free(ptr); }
+    };
+
+    bool isStarted() const { return _started; }
+
+private:
+    explicit VK3809IPTask(bool started) : _started(started) {}
+    bool _started;
+};
+
+/**************************************************************************/
+/*!
+    @brief 协程调度:
+    持有芯片的任务在INT通知后调用 poll()，读取一帧并通过内部的事件分发恢复等待中的协程。
+    多个逻辑上独立的输入处理协程共用这一个任务与它的栈。
+*/
+/**************************************************************************/
+class VK3809IPCoroScheduler
+{
+public:
+    struct Waiter
+    {
+        Waiter *next;
+        std::coroutine_handle<> handle;
+        uint8_t kind;
+        vk_event_filter_t filter;
+        vk_touch_event_t event;
+    };
+
+    class Awaiter
+    {
+    public:
+        Awaiter(VK3809IPCoroScheduler &sched, uint8_t kind, const vk_event_filter_t &filter);
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+    protected:
+        VK3809IPCoroScheduler &_sched;
+        Waiter _waiter;
+    };
+    class FrameAwaiter : public Awaiter
+    {
+    public:
+        using Awaiter::Awaiter;
+        vk_touch_state_t await_resume() const { return _waiter.event.state; }
+    };
+    class EventAwaiter : public Awaiter
+    {
+    public:
+        using Awaiter::Awaiter;
+        vk_touch_event_t await_resume() const { return _waiter.event; }
+    };
+    class ConfigAwaiter : public Awaiter
+    {
+    public:
+        ConfigAwaiter(VK3809IPCoroScheduler &sched, const vk_profile_t *profile);
+        bool await_ready();
+        int32_t await_resume() const;
+    private:
+        const vk_profile_t *_profile;
+        int _result;                    // applyProfile() 的返回值
+    };
+
+    VK3809IPCoroScheduler(void);
+
+    bool begin(VK3809IPDevice &chip);
+    bool poll();
+
+    FrameAwaiter nextFrame();
+    EventAwaiter nextEvent(const vk_event_filter_t &filter);
+    ConfigAwaiter applyConfig(const vk_profile_t *profile);
+
+    VK3809IPBroker &getBroker() { return _broker; }
+    uint32_t getWaiterCount() const;
+
+private:
+    enum
+    {
+        WAIT_FRAME,
+        WAIT_EVENT,
+        WAIT_CONFIG,
+    };
+
+    static void _onEvent(const vk_touch_event_t *event, void *arg);
+    void _dispatch(const vk_touch_event_t &event);
+    bool _ready(const Waiter &waiter, const vk_touch_event_t &event) const;
+
+    VK3809IPDevice *_chip;
+    VK3809IPBroker _broker;
+    Waiter *_waiters;
+};
+
+#endif // __cpp_impl_coroutine
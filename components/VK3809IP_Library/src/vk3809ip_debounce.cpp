@@ -0,0 +1,211 @@
+/**
+ * @file vk3809ip_debounce.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip per-key software debounce stage
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_debounce.hpp"
+
+VK3809IPDebounce::VK3809IPDebounce()
+{
+  _raw = 0;
+  _out = 0;
+  _pending = 0;
+  configureAll(VK_DEBOUNCE_OFF, 0);
+}
+
+/**
+ * @brief 设置一个按键的消抖方式
+ * 
+ * @param keyIndex 按键序号(0起，对应Key 1)
+ * @param mode 
+ * @param param 积分器为确认帧数(0 为直接输出，最大 VK_DEBOUNCE_INTEGRATOR_MAX)，时间窗为保持时间(us)
+ */
+void VK3809IPDebounce::configureKey(uint8_t keyIndex, vk_debounce_mode_t mode, uint32_t param)
+{
+  if (keyIndex >= 9)
+    return;
+  _setChannel(keyIndex, mode, param);
+}
+/**
+ * @brief 设置一个滑条触摸标志的消抖方式，滑条位置不受影响
+ * 
+ * @param sliderIndex 滑条序号(0~2)
+ * @param mode 
+ * @param param 积分器为确认帧数(0 为直接输出，最大 VK_DEBOUNCE_INTEGRATOR_MAX)，时间窗为保持时间(us)
+ */
+void VK3809IPDebounce::configureSlider(uint8_t sliderIndex, vk_debounce_mode_t mode, uint32_t param)
+{
+  if (sliderIndex >= 3)
+    return;
+  _setChannel(9 + sliderIndex, mode, param);
+}
+/**
+ * @brief 所有按键与滑条使用同一种消抖方式，并清除状态
+ * 
+ * @param mode 
+ * @param param 同 configureKey()
+ */
+void VK3809IPDebounce::configureAll(vk_debounce_mode_t mode, uint32_t param)
+{
+  for (uint8_t i = 0; i < VK_DEBOUNCE_CHANNELS; i++)
+  {
+    _setChannel(i, mode, param);
+  }
+  reset();
+}
+/**
+ * @brief 积分器帧数为0时按直接输出处理(否则每帧都会翻转)，超过计数器范围的帧数取上限
+ */
+void VK3809IPDebounce::_setChannel(uint8_t channel, vk_debounce_mode_t mode, uint32_t param)
+{
+  if (mode == VK_DEBOUNCE_INTEGRATOR)
+  {
+    if (param == 0)
+    {
+      mode = VK_DEBOUNCE_OFF;
+    }
+    else if (param > VK_DEBOUNCE_INTEGRATOR_MAX)
+    {
+      param = VK_DEBOUNCE_INTEGRATOR_MAX;
+    }
+  }
+  _ch[channel].mode = mode;
+  _ch[channel].param = param;
+  _ch[channel].integrator = ((_out >> channel) & 0x01) ? (uint16_t)param : 0;
+}
+
+/**
+ * @brief 清除消抖状态与统计
+ * 
+ */
+void VK3809IPDebounce::reset()
+{
+  for (int i = 0; i < VK_DEBOUNCE_CHANNELS; i++)
+  {
+    _ch[i].integrator = 0;
+    _ch[i].since = 0;
+    _ch[i].suppressed = 0;
+    _ch[i].latency = 0;
+  }
+  _raw = 0;
+  _out = 0;
+  _pending = 0;
+}
+
+/**
+ * @brief 输入一帧，输出消抖后的按键掩码与滑条触摸标志:
+ * 时间窗方式只有在新的一帧到来时才能确认，INT方式读取时状态稳定后芯片不会再拉INT，
+ * hasPending() 为真时需要在 getPendingDeadline() 之后再读一帧
+ * 
+ * @param in 解码后的帧
+ * @param out 输出，可以与 in 为同一个变量
+ * @return true 消抖后的状态有变化
+ * @return false 
+ */
+bool VK3809IPDebounce::filter(const vk_touch_state_t &in, vk_touch_state_t *out)
+{
+  uint16_t raw = (uint16_t)(in.key_mask | (in.slider_touch << 9));
+  uint16_t prev = _out;
+
+  for (uint8_t i = 0; i < VK_DEBOUNCE_CHANNELS; i++)
+  {
+    bool r = (raw >> i) & 0x01;
+    bool o = _step(i, r, in.timestamp);
+    _out = (uint16_t)((_out & ~(1 << i)) | (o << i));
+  }
+  _raw = raw;
+  _pending = _raw ^ _out;
+
+  if (out != &in)
+  {
+    *out = in;
+  }
+  out->key_mask = _out & VK_KEY_MASK_ALL;
+  out->slider_touch = (uint8_t)(_out >> 9);
+  return _out != prev;
+}
+/**
+ * @brief 最早需要再读一帧确认的时间(us)，只对时间窗方式有意义
+ * 
+ * @return uint32_t 
+ */
+uint32_t VK3809IPDebounce::getPendingDeadline() const
+{
+  uint32_t deadline = 0;
+  bool found = false;
+  for (uint8_t i = 0; i < VK_DEBOUNCE_CHANNELS; i++)
+  {
+    if (!((_pending >> i) & 0x01) || _ch[i].mode != VK_DEBOUNCE_WINDOW)
+    {
+      continue;
+    }
+    uint32_t t = _ch[i].since + _ch[i].param;
+    if (!found || (int32_t)(t - deadline) < 0)
+    {
+      deadline = t;
+      found = true;
+    }
+  }
+  return deadline;
+}
+
+bool VK3809IPDebounce::_step(uint8_t channel, bool raw, uint32_t now)
+{
+  Channel &ch = _ch[channel];
+  bool out = (_out >> channel) & 0x01;
+  bool last = (_raw >> channel) & 0x01;
+
+  if (raw != last)
+  {
+    // 原始状态在确认前又翻回来，记为一次被滤掉的毛刺
+    if (raw == out && ((_pending >> channel) & 0x01))
+    {
+      ch.suppressed++;
+    }
+    ch.since = now;
+  }
+
+  switch (ch.mode)
+  {
+  case VK_DEBOUNCE_INTEGRATOR:
+    if (raw && ch.integrator < ch.param)
+    {
+      ch.integrator++;
+    }
+    else if (!raw && ch.integrator > 0)
+    {
+      ch.integrator--;
+    }
+    if (ch.integrator >= ch.param && !out)
+    {
+      out = true;
+    }
+    else if (ch.integrator == 0 && out)
+    {
+      out = false;
+    }
+    else
+    {
+      return out;
+    }
+    break;
+  case VK_DEBOUNCE_WINDOW:
+    if (raw == out || now - ch.since < ch.param)
+    {
+      return out;
+    }
+    out = raw;
+    break;
+  default:
+    ch.integrator = raw ? (uint16_t)ch.param : 0;
+    return raw;
+  }
+
+  ch.latency = now - ch.since;
+  return out;
+}
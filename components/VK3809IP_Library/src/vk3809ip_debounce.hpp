@@ -0,0 +1,71 @@
+/**
+ * @file vk3809ip_debounce.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip per-key software debounce stage
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+
+#define VK_DEBOUNCE_CHANNELS 12     // Key1~Key9 + Slide1~Slide3 触摸标志
+#define VK_DEBOUNCE_INTEGRATOR_MAX 0xFFFF   // 积分器确认帧数上限，超出时取上限
+
+/**
+ * @brief 软件消抖方式
+ * 
+ */
+typedef enum{
+    VK_DEBOUNCE_OFF,                // 直接输出
+    VK_DEBOUNCE_INTEGRATOR,         // 积分器：连续N帧一致累计到上限/下限才翻转，N为0时直接输出
+    VK_DEBOUNCE_WINDOW,             // 时间窗：新状态保持T(us)以上才翻转，需要 setTimeSource()，帧时间戳恒为0时永远不会翻转
+}vk_debounce_mode_t;
+
+/**************************************************************************/
+/*!
+    @brief 按键软件消抖:
+    硬件 KEY_ACK_TIME 对所有按键生效，调大会让不抖动的按键也变慢。这里对每个按键和滑条触摸
+    标志单独设置消抖方式，硬件消抖次数可以调低，只给抖动的按键增加延迟。
+*/
+/**************************************************************************/
+class VK3809IPDebounce
+{
+public:
+    VK3809IPDebounce(void);
+
+    void configureKey(uint8_t keyIndex, vk_debounce_mode_t mode, uint32_t param);
+    void configureSlider(uint8_t sliderIndex, vk_debounce_mode_t mode, uint32_t param);
+    void configureAll(vk_debounce_mode_t mode, uint32_t param);
+
+    bool filter(const vk_touch_state_t &in, vk_touch_state_t *out);
+    void reset();
+
+    bool hasPending() const { return _pending != 0; }
+    uint32_t getPendingDeadline() const;
+
+    uint32_t getSuppressedCount(uint8_t channel) const { return (channel < VK_DEBOUNCE_CHANNELS) ? _ch[channel].suppressed : 0; }
+    uint32_t getAddedLatency(uint8_t channel) const { return (channel < VK_DEBOUNCE_CHANNELS) ? _ch[channel].latency : 0; }
+
+private:
+    struct Channel
+    {
+        uint8_t mode;
+        uint32_t param;         // 积分器为帧数，时间窗为us
+        uint16_t integrator;
+        uint32_t since;         // 原始状态最近一次变化的时间
+        uint32_t suppressed;    // 被滤掉的毛刺次数
+        uint32_t latency;       // 最近一次翻转相对原始边沿增加的延迟(us)
+    };
+
+    void _setChannel(uint8_t channel, vk_debounce_mode_t mode, uint32_t param);
+    bool _step(uint8_t channel, bool raw, uint32_t now);
+
+    Channel _ch[VK_DEBOUNCE_CHANNELS];
+    uint16_t _raw;              // 上一帧的原始状态，bit0~8 按键，bit9~11 滑条
+    uint16_t _out;              // 消抖后的状态
+    uint16_t _pending;          // 原始状态与输出不同、等待确认的通道
+};
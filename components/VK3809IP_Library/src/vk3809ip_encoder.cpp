@@ -0,0 +1,138 @@
+/**
+ * @file vk3809ip_encoder.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip slider/ring rotary encoder emulation
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_encoder.hpp"
+
+VK3809IPEncoder::VK3809IPEncoder()
+{
+  _accelCount = 0;
+  configure(vk_slider_full_scale(SLIDE_X_NUM_9), 24);
+}
+
+/**
+ * @brief 配置档位:
+ * 位移以 counts*detents 为单位累计，一个档位宽度为一圈的 counts。越过档位边界后还要
+ * 再多走回滞宽度才输出一步，避免手指停在档位边界时来回跳
+ * 
+ * @param full_scale 一圈(一整条)的位置最大值，与 VK3809IPRing::getFullScale() 一致
+ * @param detents 一圈(一整条)的档位数
+ * @param hysteresis_percent 回滞占一个档位的百分比(0~50)
+ */
+void VK3809IPEncoder::configure(uint16_t full_scale, uint16_t detents, uint8_t hysteresis_percent)
+{
+  if (detents == 0)
+  {
+    detents = 1;
+  }
+  if (hysteresis_percent > 50)
+  {
+    hysteresis_percent = 50;
+  }
+  _period = (uint32_t)full_scale + 1;
+  _detents = detents;
+  _hysteresis = _period * hysteresis_percent / 100;
+  reset();
+}
+/**
+ * @brief 设置加速曲线:
+ * 按 velocity 从小到大排列，未达到第一段速度时倍数为1
+ * 
+ * @param curve 
+ * @param count 段数，最多 VK_ENCODER_ACCEL_STEPS，0 为关闭加速
+ * @return true 
+ * @return false 段数超出或速度未按升序排列
+ */
+bool VK3809IPEncoder::setAcceleration(const vk_encoder_accel_t *curve, uint8_t count)
+{
+  if (count > VK_ENCODER_ACCEL_STEPS)
+  {
+    return VK_FAIL;
+  }
+  for (uint8_t i = 1; i < count; i++)
+  {
+    if (curve[i].velocity <= curve[i - 1].velocity)
+    {
+      return VK_FAIL;
+    }
+  }
+  memcpy(_accel, curve, count * sizeof(vk_encoder_accel_t));
+  _accelCount = count;
+  return VK_PASS;
+}
+/**
+ * @brief 清除档位内的残余位移与累计步数
+ * 
+ */
+void VK3809IPEncoder::reset()
+{
+  _residual = 0;
+  _count = 0;
+}
+
+/**
+ * @brief 输入一帧滑环位移
+ * 
+ * @param ring 已经 update() 过的滑环
+ * @return int16_t 本帧输出的档位步数，顺时针为正
+ */
+int16_t VK3809IPEncoder::update(const VK3809IPRing &ring)
+{
+  return update(ring.getDelta(), ring.getVelocity(), ring.isTouched());
+}
+/**
+ * @brief 输入一帧位移
+ * 
+ * @param delta 本帧位移(counts)
+ * @param velocity_q8 速度(counts/s，Q8)，用于加速
+ * @param touched 是否触摸，松开时清除档位内的残余位移
+ * @return int16_t 本帧输出的档位步数
+ */
+int16_t VK3809IPEncoder::update(int16_t delta, int32_t velocity_q8, bool touched)
+{
+  if (!touched)
+  {
+    _residual = 0;
+    return 0;
+  }
+
+  _residual += (int32_t)delta * _detents;
+
+  // 以当前档位中心为原点，越过档位边界再加回滞宽度才切换到相邻档位
+  int16_t steps = 0;
+  int32_t edge = (int32_t)(_period / 2 + _hysteresis);
+  while (_residual > edge)
+  {
+    _residual -= (int32_t)_period;
+    steps++;
+  }
+  while (_residual < -edge)
+  {
+    _residual += (int32_t)_period;
+    steps--;
+  }
+
+  steps *= _multiplier(velocity_q8);
+  _count += steps;
+  return steps;
+}
+
+uint8_t VK3809IPEncoder::_multiplier(int32_t velocity_q8) const
+{
+  uint32_t speed = (uint32_t)((velocity_q8 < 0) ? -velocity_q8 : velocity_q8) >> VK_RING_VELOCITY_Q;
+  uint8_t multiplier = 1;
+  for (uint8_t i = 0; i < _accelCount; i++)
+  {
+    if (speed >= _accel[i].velocity)
+    {
+      multiplier = _accel[i].multiplier;
+    }
+  }
+  return multiplier;
+}
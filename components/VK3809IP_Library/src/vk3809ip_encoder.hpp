@@ -0,0 +1,59 @@
+/**
+ * @file vk3809ip_encoder.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip slider/ring rotary encoder emulation
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include "vk3809ip_ring.hpp"
+
+#define VK_ENCODER_ACCEL_STEPS 4    // 加速曲线最多分段数
+
+/**
+ * @brief 加速曲线的一段:
+ * 速度(counts/s)达到 velocity 时每个档位输出 multiplier 步
+ */
+typedef struct{
+    uint16_t velocity;
+    uint8_t multiplier;
+}vk_encoder_accel_t;
+
+/**************************************************************************/
+/*!
+    @brief 旋钮编码器模拟:
+    把滑条/滑环位移换算成带符号的档位步数，可以设定一圈(一整条)的档位数、档位边界回滞
+    与按速度分段的加速倍数。只用整数运算，不分配内存，每帧在 VK3809IPRing::update() 之后调用。
+*/
+/**************************************************************************/
+class VK3809IPEncoder
+{
+public:
+    VK3809IPEncoder(void);
+
+    void configure(uint16_t full_scale, uint16_t detents, uint8_t hysteresis_percent = 25);
+    bool setAcceleration(const vk_encoder_accel_t *curve, uint8_t count);
+
+    int16_t update(const VK3809IPRing &ring);
+    int16_t update(int16_t delta, int32_t velocity_q8, bool touched);
+    void reset();
+
+    int32_t getCount() const { return _count; }
+
+private:
+    uint8_t _multiplier(int32_t velocity_q8) const;
+
+    uint32_t _period;       // 档位宽度，counts*detents，等于一圈(一整条)的 counts
+    uint16_t _detents;
+    uint32_t _hysteresis;   // 回滞宽度，单位为 counts*detents
+
+    vk_encoder_accel_t _accel[VK_ENCODER_ACCEL_STEPS];
+    uint8_t _accelCount;
+
+    int32_t _residual;      // 相对当前档位中心的位移，单位为 counts*detents，避免除法带来的误差
+    int32_t _count;         // 累计输出步数
+};
@@ -0,0 +1,274 @@
+/**
+ * @file vk3809ip_energy.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip energy accounting model for power-save and polling strategies
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_energy.hpp"
+
+VK3809IPEnergy::VK3809IPEnergy()
+{
+  configure(defaultConfig(), true);
+}
+
+/**
+ * @brief 默认参数:
+ * 芯片电流取手册值；总线与主控电流为 ESP32-S3 从浅睡眠唤醒读取一次的粗略估计，应按实测修改
+ *
+ * @return vk_energy_config_t
+ */
+vk_energy_config_t VK3809IPEnergy::defaultConfig()
+{
+  vk_energy_config_t config;
+  config.chip_active_na = VK_ENERGY_CHIP_ACTIVE_NA;
+  config.chip_sleep_na = VK_ENERGY_CHIP_SLEEP_NA;
+  config.sleep_timeout_ms = VK_ENERGY_SLEEP_TIMEOUT_MS;
+  config.bus_na = 1000000;          // 4.7k 上拉在3.0V下约0.6mA×2，按占空比折算
+  config.host_na = 30000000;        // 主控运行读取代码约30mA
+  config.host_wake_us = 300;        // 浅睡眠唤醒、进入任务与再次睡眠
+  config.bus_hz = VK3809IP_DEFAULT_BUS_HZ;
+  return config;
+}
+
+/**
+ * @brief 设置模型参数并清零统计
+ *
+ * @param config 电流与时间参数
+ * @param power_save 与 settingCommandsDataByte1() 的 power_save_mode 一致
+ */
+void VK3809IPEnergy::configure(const vk_energy_config_t &config, bool power_save)
+{
+  _config = config;
+  if (_config.bus_hz == 0)
+  {
+    _config.bus_hz = VK3809IP_DEFAULT_BUS_HZ;
+  }
+  _powerSave = power_save;
+  reset(0);
+}
+
+/**
+ * @brief 清零统计，从 now 开始计时
+ *
+ * @param now 当前时间(us)
+ */
+void VK3809IPEnergy::reset(uint32_t now)
+{
+  _state = VK_POWER_ACTIVE;
+  _touching = false;
+  _lastTime = now;
+  _activeLeft = _sleepTimeoutUs();
+  for (int i = 0; i < VK_POWER_STATE_NUM; i++)
+  {
+    _stateTime[i] = 0;
+  }
+  _busTime = 0;
+  _reads = 0;
+  _wakeReads = 0;
+  _writes = 0;
+}
+
+/**
+ * @brief 累计到 now:
+ * 省电模式下没有触摸时，最后一次活动之后 sleep_timeout_ms 的时间记为工作，之后记为睡眠。
+ * 与上次的间隔按32位无符号差计算，计数器回绕不影响结果，间隔不能超过 VK_ENERGY_MAX_GAP_US
+ *
+ * @param now 当前时间(us)
+ */
+void VK3809IPEnergy::advance(uint32_t now)
+{
+  uint32_t dt = now - _lastTime;
+  if (dt == 0)
+  {
+    return;
+  }
+  if (!_powerSave || _touching)
+  {
+    _stateTime[VK_POWER_ACTIVE] += dt;
+    _state = VK_POWER_ACTIVE;
+  }
+  else
+  {
+    uint32_t active = (_activeLeft < dt) ? _activeLeft : dt;
+    _activeLeft -= active;
+    _stateTime[VK_POWER_ACTIVE] += active;
+    _stateTime[VK_POWER_SLEEP] += dt - active;
+    _state = (active < dt) ? VK_POWER_SLEEP : VK_POWER_ACTIVE;
+  }
+  _lastTime = now;
+}
+
+/**
+ * @brief 记录一次传输:
+ * 睡眠中的读取计为唤醒读取，并重新开始睡眠计时
+ *
+ * @param now 传输开始时间(us)
+ * @param nbytes 数据字节数
+ * @param write 是否为写入
+ */
+void VK3809IPEnergy::recordTransfer(uint32_t now, uint8_t nbytes, bool write)
+{
+  advance(now);
+  if (_state == VK_POWER_SLEEP)
+  {
+    _wakeReads++;
+    _state = VK_POWER_ACTIVE;
+    _activeLeft = _sleepTimeoutUs();
+  }
+  if (write)
+  {
+    _writes++;
+  }
+  else
+  {
+    _reads++;
+  }
+  _busTime += _transferUs(nbytes, write);
+}
+
+/**
+ * @brief 记录触摸状态变化，任意滑条或按键被触摸时芯片保持工作状态
+ *
+ * @param state 带时间戳的触摸状态
+ */
+void VK3809IPEnergy::recordState(const vk_touch_state_t &state)
+{
+  advance(state.timestamp);
+  bool touching = state.slider_touch != 0 || state.key_mask != 0;
+  if (touching || _touching)
+  {
+    _activeLeft = _sleepTimeoutUs();
+    _state = VK_POWER_ACTIVE;
+  }
+  _touching = touching;
+}
+
+/**
+ * @brief 记录一次状态帧读取与读到的状态，在每次 getTouchState() 之后调用
+ *
+ * @param state
+ */
+void VK3809IPEnergy::recordFrame(const vk_touch_state_t &state)
+{
+  recordTransfer(state.timestamp, VK3809IP_FRAME_LEN, false);
+  recordState(state);
+}
+
+uint64_t VK3809IPEnergy::getStateTime(vk_power_state_t state) const
+{
+  return (state < VK_POWER_STATE_NUM) ? _stateTime[state] : 0;
+}
+
+uint64_t VK3809IPEnergy::getElapsedTime() const
+{
+  return _stateTime[VK_POWER_ACTIVE] + _stateTime[VK_POWER_SLEEP];
+}
+
+/**
+ * @brief 某一来源累计的电荷
+ *
+ * @param source
+ * @return uint64_t nAh
+ */
+uint64_t VK3809IPEnergy::getChargeNah(vk_energy_source_t source) const
+{
+  return _chargeNaMs(source) / 3600000;
+}
+
+uint64_t VK3809IPEnergy::getTotalChargeNah() const
+{
+  uint64_t total = 0;
+  for (int i = 0; i < VK_ENERGY_SOURCE_NUM; i++)
+  {
+    total += _chargeNaMs((vk_energy_source_t)i);
+  }
+  return total / 3600000;
+}
+
+/**
+ * @brief 统计期间的平均电流:
+ * 各来源按 nA×ms 累加后只做一次除法，短时间统计不受 nAh 取整影响
+ *
+ * @return uint32_t nA
+ */
+uint32_t VK3809IPEnergy::getAverageCurrentNa() const
+{
+  uint64_t elapsed_ms = getElapsedTime() / 1000;
+  if (elapsed_ms == 0)
+  {
+    return 0;
+  }
+  uint64_t total = 0;
+  for (int i = 0; i < VK_ENERGY_SOURCE_NUM; i++)
+  {
+    total += _chargeNaMs((vk_energy_source_t)i);
+  }
+  return (uint32_t)(total / elapsed_ms);
+}
+
+/**
+ * @brief 按平均电流估算电池寿命，只计算触摸相关的电流
+ *
+ * @param capacity_mah 电池容量
+ * @return uint32_t 小时数，没有统计数据时返回0
+ */
+uint32_t VK3809IPEnergy::estimateBatteryHours(uint32_t capacity_mah) const
+{
+  uint32_t avg = getAverageCurrentNa();
+  if (avg == 0)
+  {
+    return 0;
+  }
+  return (uint32_t)((uint64_t)capacity_mah * 1000000 / avg);
+}
+
+/**
+ * @brief 某一来源累计的电荷，时间先换算成 ms，一年的工作时间乘以 mA 级电流也不会超出64位
+ *
+ * @param source
+ * @return uint64_t nA×ms
+ */
+uint64_t VK3809IPEnergy::_chargeNaMs(vk_energy_source_t source) const
+{
+  switch (source)
+  {
+  case VK_ENERGY_CHIP:
+    return _stateTime[VK_POWER_ACTIVE] / 1000 * _config.chip_active_na +
+           _stateTime[VK_POWER_SLEEP] / 1000 * _config.chip_sleep_na;
+  case VK_ENERGY_BUS:
+    return _busTime / 1000 * _config.bus_na;
+  case VK_ENERGY_HOST:
+    return ((uint64_t)(_reads + _writes) * _config.host_wake_us + _busTime) / 1000 * _config.host_na;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief 一次传输在总线上的时间，与 getTransferTimeout() 的时钟数一致(不含余量)
+ *
+ * @param nbytes
+ * @param write
+ * @return uint32_t us
+ */
+uint32_t VK3809IPEnergy::_transferUs(uint8_t nbytes, bool write) const
+{
+  uint32_t bytes = nbytes + (write ? 1 : 2);
+  uint32_t clocks = bytes * 9 + (write ? 2 : 4);
+  return (uint32_t)(((uint64_t)clocks * 1000000 + _config.bus_hz - 1) / _config.bus_hz);
+}
+
+/**
+ * @brief 进入睡眠前的工作时间，超出32位us时取上限
+ *
+ * @return uint32_t us
+ */
+uint32_t VK3809IPEnergy::_sleepTimeoutUs() const
+{
+  uint64_t us = (uint64_t)_config.sleep_timeout_ms * 1000;
+  return (us > VK_ENERGY_MAX_GAP_US) ? (uint32_t)VK_ENERGY_MAX_GAP_US : (uint32_t)us;
+}
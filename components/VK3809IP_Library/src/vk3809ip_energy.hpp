@@ -0,0 +1,114 @@
+/**
+ * @file vk3809ip_energy.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip energy accounting model for power-save and polling strategies
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+
+#define VK_ENERGY_CHIP_ACTIVE_NA 1100000    // 工作电流 1.1mA@3.0V
+#define VK_ENERGY_CHIP_SLEEP_NA 6800        // 静态电流 6.8uA@3.0V
+#define VK_ENERGY_SLEEP_TIMEOUT_MS 4000     // 省电模式下无按键4秒后进入睡眠
+
+/*
+    ! 模型假设：省电模式下芯片在最后一次触摸变化(或唤醒它的读取)之后 sleep_timeout_ms 进入睡眠，
+    ! 睡眠中的读取会唤醒芯片并重新开始计时；手指按住不动时保持工作状态。
+    ! 主控端每次读取计入唤醒开销与总线传输时间，电流值按板子实测修改 vk_energy_config_t。
+    ! 时间戳为32位us计数，允许回绕；两次调用之间的间隔按无符号差计算，最大为 VK_ENERGY_MAX_GAP_US(约71.5分钟)，
+    ! 时间戳不能倒退。长时间空闲时至少每隔该时间调用一次 advance()。
+*/
+
+#define VK_ENERGY_MAX_GAP_US 0xFFFFFFFFUL   // 两次调用之间允许的最大间隔
+
+/**
+ * @brief 芯片功耗状态
+ *
+ */
+typedef enum{
+    VK_POWER_ACTIVE,
+    VK_POWER_SLEEP,
+    VK_POWER_STATE_NUM,
+}vk_power_state_t;
+/**
+ * @brief 电流来源
+ *
+ */
+typedef enum{
+    VK_ENERGY_CHIP,                 // 芯片本身
+    VK_ENERGY_BUS,                  // 传输期间总线上拉与收发电流
+    VK_ENERGY_HOST,                 // 主控为读取而唤醒的开销
+    VK_ENERGY_SOURCE_NUM,
+}vk_energy_source_t;
+/**
+ * @brief 模型参数，电流单位 nA
+ *
+ */
+typedef struct{
+    uint32_t chip_active_na;
+    uint32_t chip_sleep_na;
+    uint32_t sleep_timeout_ms;
+    uint32_t bus_na;                // 传输期间的额外电流
+    uint32_t host_na;               // 主控为一次读取保持唤醒时的电流
+    uint32_t host_wake_us;          // 主控每次读取的唤醒与软件开销(不含传输时间)
+    uint32_t bus_hz;
+}vk_energy_config_t;
+
+/**************************************************************************/
+/*!
+    @brief 能耗统计模型:
+    按时间戳累计芯片在各功耗状态的时间、读取次数(其中唤醒芯片的次数)与总线传输时间，
+    随时换算成 nAh。只依赖输入的时间戳和状态，既可以在设备上实时统计，
+    也可以在主机上用录制的帧序列比较轮询、中断与省电模式的电池寿命。
+*/
+/**************************************************************************/
+class VK3809IPEnergy
+{
+public:
+    VK3809IPEnergy(void);
+
+    static vk_energy_config_t defaultConfig();
+    void configure(const vk_energy_config_t &config, bool power_save);
+    void reset(uint32_t now);
+
+    void recordTransfer(uint32_t now, uint8_t nbytes, bool write);
+    void recordState(const vk_touch_state_t &state);
+    void recordFrame(const vk_touch_state_t &state);
+    void advance(uint32_t now);
+
+    vk_power_state_t getPowerState() const { return _state; }
+    uint64_t getStateTime(vk_power_state_t state) const;
+    uint32_t getReadCount() const { return _reads; }
+    uint32_t getWakeReadCount() const { return _wakeReads; }
+    uint32_t getWriteCount() const { return _writes; }
+    uint64_t getBusTime() const { return _busTime; }
+    uint64_t getElapsedTime() const;
+
+    uint64_t getChargeNah(vk_energy_source_t source) const;
+    uint64_t getTotalChargeNah() const;
+    uint32_t getAverageCurrentNa() const;
+    uint32_t estimateBatteryHours(uint32_t capacity_mah) const;
+
+private:
+    uint64_t _chargeNaMs(vk_energy_source_t source) const;
+    uint32_t _transferUs(uint8_t nbytes, bool write) const;
+    uint32_t _sleepTimeoutUs() const;
+
+    vk_energy_config_t _config;
+    bool _powerSave;
+
+    vk_power_state_t _state;
+    bool _touching;
+    uint32_t _lastTime;             // 已累计到的时间点(us)
+    uint32_t _activeLeft;           // 距离进入睡眠还剩的工作时间(us)，触摸变化或唤醒芯片的读取时重新开始
+    uint64_t _stateTime[VK_POWER_STATE_NUM];
+    uint64_t _busTime;
+    uint32_t _reads;
+    uint32_t _wakeReads;
+    uint32_t _writes;
+};
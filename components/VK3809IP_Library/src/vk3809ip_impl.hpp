@@ -0,0 +1,816 @@
+/**
+ * @file vk3809ip_impl.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip driver template implementation, included by vk3809ip.hpp
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+#include "vk3809ip_log.hpp"
+
+template <class Transport>
+constexpr VK3809IPT<Transport>::VK3809IPT(Transport bus) : _bus(std::move(bus))
+{
+#if VK3809IP_RECOVERY
+  for (int i = 0; i < VK3809IP_TP_NUM; i++)
+  {
+    _tpThreshold[i] = VK3809IP_DEFAULT_THRESHOLD;
+  }
+#endif
+}
+
+/**
+ * @brief 初始化:
+ * 每次传输的超时由总线频率下的理论传输时间加上余量得到，避免一次卡死的传输阻塞整条总线
+ * 
+ * @param addr 
+ * @param bus_hz 总线频率，与 I2C_MASTER_FREQ_HZ 保持一致
+ * @return int 0 为成功，-1 为参数错误，-2 为默认配置写入失败(NACK或超时)
+ */
+template <class Transport>
+int VK3809IPT<Transport>::begin(uint8_t addr, uint32_t bus_hz)
+{
+  if (bus_hz == 0)
+    return -1;
+  _address = addr;
+  _busHz = bus_hz;
+  return init() ? 0 : -2;
+}
+
+/**
+ * @brief 写入默认配置
+ * 
+ * @return true 
+ * @return false 有配置包写入失败
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::init()
+{
+  // Default setting commands
+  uint8_t settingDataByte1 = settingCommandsDataByte1(
+      SLIDE_APP_MODE,
+      SETING_COMMANDS,
+      SINGLE,
+      AUTO_ADJUST_ENABALE,
+      POWER_SAVE_DISABLE,
+      DYNAMIC_THRESHOLD_DISABLE,
+      AOTO_RESTET_TIME_15S
+      );
+  uint8_t settingDataByte2 = settingCommandsDataByte2(
+      KEY_NUM_0_DISABLE,
+      KEY_ACK_TIME_4
+      );
+  uint8_t settingDataByte3 = settingCommandsDataByte3(
+      SLIDE_X_NUM_DISABLE,
+      SLIDE_X_NUM_9
+      );
+  uint8_t settingDataByte4 = settingCommandsDataByte4(
+      KEY_OFF_NUM_1_DISABLE,
+      SLIDE_X_NUM_DISABLE
+      );
+  bool ok = settingCommandsData(settingDataByte1, settingDataByte2, settingDataByte3, settingDataByte4);
+
+  // Default custom threshold commands
+  for (int i = TP_NUM_0; i <= TP_NUM_9; i++)
+  {
+    ok &= settingTpxThresholdData(16, (tpx_setting_number_t)i);
+  }
+  
+  // Default sleep threshold Setting
+  ok &= settingSleepThresholdData(2);
+
+  return ok;
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP write function.
+*/
+/**************************************************************************/
+
+template <class Transport>
+uint8_t VK3809IPT<Transport>::settingCommandsDataByte1(
+    i2c_data_mode_t i2c_data_mode_slide,
+    custom_threshold_t custom_threshold_set,
+    key_output_mode_t key_output_mode,
+    aoto_adjust_en_t aoto_adjust,
+    power_save_mode_en_t power_save_mode,
+    dynamic_threshold_en_t dynamic_threshold,
+    aoto_reset_time_t aoto_reset_time)
+{
+  uint8_t setbyte1 = 0B00000000;
+
+  // 设置 setbyte1 命令
+  setbyte1 |= (i2c_data_mode_slide << 7);     // bit 7
+  setbyte1 |= (custom_threshold_set << 6);  // bit 6
+  setbyte1 |= (key_output_mode << 5);   // bit 5
+  setbyte1 |= (aoto_adjust << 4);       // bit 4
+  setbyte1 |= (power_save_mode << 3);   // bit 3
+  setbyte1 |= (dynamic_threshold << 2); // bit 2
+  setbyte1 |= aoto_reset_time;          // bit 1-0
+
+  return setbyte1;
+}
+template <class Transport>
+uint8_t VK3809IPT<Transport>::settingCommandsDataByte2(
+    key_number_t key_number,
+    key_acknowledge_times_t key_acknowledge_times)
+{
+  uint8_t setbyte2 = 0B00000000;
+
+  // 设置 setbyte2 命令
+  setbyte2 |= (key_number << 3);            // bit 7-3
+  setbyte2 |= key_acknowledge_times;        // bit 2-0
+
+  return setbyte2;
+}
+template <class Transport>
+uint8_t VK3809IPT<Transport>::settingCommandsDataByte3(
+        slide_x_number_t  slide_2_number,
+        slide_x_number_t slide_1_number)
+{
+  uint8_t setbyte3 = 0B00000000;
+
+  // 设置 setbyte3 命令
+  setbyte3 |= (slide_2_number << 4);            // bit 7-4
+  setbyte3 |= slide_1_number;             // bit 3-0
+
+  return setbyte3;
+}
+template <class Transport>
+uint8_t VK3809IPT<Transport>::settingCommandsDataByte4(
+    key_off_number_t  key_off_number,
+    slide_x_number_t slide_3_number)
+{
+  uint8_t setbyte4 = 0B00000000;
+
+  // 设置 setbyte4 命令
+  setbyte4 |= (key_off_number << 4);            // bit 7-4
+  setbyte4 |= slide_3_number; // bit 3-0
+
+  return setbyte4;
+}
+/**
+ * @brief 应用模式命令设置:
+ * 写入成功后才记录为当前配置(用于解码与重置恢复)，失败时保持原配置
+ * 
+ * @param DataByte1 
+ * @param DataByte2 
+ * @param DataByte3 
+ * @param DataByte4 
+ * @return true 
+ * @return false 写入失败(NACK或超时)
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::settingCommandsData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4)
+{
+  if (!writeFourByteData(DataByte1, DataByte2, DataByte3, DataByte4))
+  {
+    return VK_FAIL;
+  }
+  _settingData[0] = DataByte1;
+  _settingData[1] = DataByte2;
+  _settingData[2] = DataByte3;
+  _settingData[3] = DataByte4;
+#if VK3809IP_RECOVERY
+  _configStored = true;
+#endif
+#if VK3809IP_LAYOUT
+  _layout.configure(DataByte2, DataByte3, DataByte4);
+#endif
+  return VK_PASS;
+}
+
+/**
+ * @brief 按键阈值设定:
+ * 按键承认阀值越小灵敏度越高，越大灵敏度越低。预设的阀值为010H，建议的最小值为008H，若
+ * 调整到008H按键灵敏度仍然不够，则建议加大CS电容，CS电容的值则建议小于39nF
+ * 
+ * @param thresholdValue 按键承认阀值(Define : 010H) 
+ * @param tpNum 按键键值
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::settingTpxThresholdData(uint16_t thresholdValue, tpx_setting_number_t tpNum)
+{
+    // 确保 thresholdValue 是三位十进制数的范围
+    if (thresholdValue <= 8) {
+        thresholdValue = 8;
+    }else if(thresholdValue >= 999) {
+        thresholdValue = 999;
+    }
+    // 构造 byte2 和 byte3
+    uint8_t data[3];
+    data[0] = tpNum;
+    encodeThresholdData(thresholdValue, &data[1]);
+    if (!writeThreeByteData(data[0], data[1], data[2]))
+    {
+        return VK_FAIL;
+    }
+#if VK3809IP_RECOVERY
+    _tpThreshold[tpNum - TP_NUM_0] = thresholdValue;
+#endif
+    return VK_PASS;
+}
+
+/**
+ * @brief 阈值编码:
+ * 12位阈值按手册的排列写入 Byte2、Byte3，Byte2 高4位为 bit7~4、低4位为 bit11~8，
+ * Byte3 高4位为 bit3~0
+ * 
+ * @param thresholdValue 阈值(0~999)
+ * @param data 输出2字节
+ */
+template <class Transport>
+void VK3809IPT<Transport>::encodeThresholdData(uint16_t thresholdValue, uint8_t *data)
+{
+    data[0] = (uint8_t)((((thresholdValue >> 4) & 0x0F) << 4) | ((thresholdValue >> 8) & 0x0F));
+    data[1] = (uint8_t)((thresholdValue & 0x0F) << 4);
+}
+
+/**
+ * @brief 睡眠唤醒阀值设定
+ * 
+ * @param thresholdValue 省电模式唤醒阀值(Define : 002H) 
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::settingSleepThresholdData(uint16_t thresholdValue)
+{
+    if (thresholdValue <= 0) {
+        thresholdValue = 0;
+    }else if(thresholdValue >= 999) {
+        thresholdValue = 999;
+    }
+    uint8_t data[3];
+    data[0] = 0xD0;
+    encodeThresholdData(thresholdValue, &data[1]);
+    if (!writeThreeByteData(data[0], data[1], data[2]))
+    {
+        return VK_FAIL;
+    }
+#if VK3809IP_RECOVERY
+    _sleepThreshold = thresholdValue;
+#endif
+    return VK_PASS;
+}
+
+#if VK3809IP_PROFILE
+/**
+ * @brief 预先生成一套运行环境配置:
+ * 应用设定用 settingCommandsDataByte1~4 生成，阈值在这里一次编码好，切换时不再计算
+ * 
+ * @param profile 
+ * @param name 配置名
+ * @param DataByte1 
+ * @param DataByte2 
+ * @param DataByte3 
+ * @param DataByte4 
+ * @param thresholds TP0~TP9 按键阈值，nullptr 时全部为出厂值
+ * @param sleepThreshold 唤醒阈值
+ */
+template <class Transport>
+void VK3809IPT<Transport>::buildProfile(vk_profile_t *profile, const char *name,
+                            uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4,
+                            const uint16_t *thresholds, uint16_t sleepThreshold)
+{
+    profile->name = name;
+    profile->setting[0] = DataByte1;
+    profile->setting[1] = DataByte2;
+    profile->setting[2] = DataByte3;
+    profile->setting[3] = DataByte4;
+    for (int i = 0; i < VK3809IP_TP_NUM; i++)
+    {
+        uint16_t value = (thresholds != nullptr) ? thresholds[i] : VK3809IP_DEFAULT_THRESHOLD;
+        value = (value <= 8) ? 8 : (value >= 999) ? 999 : value;
+        profile->threshold[i] = value;
+        profile->threshold_packet[i][0] = (uint8_t)(TP_NUM_0 + i);
+        encodeThresholdData(value, &profile->threshold_packet[i][1]);
+    }
+    profile->sleep_threshold = (sleepThreshold >= 999) ? 999 : sleepThreshold;
+    profile->sleep_packet[0] = 0xD0;
+    encodeThresholdData(profile->sleep_threshold, &profile->sleep_packet[1]);
+}
+/**
+ * @brief 切换运行环境配置:
+ * 每写入一个配置包芯片都会重置一次，所以只写入与当前配置不同的包。阈值包在前，应用设定
+ * 在最后，芯片最后一次重置后直接以新的模式完成校正。校正完成前的帧不会上报，
+ * 完成后可以用 getLastSwitchLatency() 查询从切换到可用的时间
+ * 
+ * @param profile buildProfile() 生成的配置
+ * @return int 写入的配置包数量，0 表示与当前配置相同；-1 表示有配置包写入失败，
+ * 失败的包不记为已生效，再次调用时重写
+ */
+template <class Transport>
+int VK3809IPT<Transport>::applyProfile(const vk_profile_t *profile)
+{
+  int packets = 0;
+  bool ok = true;
+  uint32_t start = (_time_cb != nullptr) ? _time_cb() : 0;
+
+  for (int i = 0; i < VK3809IP_TP_NUM; i++)
+  {
+    if (profile->threshold[i] != _tpThreshold[i])
+    {
+      const uint8_t *packet = profile->threshold_packet[i];
+      if (writeThreeByteData(packet[0], packet[1], packet[2]))
+      {
+        _tpThreshold[i] = profile->threshold[i];
+      }
+      else
+      {
+        ok = false;
+      }
+      packets++;
+    }
+  }
+  if (profile->sleep_threshold != _sleepThreshold)
+  {
+    const uint8_t *packet = profile->sleep_packet;
+    if (writeThreeByteData(packet[0], packet[1], packet[2]))
+    {
+      _sleepThreshold = profile->sleep_threshold;
+    }
+    else
+    {
+      ok = false;
+    }
+    packets++;
+  }
+  if (!_configStored || memcmp(profile->setting, _settingData, sizeof(_settingData)) != 0)
+  {
+    ok &= settingCommandsData(profile->setting[0], profile->setting[1], profile->setting[2], profile->setting[3]);
+    packets++;
+  }
+
+  _profile = profile;
+  if (packets != 0)
+  {
+    _resetArmed = false;
+    _recovering = true;
+    _switching = true;
+    _recoveryStart = start;
+    _reapplyAttempts = 0;
+    _reapplyOk = ok;
+    _settleFrames = 0;
+    _sawCalibration = false;
+  }
+  return ok ? packets : -1;
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP read function.
+*/
+/**************************************************************************/
+
+/**
+ * @brief 系统校正标志:
+ * 当值为0时，表示系统校正中，键值读取无效。当值为1时，键值有效。
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::getSystemCorrectionFlagState()
+{
+  _readFrame();
+  return (bool)extractBits(_raw[0], 7, 1);
+}
+/**
+ * @brief 系统写入标志:
+ * 上电为1，写入设定后该标志设置为0。
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::getSystemWriteFlagState()
+{
+  _readFrame();
+  return (bool)extractBits(_raw[0], 6, 1);
+}
+/**
+ * @brief 滑条触摸标志:
+ * 无触摸时为0，有触摸时为1
+ * @param sliderNum 
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::getSliderPressedState(slider_x_touch_state_t sliderNum)
+{
+  _readFrame();
+  return (bool)extractBits(_frame[0], sliderNum, 1);
+}
+/**
+ * @brief 触摸按键标志:
+ * 无按键为0，有按键为1
+ * @param keyNum 
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::getKeyPressedState(key_number_t keyNum)
+{
+  _readFrame();
+  // return (bool)extractBits(_frame[1], keyNum - 1, 1);
+  return (keyNum == KEY_NUM_9) ? ((bool)extractBits(_frame[2], 0, 1)) : ((bool)extractBits(_frame[1], keyNum - 1, 1));
+}
+/**
+ * @brief 滑条位置标志:
+ * 预设为0，触摸滑条后输出按键位置，放开后保留最后按压位置
+ * @param position 
+ * @return uint16_t 
+ */
+template <class Transport>
+uint16_t VK3809IPT<Transport>::getSliderData(slider_x_position_t position)
+{
+  _readFrame();
+  return _frame[position];
+}
+/**
+ * @brief byte转换成bit
+ * 调试时候用的
+ * @param byte 
+ */
+template <class Transport>
+void VK3809IPT<Transport>::print_byte_as_binary(uint8_t byte) {
+    for (int i = 7; i >= 0; i--) {
+        printf("%c", (byte & (1 << i)) ? '1' : '0');
+    }
+}
+/**
+ * @brief 读寄存器的所有值:
+ * delete[] data; // 记得在使用完毕后释放动态分配的内存
+ * @return uint8_t* 
+ */
+template <class Transport>
+uint8_t* VK3809IPT<Transport>::getAllData()
+{
+  // uint8_t data[6];
+  uint8_t* data = new uint8_t[6]; // 动态分配 6 个字节的空间
+  _readByte(sizeof(data), data);
+  return data;
+}
+
+/**
+ * @brief 读取一帧状态:
+ * 每次读取都会顺带检查写入标志，检测到芯片意外重置时自动重新写入配置，
+ * 校正完成前的帧不会更新到 getFrame() 中
+ * @return true 帧有效
+ * @return false 读取失败或芯片正在重置恢复
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::updateFrame()
+{
+  return _readFrame();
+}
+#if VK3809IP_LAYOUT
+/**
+ * @brief 读取全部滑条与按键状态:
+ * 一次总线读取得到所有已启用滑条的触摸标志与位置以及所有普通按键，
+ * 不会因为滑条1被触摸而丢掉滑条2
+ * 
+ * @param state 
+ * @param refresh false 时直接解码缓存的最近一帧，不读总线
+ * @return true 帧有效
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::getTouchState(vk_touch_state_t *state, bool refresh)
+{
+#if VK3809IP_RECOVERY
+  bool valid = refresh ? _readFrame() : !_recovering;
+#else
+  bool valid = refresh ? _readFrame() : true;
+#endif
+  _layout.decode(_frame, state);
+  state->timestamp = _frameTime;
+  return valid;
+}
+#endif
+#if VK3809IP_KEYMASK
+/**
+ * @brief 读取按键掩码:
+ * 一次读取得到全部普通按键，bit0~bit8 对应 Key1~Key9，未启用的按键恒为0。
+ * 读取后可以用 getKeysPressed()/getKeysReleased()/getKeysHeld() 得到与上一帧相比
+ * 新按下、新松开、持续按下的按键，这三个接口不会读总线
+ * 
+ * @param refresh false 时返回缓存的最近一帧，不读总线
+ * @return uint16_t 
+ */
+template <class Transport>
+uint16_t VK3809IPT<Transport>::getKeyMask(bool refresh)
+{
+  if (refresh)
+  {
+    _readFrame();
+  }
+  return _keyMask;
+}
+#endif
+/**
+ * @brief 切换IIC数据模式:
+ * 只修改应用设定 Byte1 的 bit7 并重新写入，其它设定保持不变。PC link 模式下状态帧格式不同，
+ * 暂停写入标志监测，需要用 readRawData() 读取
+ * 
+ * @param mode `PC_LINK_MODE` 或 `SLIDE_APP_MODE`
+ * @return true 
+ * @return false 
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::setDataMode(i2c_data_mode_t mode)
+{
+#if VK3809IP_RECOVERY
+  _resetArmed = false;
+  _recovering = false;
+#endif
+#if VK3809IP_PROFILE
+  _switching = false;
+#endif
+  return settingCommandsData((uint8_t)((_settingData[0] & 0x7F) | (mode << 7)),
+                             _settingData[1], _settingData[2], _settingData[3]);
+}
+/**
+ * @brief 直接读取原始数据:
+ * 一次传输读取 len 字节，不做写入标志检查与解码，PC link 模式下读取通道计数使用
+ * 
+ * @param data 
+ * @param len 
+ * @return int 0 为成功
+ */
+template <class Transport>
+int VK3809IPT<Transport>::readRawData(uint8_t *data, uint8_t len)
+{
+  return _readByte(len, data);
+}
+#if VK3809IP_RECOVERY
+/**
+ * @brief 注册芯片意外重置回调
+ * 
+ * @param reset_cb 
+ * @param arg 回调透传参数
+ */
+template <class Transport>
+void VK3809IPT<Transport>::setResetCallback(vk_reset_cb_t reset_cb, void *arg)
+{
+  _reset_cb = reset_cb;
+  _reset_arg = arg;
+}
+#endif
+/**
+ * @brief 设置传输超时余量:
+ * 状态帧读取在输入路径上，余量尽量小；配置包写入不频繁，可以给大一些
+ * 
+ * @param read_slack_us 状态帧读取余量(Define : 2ms)
+ * @param write_slack_us 配置包写入余量(Define : 5ms)
+ */
+template <class Transport>
+void VK3809IPT<Transport>::setTransferBudget(uint32_t read_slack_us, uint32_t write_slack_us)
+{
+  _readSlack = read_slack_us;
+  _writeSlack = write_slack_us;
+}
+/**
+ * @brief 计算一次传输的超时时间:
+ * 每字节9个时钟(8位数据+ACK)，另加地址字节与起始/停止条件。读取时端口会先单独发送一次地址，
+ * 所以按两次寻址计算
+ * 
+ * @param nbytes 数据字节数
+ * @param write 是否为写入
+ * @return uint32_t 超时时间(us)
+ */
+template <class Transport>
+uint32_t VK3809IPT<Transport>::getTransferTimeout(uint8_t nbytes, bool write) const
+{
+  uint32_t bytes = nbytes + (write ? 1 : 2);
+  uint32_t clocks = bytes * 9 + (write ? 2 : 4);
+  uint32_t wire_us = (uint32_t)(((uint64_t)clocks * 1000000 + _busHz - 1) / _busHz);
+  return wire_us + (write ? _writeSlack : _readSlack);
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP port function.
+*/
+/**************************************************************************/
+
+/**
+ * @brief 从一个字节中截取指定的位段
+ * 
+ * @param byte 要截取的字节
+ * @param start_bit 目标开始位
+ * @param num_bits 截取位数
+ * @return uint8_t 
+ */
+template <class Transport>
+uint8_t VK3809IPT<Transport>::extractBits(uint8_t byte, int startBit, int numBits) {
+    // 计算掩码
+    uint8_t mask = (1 << numBits) - 1; // 生成指定长度的全1掩码
+    mask <<= startBit;                 // 将掩码移到起始位
+    // 使用掩码提取位段并右移到最低位
+    return (uint8_t)((byte & mask) >> startBit);
+}
+
+template <class Transport>
+bool VK3809IPT<Transport>::_readFrame()
+{
+  if (_readByte(sizeof(_raw), _raw) != 0)
+  {
+    return false;
+  }
+  if (getDataMode() == PC_LINK_MODE)
+  {
+    return false;
+  }
+#if VK3809IP_RECOVERY
+  _checkFrameState();
+  if (_recovering)
+  {
+    return false;
+  }
+#endif
+  if (!extractBits(_raw[0], 7, 1))
+  {
+    return false;
+  }
+  memcpy(_frame, _raw, sizeof(_frame));
+  _frameTime = (_time_cb != nullptr) ? _time_cb() : 0;
+#if VK3809IP_KEYMASK
+  _updateKeyMask();
+#endif
+  return true;
+}
+
+#if VK3809IP_KEYMASK
+template <class Transport>
+void VK3809IPT<Transport>::_updateKeyMask()
+{
+  _prevKeyMask = _keyMask;
+  _keyMask = (uint16_t)(_frame[1] | ((_frame[2] & 0x01) << 8)) & _layout.getKeyMask();
+}
+#endif
+
+#if VK3809IP_RECOVERY
+
+/**
+ * @brief 写入标志监测:
+ * 配置生效(写入标志为0)后开始监测，之后写入标志重新变为1说明芯片被重置回出厂设置
+ */
+template <class Transport>
+void VK3809IPT<Transport>::_checkFrameState()
+{
+  bool corrected = extractBits(_raw[0], 7, 1);
+  bool writeFlag = extractBits(_raw[0], 6, 1);
+
+  if (_recovering)
+  {
+    if (corrected && !writeFlag)
+    {
+      uint32_t elapsed = (_time_cb != nullptr) ? _time_cb() - _recoveryStart : 0;
+      _recovering = false;
+      _resetArmed = true;
+      _recoveryFailed = false;
+#if VK3809IP_PROFILE
+      if (_switching)
+      {
+        _switching = false;
+        _lastSwitchLatency = elapsed;
+        return;
+      }
+#endif
+      _lastRecoveryTime = elapsed;
+      VK_LOGI("vk3809ip recovered in %" PRIu32 " us\n", elapsed);
+      return;
+    }
+    if (!corrected)
+    {
+      _sawCalibration = true;
+    }
+    else if (_settleFrames < VK3809IP_REAPPLY_SETTLE)
+    {
+      _settleFrames++;
+    }
+    // 写入失败，或芯片校正完成(或等待足够帧数)后写入标志仍为1，说明配置没有生效(例如写在芯片启动过程中)
+    if (!_reapplyOk || (corrected && writeFlag && (_sawCalibration || _settleFrames >= VK3809IP_REAPPLY_SETTLE)))
+    {
+      if (_reapplyAttempts < VK3809IP_REAPPLY_RETRIES)
+      {
+        _reapplyAttempts++;
+        VK_LOGW("vk3809ip config not applied, retry %u\n", _reapplyAttempts);
+        _reapplyConfig();
+      }
+      else
+      {
+        // 放弃恢复，之后的帧按出厂配置上报，isRecoveryFailed() 为 true
+        _recovering = false;
+#if VK3809IP_PROFILE
+        _switching = false;
+#endif
+        _recoveryFailed = true;
+        VK_LOGE("vk3809ip config re-apply failed after %u retries\n", _reapplyAttempts);
+      }
+    }
+    return;
+  }
+
+  if (!_resetArmed)
+  {
+    _resetArmed = _configStored && !writeFlag;
+    return;
+  }
+
+  if (writeFlag)
+  {
+    _resetArmed = false;
+    _recovering = true;
+    _resetCount++;
+    _recoveryStart = (_time_cb != nullptr) ? _time_cb() : 0;
+    VK_LOGW("vk3809ip unexpected reset #%" PRIu32 ", re-applying config\n", _resetCount);
+    // 重置期间上报为无触摸
+    _frame[0] &= 0B11111000;
+    _frame[1] = 0;
+    _frame[2] &= 0B11111110;
+#if VK3809IP_KEYMASK
+    _updateKeyMask();
+#endif
+    _reapplyAttempts = 0;
+    _reapplyConfig();
+    if (_reset_cb != nullptr)
+    {
+      _reset_cb(_resetCount, _reset_arg);
+    }
+  }
+}
+
+/**
+ * @brief 重置后的最小写入序列:
+ * 芯片重置后阈值已回到出厂值，只需要重写非出厂值的阈值与应用设定。与 applyProfile() 顺序相同，
+ * 阈值在前、应用设定在最后：每个配置包都会使芯片重置一次，写入标志由应用设定清零，
+ * 所以看到 校正完成且写入标志为0 时前面的阈值包一定已经写入，芯片也以最终配置完成了校正
+ * 
+ * @return true 全部配置包写入成功(芯片是否生效由之后的帧确认)
+ */
+template <class Transport>
+bool VK3809IPT<Transport>::_reapplyConfig()
+{
+  bool ok = true;
+  for (int i = 0; i < VK3809IP_TP_NUM; i++)
+  {
+    if (_tpThreshold[i] != VK3809IP_DEFAULT_THRESHOLD)
+    {
+      ok &= settingTpxThresholdData(_tpThreshold[i], (tpx_setting_number_t)(TP_NUM_0 + i));
+    }
+  }
+  if (_sleepThreshold != VK3809IP_DEFAULT_SLEEP_THRESHOLD)
+  {
+    ok &= settingSleepThresholdData(_sleepThreshold);
+  }
+  ok &= settingCommandsData(_settingData[0], _settingData[1], _settingData[2], _settingData[3]);
+  _reapplyOk = ok;
+  _settleFrames = 0;
+  _sawCalibration = false;
+  return ok;
+}
+#endif
+
+template <class Transport>
+bool VK3809IPT<Transport>::writeThreeByteData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3)
+{
+  uint8_t settingData[] = {DataByte1, DataByte2, DataByte3};
+  return (_writeByte(sizeof(settingData), settingData) == 0) ? VK_PASS : VK_FAIL;
+}
+template <class Transport>
+bool VK3809IPT<Transport>::writeFourByteData(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4)
+{
+  uint8_t settingData[] = {DataByte1, DataByte2, DataByte3, DataByte4};
+  return (_writeByte(sizeof(settingData), settingData) == 0) ? VK_PASS : VK_FAIL;
+}
+
+template <class Transport>
+int VK3809IPT<Transport>::_readByte(uint8_t nbytes, uint8_t *data)
+{
+  int ret = _bus.read(_address, data, nbytes, getTransferTimeout(nbytes, false));
+  if (ret != 0)
+  {
+    _busErrorCount++;
+  }
+  return ret;
+}
+template <class Transport>
+int VK3809IPT<Transport>::_writeByte(uint8_t nbytes, uint8_t *data)
+{
+  int ret = _bus.write(_address, data, nbytes, getTransferTimeout(nbytes, true));
+  if (ret != 0)
+  {
+    _busErrorCount++;
+  }
+  return ret;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file vk3809ip_linux.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip Linux userspace i2c-dev transport and GPIO interrupt line
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_linux.hpp"
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+int vk_linux_ioctl(int fd, unsigned long request, void *arg)
+{
+    return ioctl(fd, request, arg);
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP i2c-dev transport.
+*/
+/**************************************************************************/
+
+/**
+ * @brief 打开 i2c-dev 设备:
+ * 超时以10ms为单位写入 I2C_TIMEOUT，并关闭适配器重试，失败的传输交给驱动的错误计数处理。
+ * 任一设置失败时关闭设备，fd 保持为 -1
+ *
+ * @param dev 例如 "/dev/i2c-1"
+ * @param timeout_ms 每次传输的超时
+ * @return int 0 成功，否则为 -errno
+ */
+int VKLinuxI2CTransport::open(const char *dev, uint32_t timeout_ms)
+{
+    close();
+    fd = ::open(dev, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+    unsigned long timeout = (timeout_ms + 9) / 10;
+    if (ioctl_cb(fd, I2C_TIMEOUT, (void *)timeout) < 0 || ioctl_cb(fd, I2C_RETRIES, (void *)0UL) < 0)
+    {
+        int err = errno;
+        close();
+        return (err != 0) ? -err : -EIO;
+    }
+    return 0;
+}
+
+void VKLinuxI2CTransport::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP GPIO interrupt line.
+*/
+/**************************************************************************/
+
+/**
+ * @brief 申请 INT 脚位的下降沿事件
+ *
+ * @param chip 例如 "/dev/gpiochip0"
+ * @param line 该 gpiochip 内的脚位偏移
+ * @param consumer 在 gpioinfo 中显示的使用者名称
+ * @return int 0 成功，否则为 -errno
+ */
+int VKLinuxGpioInt::open(const char *chip, uint32_t line, const char *consumer)
+{
+    close();
+    int chip_fd = ::open(chip, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0)
+    {
+        return -errno;
+    }
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    strncpy(req.consumer, consumer, sizeof(req.consumer) - 1);
+    int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    int err = errno;
+    ::close(chip_fd);
+    if (ret < 0)
+    {
+        return -err;
+    }
+    _fd = req.fd;
+    return 0;
+}
+
+void VKLinuxGpioInt::close()
+{
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+/**
+ * @brief 等待下降沿:
+ * 一次读出所有已排队的事件，连续多次中断合并为一次唤醒
+ *
+ * @param timeout_ms 超时，-1 为一直等待
+ * @return int 本次读出的事件数，0 为超时，负数为 -errno
+ */
+int VKLinuxGpioInt::wait(int timeout_ms)
+{
+    if (_fd < 0)
+    {
+        return -EBADF;
+    }
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0)
+    {
+        return (ret < 0) ? -errno : 0;
+    }
+    struct gpio_v2_line_event events[8];
+    ssize_t n = ::read(_fd, events, sizeof(events));
+    if (n < 0)
+    {
+        return -errno;
+    }
+    int count = (int)(n / sizeof(events[0]));
+    _eventCount += count;
+    return count;
+}
+
+#endif // __linux__ && !ESP_PLATFORM
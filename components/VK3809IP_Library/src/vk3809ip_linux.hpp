@@ -0,0 +1,124 @@
+/**
+ * @file vk3809ip_linux.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip Linux userspace i2c-dev transport and GPIO interrupt line
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "vk3809ip_transport.hpp"
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+
+#include <errno.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/*
+    ! 每次状态帧读取与每个配置包写入都只用一次 I2C_RDWR ioctl，消息结构体预先分配在传输对象内。
+    ! 内核 i2c-dev 不支持逐次传输的超时，timeout_us 被忽略，超时在 open() 时用 I2C_TIMEOUT 统一设置。
+*/
+
+/**
+ * @brief ioctl 接口，默认为系统调用，测试时可以替换为模拟芯片
+ */
+typedef int (*vk_ioctl_fptr_t)(int fd, unsigned long request, void *arg);
+
+int vk_linux_ioctl(int fd, unsigned long request, void *arg);
+
+/**************************************************************************/
+/*!
+    @brief Linux /dev/i2c-N 传输:
+    用法 VK3809IPT<VKLinuxI2CTransport> touch; touch.getTransport().open("/dev/i2c-1"); touch.begin();
+    对象持有打开的设备，析构时关闭；只能移动，不能复制。
+*/
+/**************************************************************************/
+struct VKLinuxI2CTransport
+{
+    VKLinuxI2CTransport() = default;
+    VKLinuxI2CTransport(const VKLinuxI2CTransport &) = delete;
+    VKLinuxI2CTransport &operator=(const VKLinuxI2CTransport &) = delete;
+    VKLinuxI2CTransport(VKLinuxI2CTransport &&other) noexcept
+        : fd(other.fd), ioctl_cb(other.ioctl_cb), ioctlCount(other.ioctlCount)
+    {
+        other.fd = -1;
+    }
+    VKLinuxI2CTransport &operator=(VKLinuxI2CTransport &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            fd = other.fd;
+            ioctl_cb = other.ioctl_cb;
+            ioctlCount = other.ioctlCount;
+            other.fd = -1;
+        }
+        return *this;
+    }
+    ~VKLinuxI2CTransport() { close(); }
+
+    int fd = -1;
+    vk_ioctl_fptr_t ioctl_cb = vk_linux_ioctl;
+    uint32_t ioctlCount = 0;            // 系统调用次数，用于统计每帧开销
+    struct i2c_msg msg = {};
+    struct i2c_rdwr_ioctl_data xfer = {};
+
+    int open(const char *dev, uint32_t timeout_ms = 100);
+    void close();
+
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)timeout_us;
+        return _transfer(dev_addr, I2C_M_RD, data, len);
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)timeout_us;
+        return _transfer(dev_addr, 0, data, len);
+    }
+
+    int _transfer(uint8_t dev_addr, uint16_t flags, uint8_t *data, uint8_t len)
+    {
+        msg.addr = dev_addr;
+        msg.flags = flags;
+        msg.len = len;
+        msg.buf = data;
+        // 对象可能被移动，每次都重新指向自身的消息
+        xfer.msgs = &msg;
+        xfer.nmsgs = 1;
+        ioctlCount++;
+        int ret = ioctl_cb(fd, I2C_RDWR, &xfer);
+        return (ret == 1) ? 0 : ((ret < 0) ? -errno : -EIO);
+    }
+};
+
+/**************************************************************************/
+/*!
+    @brief INT 脚位(GPIO 字符设备，下降沿事件):
+    wait() 阻塞到下一次下降沿或超时，替代 ESP-IDF 例程中的GPIO中断与队列。
+*/
+/**************************************************************************/
+class VKLinuxGpioInt
+{
+public:
+    VKLinuxGpioInt() = default;
+    VKLinuxGpioInt(const VKLinuxGpioInt &) = delete;
+    VKLinuxGpioInt &operator=(const VKLinuxGpioInt &) = delete;
+    ~VKLinuxGpioInt() { close(); }
+
+    int open(const char *chip, uint32_t line, const char *consumer = "vk3809ip");
+    void close();
+    int wait(int timeout_ms);
+    int getFd() const { return _fd; }
+    uint32_t getEventCount() const { return _eventCount; }
+
+private:
+    int _fd = -1;
+    uint32_t _eventCount = 0;
+};
+
+#endif // __linux__ && !ESP_PLATFORM
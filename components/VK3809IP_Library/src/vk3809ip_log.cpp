@@ -0,0 +1,152 @@
+/**
+ * @file vk3809ip_log.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip deferred-format logging for the input hot path
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include <atomic>
+#include <stdio.h>
+#include "vk3809ip.hpp"
+#include "vk3809ip_log.hpp"
+
+/*
+    多个任务同时写入的有界无锁队列：写入方用CAS抢占写入位置。base 为 pos 所在一圈的起点，
+    槽位 seq == base 时可写，seq == base + 1 时可读，读出后置为下一圈的 base。
+    seq 全部为0即为初始状态，不需要初始化。
+*/
+struct vk_log_slot_t
+{
+    std::atomic<uint32_t> seq;
+    vk_log_entry_t entry;
+};
+
+static vk_log_slot_t vk_log_slots[VK_LOG_DEPTH];
+static std::atomic<uint32_t> vk_log_head(0);
+static std::atomic<uint32_t> vk_log_tail(0);
+static std::atomic<uint32_t> vk_log_dropped(0);
+static vk_log_time_fptr_t vk_log_time_cb = nullptr;
+
+/**
+ * @brief 设置日志时间戳来源
+ * 
+ * @param time_cb 
+ */
+void vk_log_set_time_source(vk_log_time_fptr_t time_cb)
+{
+    vk_log_time_cb = time_cb;
+}
+
+/**
+ * @brief 记录一条日志:
+ * 不格式化、不加锁、不阻塞，缓冲满时丢弃并计数。由 VK_LOGx 宏调用
+ * 
+ * @param level 
+ * @param fmt 格式字符串字面量
+ * @param nargs 参数个数
+ * @param args 
+ * @return true 
+ * @return false 缓冲已满
+ */
+bool vk_log_record(uint8_t level, const char *fmt, uint8_t nargs, const uintptr_t *args)
+{
+    static_assert((VK_LOG_DEPTH & (VK_LOG_DEPTH - 1)) == 0, "VK_LOG_DEPTH must be a power of 2");
+    uint32_t pos = vk_log_head.load(std::memory_order_relaxed);
+    vk_log_slot_t *slot;
+    for (;;)
+    {
+        slot = &vk_log_slots[pos & (VK_LOG_DEPTH - 1)];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - (pos & ~(uint32_t)(VK_LOG_DEPTH - 1)));
+        if (diff == 0)
+        {
+            if (vk_log_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            vk_log_dropped.fetch_add(1, std::memory_order_relaxed);
+            return VK_FAIL;
+        }
+        else
+        {
+            pos = vk_log_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->entry.fmt = fmt;
+    slot->entry.timestamp = (vk_log_time_cb != nullptr) ? vk_log_time_cb() : 0;
+    slot->entry.level = level;
+    slot->entry.nargs = nargs;
+    for (uint8_t i = 0; i < nargs; i++)
+    {
+        slot->entry.args[i] = args[i];
+    }
+    slot->seq.store((pos & ~(uint32_t)(VK_LOG_DEPTH - 1)) + 1, std::memory_order_release);
+    return VK_PASS;
+}
+
+/**
+ * @brief 格式化并输出缓冲中的日志:
+ * 在空闲或低优先级任务中调用，只允许一个任务调用
+ * 
+ * @param output 
+ * @param arg 
+ * @param max_entries 本次最多输出的条数
+ * @return uint32_t 输出的条数
+ */
+uint32_t vk_log_flush(vk_log_output_t output, void *arg, uint32_t max_entries)
+{
+    static const char levels[] = {'N', 'E', 'W', 'I', 'D'};
+    uint32_t count = 0;
+    while (count < max_entries)
+    {
+        uint32_t pos = vk_log_tail.load(std::memory_order_relaxed);
+        vk_log_slot_t *slot = &vk_log_slots[pos & (VK_LOG_DEPTH - 1)];
+        uint32_t base = pos & ~(uint32_t)(VK_LOG_DEPTH - 1);
+        if (slot->seq.load(std::memory_order_acquire) != base + 1)
+        {
+            break;
+        }
+
+        const vk_log_entry_t &e = slot->entry;
+        char line[128];
+        int n = snprintf(line, sizeof(line), "%c (%lu) ", levels[e.level < 5 ? e.level : 0], (unsigned long)(e.timestamp / 1000));
+        if (n < 0 || n >= (int)sizeof(line))
+        {
+            n = 0;
+        }
+        char *msg = line + n;
+        size_t room = sizeof(line) - n;
+        switch (e.nargs)
+        {
+        case 0: snprintf(msg, room, "%s", e.fmt); break;
+        case 1: snprintf(msg, room, e.fmt, e.args[0]); break;
+        case 2: snprintf(msg, room, e.fmt, e.args[0], e.args[1]); break;
+        case 3: snprintf(msg, room, e.fmt, e.args[0], e.args[1], e.args[2]); break;
+        default: snprintf(msg, room, e.fmt, e.args[0], e.args[1], e.args[2], e.args[3]); break;
+        }
+        uint8_t level = e.level;
+        slot->seq.store(base + VK_LOG_DEPTH, std::memory_order_release);
+        vk_log_tail.store(pos + 1, std::memory_order_relaxed);
+
+        output(level, line, arg);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief 因缓冲已满丢弃的日志条数
+ * 
+ * @return uint32_t 
+ */
+uint32_t vk_log_get_drop_count()
+{
+    return vk_log_dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file vk3809ip_log.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip deferred-format logging for the input hot path
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <type_traits>
+
+#define VK_LOG_NONE 0
+#define VK_LOG_ERROR 1
+#define VK_LOG_WARN 2
+#define VK_LOG_INFO 3
+#define VK_LOG_DEBUG 4
+
+#if defined(ESP_PLATFORM) && __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+
+#ifndef VK3809IP_LOG_LEVEL
+#ifdef CONFIG_VK3809IP_LOG_LEVEL
+#define VK3809IP_LOG_LEVEL CONFIG_VK3809IP_LOG_LEVEL  // menuconfig 中关闭日志模块时为 VK_LOG_NONE
+#else
+#define VK3809IP_LOG_LEVEL VK_LOG_INFO      // 编译期日志等级，高于该等级的日志调用不会生成任何代码
+#endif
+#endif
+
+#define VK_LOG_DEPTH 32                     // 日志缓冲条数，必须为2的幂
+#define VK_LOG_MAX_ARGS 4
+
+/*
+    ! 记录时只保存格式字符串指针与最多4个整数或指针参数，格式化推迟到 vk_log_flush()。
+    ! 格式字符串必须是字面量；%s 参数必须指向常量字符串；不支持浮点数与64位参数。
+    ! 格式与参数类型在编译期按 printf 检查，uint32_t 参数用 PRIu32/PRIx32。
+*/
+
+/**
+ * @brief 一条未格式化的日志
+ * 
+ */
+typedef struct{
+    const char *fmt;                        // 格式字符串，同时作为日志ID
+    uint32_t timestamp;
+    uint8_t level;
+    uint8_t nargs;
+    uintptr_t args[VK_LOG_MAX_ARGS];      // 与指针同宽，32位平台上为4字节
+}vk_log_entry_t;
+
+/**
+ * @brief 格式化后的输出接口，例如对接 fputs(line, stdout)
+ */
+typedef void (*vk_log_output_t)(uint8_t level, const char *line, void *arg);
+/**
+ * @brief 时间戳来源，与 vk_time_fptr_t 相同；驱动头文件会包含本文件，因此这里不反向包含驱动头文件
+ */
+typedef uint32_t (*vk_log_time_fptr_t)(void);
+
+void vk_log_set_time_source(vk_log_time_fptr_t time_cb);
+bool vk_log_record(uint8_t level, const char *fmt, uint8_t nargs, const uintptr_t *args);
+uint32_t vk_log_flush(vk_log_output_t output, void *arg, uint32_t max_entries = VK_LOG_DEPTH);
+uint32_t vk_log_get_drop_count();
+
+template <typename T>
+static inline uintptr_t vk_log_arg(T value)
+{
+    static_assert(std::is_integral_v<T> || std::is_pointer_v<T> || std::is_enum_v<T>, "vk_log arguments must be integers, enums or pointers");
+    static_assert(sizeof(T) <= sizeof(uintptr_t), "vk_log does not support 64-bit arguments on this platform");
+    return (uintptr_t)value;
+}
+template <typename T>
+static inline uintptr_t vk_log_arg(T *value) { return (uintptr_t)value; }
+
+/**
+ * @brief 只用于编译期检查格式字符串与参数类型，VK_LOGx 宏在 if (0) 中调用，不生成代码
+ */
+static inline void vk_log_check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void vk_log_check_format(const char *fmt, ...) { (void)fmt; }
+
+template <typename... Args>
+static inline void vk_log_write(uint8_t level, const char *fmt, Args... args)
+{
+    static_assert(sizeof...(Args) <= VK_LOG_MAX_ARGS, "vk_log supports at most 4 arguments");
+    const uintptr_t values[VK_LOG_MAX_ARGS + 1] = {vk_log_arg(args)...};
+    vk_log_record(level, fmt, (uint8_t)sizeof...(Args), values);
+}
+
+#define VK_LOG_WRITE(level, fmt, ...)                   \
+    do                                                  \
+    {                                                   \
+        if (0)                                          \
+            vk_log_check_format(fmt, ##__VA_ARGS__);    \
+        vk_log_write(level, fmt, ##__VA_ARGS__);        \
+    } while (0)
+
+#if VK3809IP_LOG_LEVEL >= VK_LOG_ERROR
+#define VK_LOGE(fmt, ...) VK_LOG_WRITE(VK_LOG_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define VK_LOGE(fmt, ...) ((void)0)
+#endif
+#if VK3809IP_LOG_LEVEL >= VK_LOG_WARN
+#define VK_LOGW(fmt, ...) VK_LOG_WRITE(VK_LOG_WARN, fmt, ##__VA_ARGS__)
+#else
+#define VK_LOGW(fmt, ...) ((void)0)
+#endif
+#if VK3809IP_LOG_LEVEL >= VK_LOG_INFO
+#define VK_LOGI(fmt, ...) VK_LOG_WRITE(VK_LOG_INFO, fmt, ##__VA_ARGS__)
+#else
+#define VK_LOGI(fmt, ...) ((void)0)
+#endif
+#if VK3809IP_LOG_LEVEL >= VK_LOG_DEBUG
+#define VK_LOGD(fmt, ...) VK_LOG_WRITE(VK_LOG_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define VK_LOGD(fmt, ...) ((void)0)
+#endif
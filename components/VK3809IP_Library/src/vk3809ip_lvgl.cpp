@@ -0,0 +1,324 @@
+/**
+ * @file vk3809ip_lvgl.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip LVGL encoder/keypad input device adapter
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_lvgl.hpp"
+
+#if VK3809IP_HAS_LVGL
+
+static_assert((VK_LVGL_KEY_DEPTH & (VK_LVGL_KEY_DEPTH - 1)) == 0, "VK_LVGL_KEY_DEPTH must be a power of 2");
+
+bool VK3809IPLvgl::KeyQueue::push(uint32_t key, bool pressed)
+{
+  uint32_t h = head.load(std::memory_order_relaxed);
+  if (h - tail.load(std::memory_order_acquire) >= VK_LVGL_KEY_DEPTH)
+  {
+    return false;
+  }
+  events[h & (VK_LVGL_KEY_DEPTH - 1)].key = key;
+  events[h & (VK_LVGL_KEY_DEPTH - 1)].pressed = pressed;
+  head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+bool VK3809IPLvgl::KeyQueue::pop(KeyEvent *event)
+{
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  if (t == head.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  *event = events[t & (VK_LVGL_KEY_DEPTH - 1)];
+  tail.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+bool VK3809IPLvgl::KeyQueue::empty() const
+{
+  return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP LVGL input device adapter.
+*/
+/**************************************************************************/
+
+VK3809IPLvgl::VK3809IPLvgl()
+    : _encDiff(0), _pending(false), _dropped(0)
+{
+  // 默认键位：Key1~Key4 方向，Key5 确认，Key6 返回，Key7/Key8 焦点切换，Key9 回到开头
+  static const uint32_t keys[VK_LVGL_KEYS] = {
+      LV_KEY_UP, LV_KEY_DOWN, LV_KEY_LEFT, LV_KEY_RIGHT, LV_KEY_ENTER,
+      LV_KEY_ESC, LV_KEY_PREV, LV_KEY_NEXT, LV_KEY_HOME};
+  for (int i = 0; i < VK_LVGL_KEYS; i++)
+  {
+    _keyMap[i] = keys[i];
+  }
+  _slider = 0;
+  _buttonKey = VK_LVGL_NO_KEY;
+  _track.configure(SLIDE_X_NUM_9, false);
+  _keys = 0;
+  _wake_cb = nullptr;
+  _wake_arg = nullptr;
+  _wakes = 0;
+  _keyQueue.head.store(0, std::memory_order_relaxed);
+  _keyQueue.tail.store(0, std::memory_order_relaxed);
+  _buttonQueue.head.store(0, std::memory_order_relaxed);
+  _buttonQueue.tail.store(0, std::memory_order_relaxed);
+  _encIndev = nullptr;
+  _keyIndev = nullptr;
+  _lastKey.key = 0;
+  _lastKey.pressed = false;
+  _buttonPressed = false;
+}
+
+/**
+ * @brief 配置编码器:
+ * 滑条位移按 VK3809IPEncoder 的档位与回滞换算成 enc_diff，
+ * 滑动速度由帧的 timestamp 计算，没有设置时间源(timestamp 为0)时速度为0，加速曲线不起作用
+ *
+ * @param sliderIndex 0~2 对应 Slide1~Slide3
+ * @param full_scale 滑条位置最大值，参考 vk_slider_full_scale()
+ * @param detents 整条滑条的档位数
+ * @param buttonKey 作为编码器按钮的按键(0~8)，该按键不再作为键盘输入；VK_LVGL_NO_KEY 为不使用
+ */
+void VK3809IPLvgl::configureEncoder(uint8_t sliderIndex, uint16_t full_scale, uint16_t detents, uint8_t buttonKey)
+{
+  _slider = (sliderIndex < 3) ? sliderIndex : 0;
+  _buttonKey = (buttonKey < VK_LVGL_KEYS) ? buttonKey : VK_LVGL_NO_KEY;
+  _track.configure(SLIDE_X_NUM_DISABLE, false, full_scale);
+  _encoder.configure(full_scale, detents);
+}
+/**
+ * @brief 设置按键对应的 LVGL 键值
+ *
+ * @param keyIndex 0~8 对应 Key1~Key9
+ * @param lv_key LV_KEY_xxx 或字符，0 为忽略该按键
+ */
+void VK3809IPLvgl::setKeyMap(uint8_t keyIndex, uint32_t lv_key)
+{
+  if (keyIndex < VK_LVGL_KEYS)
+  {
+    _keyMap[keyIndex] = lv_key;
+  }
+}
+/**
+ * @brief 设置唤醒回调，在 feed() 交接到新数据后调用，例如对接 LVGL 任务的 xTaskNotifyGive()
+ *
+ * @param wake_cb
+ * @param arg
+ */
+void VK3809IPLvgl::setWakeCallback(vk_notify_fptr_t wake_cb, void *arg)
+{
+  _wake_arg = arg;
+  _wake_cb = wake_cb;
+}
+
+/**
+ * @brief 注册编码器与键盘输入设备，在 LVGL 任务中 lv_init() 与显示初始化之后调用
+ *
+ * @param group 输入设备绑定的焦点组，nullptr 为不绑定
+ * @return true
+ */
+bool VK3809IPLvgl::begin(lv_group_t *group)
+{
+  if (_encIndev != nullptr)
+  {
+    return VK_PASS;
+  }
+#if LVGL_VERSION_MAJOR >= 9
+  _encIndev = lv_indev_create();
+  _keyIndev = lv_indev_create();
+  if (_encIndev == nullptr || _keyIndev == nullptr)
+  {
+    return VK_FAIL;
+  }
+  lv_indev_set_type(_encIndev, LV_INDEV_TYPE_ENCODER);
+  lv_indev_set_read_cb(_encIndev, _encoderRead);
+  lv_indev_set_user_data(_encIndev, this);
+  lv_indev_set_type(_keyIndev, LV_INDEV_TYPE_KEYPAD);
+  lv_indev_set_read_cb(_keyIndev, _keypadRead);
+  lv_indev_set_user_data(_keyIndev, this);
+#else
+  lv_indev_drv_init(&_encDrv);
+  _encDrv.type = LV_INDEV_TYPE_ENCODER;
+  _encDrv.read_cb = _encoderRead;
+  _encDrv.user_data = this;
+  _encIndev = lv_indev_drv_register(&_encDrv);
+  lv_indev_drv_init(&_keyDrv);
+  _keyDrv.type = LV_INDEV_TYPE_KEYPAD;
+  _keyDrv.read_cb = _keypadRead;
+  _keyDrv.user_data = this;
+  _keyIndev = lv_indev_drv_register(&_keyDrv);
+  if (_encIndev == nullptr || _keyIndev == nullptr)
+  {
+    return VK_FAIL;
+  }
+#endif
+  if (group != nullptr)
+  {
+    lv_indev_set_group(_encIndev, group);
+    lv_indev_set_group(_keyIndev, group);
+  }
+  return VK_PASS;
+}
+
+/**
+ * @brief 输入一帧(触摸任务):
+ * 滑条位移换算成档位步数累加到 enc_diff，按键边沿按键位写入队列，有新数据时调用唤醒回调
+ *
+ * @param state 解码后的触摸状态
+ */
+void VK3809IPLvgl::feed(const vk_touch_state_t &state)
+{
+  bool wake = false;
+
+  _track.update(state, _slider);
+  int16_t steps = _encoder.update(_track);
+  if (steps != 0)
+  {
+    _encDiff.fetch_add(steps, std::memory_order_relaxed);
+    wake = true;
+  }
+
+  uint16_t changed = (state.key_mask ^ _keys) & ((1 << VK_LVGL_KEYS) - 1);
+  for (uint8_t i = 0; changed != 0; i++, changed >>= 1)
+  {
+    if (!(changed & 1))
+    {
+      continue;
+    }
+    bool pressed = state.key_mask & (1 << i);
+    bool ok;
+    if (i == _buttonKey)
+    {
+      ok = _buttonQueue.push(LV_KEY_ENTER, pressed);
+    }
+    else if (_keyMap[i] != 0)
+    {
+      ok = _keyQueue.push(_keyMap[i], pressed);
+    }
+    else
+    {
+      continue;
+    }
+    if (!ok)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake = true;
+  }
+  _keys = state.key_mask;
+
+  if (wake)
+  {
+    _pending.store(true, std::memory_order_release);
+    if (_wake_cb != nullptr)
+    {
+      _wakes++;
+      _wake_cb(_wake_arg);
+    }
+  }
+}
+/**
+ * @brief 事件订阅回调，arg 为 VK3809IPLvgl 对象:
+ * broker.subscribe(filter, VK3809IPLvgl::onEvent, &adapter)，过滤条件需要包含 VK_EVT_FRAME
+ *
+ * @param event
+ * @param arg
+ */
+void VK3809IPLvgl::onEvent(const vk_touch_event_t *event, void *arg)
+{
+  ((VK3809IPLvgl *)arg)->feed(event->state);
+}
+
+/**
+ * @brief 在 LVGL 任务中调用(lv_timer_handler() 之前):
+ * 有交接的数据时立即读取编码器与键盘，不等待输入设备的轮询周期
+ *
+ * @return true 读取了输入设备
+ */
+bool VK3809IPLvgl::service()
+{
+  if (_encIndev == nullptr || !_pending.exchange(false, std::memory_order_acquire))
+  {
+    return false;
+  }
+  _readNow(_encIndev);
+  _readNow(_keyIndev);
+  return true;
+}
+
+void VK3809IPLvgl::_readNow(lv_indev_t *indev)
+{
+#if LVGL_VERSION_MAJOR >= 9
+  lv_indev_read(indev);
+#else
+  lv_indev_read_timer_cb(indev->driver->read_timer);
+#endif
+}
+
+VK3809IPLvgl *VK3809IPLvgl::_self(vk_lv_indev_arg_t *indev)
+{
+#if LVGL_VERSION_MAJOR >= 9
+  return (VK3809IPLvgl *)lv_indev_get_user_data(indev);
+#else
+  return (VK3809IPLvgl *)indev->user_data;
+#endif
+}
+
+/**
+ * @brief 编码器读取回调:
+ * 一次取走累计的步数；按钮边沿逐个输出，还有未输出的边沿时让 LVGL 继续读取
+ *
+ * @param indev
+ * @param data
+ */
+void VK3809IPLvgl::_encoderRead(vk_lv_indev_arg_t *indev, lv_indev_data_t *data)
+{
+  VK3809IPLvgl *self = _self(indev);
+  int32_t diff = self->_encDiff.exchange(0, std::memory_order_relaxed);
+  if (diff > INT16_MAX)
+  {
+    self->_encDiff.fetch_add(diff - INT16_MAX, std::memory_order_relaxed);
+    diff = INT16_MAX;
+  }
+  else if (diff < INT16_MIN)
+  {
+    self->_encDiff.fetch_add(diff - INT16_MIN, std::memory_order_relaxed);
+    diff = INT16_MIN;
+  }
+  data->enc_diff = (int16_t)diff;
+
+  KeyEvent event;
+  if (self->_buttonQueue.pop(&event))
+  {
+    self->_buttonPressed = event.pressed;
+  }
+  data->state = self->_buttonPressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+  data->continue_reading = !self->_buttonQueue.empty();
+}
+/**
+ * @brief 键盘读取回调:
+ * 每次输出一个按键边沿，队列为空时保持最后一个按键的状态
+ *
+ * @param indev
+ * @param data
+ */
+void VK3809IPLvgl::_keypadRead(vk_lv_indev_arg_t *indev, lv_indev_data_t *data)
+{
+  VK3809IPLvgl *self = _self(indev);
+  self->_keyQueue.pop(&self->_lastKey);
+  data->key = self->_lastKey.key;
+  data->state = self->_lastKey.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+  data->continue_reading = !self->_keyQueue.empty();
+}
+
+#endif // VK3809IP_HAS_LVGL
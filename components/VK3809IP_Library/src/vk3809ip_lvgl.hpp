@@ -0,0 +1,118 @@
+/**
+ * @file vk3809ip_lvgl.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip LVGL encoder/keypad input device adapter
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include "vk3809ip.hpp"
+#include "vk3809ip_broker.hpp"
+#include "vk3809ip_encoder.hpp"
+
+#if __has_include("lvgl.h")
+#define VK3809IP_HAS_LVGL 1
+
+#include "lvgl.h"
+
+#define VK_LVGL_KEY_DEPTH 16            // 按键事件队列深度，必须为2的幂
+#define VK_LVGL_KEYS 9                  // Key1~Key9
+#define VK_LVGL_NO_KEY 0xFF             // 编码器按钮不绑定按键
+
+/*
+    ! feed()/onEvent() 只能在一个任务(读取芯片或处理帧的任务)中调用，service() 与读取回调在 LVGL 任务中运行，
+    ! 两者之间只通过原子变量与单生产者单消费者队列交接，不需要互斥锁；触摸任务一侧不调用任何 LVGL 函数。
+*/
+
+/**************************************************************************/
+/*!
+    @brief LVGL 输入设备适配:
+    把一条滑条注册为编码器(位移换算成档位步数，可选一个按键作为编码器按钮)，按键注册为键盘。
+    触摸任务通过 feed() 交接数据并调用唤醒回调，LVGL 任务在 lv_timer_handler() 之前调用 service()，
+    有新数据时立即读取输入设备，不必等下一次轮询周期。
+*/
+/**************************************************************************/
+class VK3809IPLvgl
+{
+public:
+    VK3809IPLvgl(void);
+
+    void configureEncoder(uint8_t sliderIndex, uint16_t full_scale, uint16_t detents, uint8_t buttonKey = VK_LVGL_NO_KEY);
+    bool setAcceleration(const vk_encoder_accel_t *curve, uint8_t count) { return _encoder.setAcceleration(curve, count); }
+    void setKeyMap(uint8_t keyIndex, uint32_t lv_key);
+    void setWakeCallback(vk_notify_fptr_t wake_cb, void *arg = nullptr);
+
+    bool begin(lv_group_t *group = nullptr);
+    lv_indev_t *getEncoder() const { return _encIndev; }
+    lv_indev_t *getKeypad() const { return _keyIndev; }
+
+    void feed(const vk_touch_state_t &state);
+    static void onEvent(const vk_touch_event_t *event, void *arg);
+
+    bool service();
+
+    uint32_t getDropCount() const { return _dropped.load(std::memory_order_relaxed); }
+    uint32_t getWakeCount() const { return _wakes; }
+
+private:
+    struct KeyEvent
+    {
+        uint32_t key;
+        bool pressed;
+    };
+    struct KeyQueue
+    {
+        KeyEvent events[VK_LVGL_KEY_DEPTH];
+        std::atomic<uint32_t> head;     // 生产者写入
+        std::atomic<uint32_t> tail;     // 消费者写入
+
+        bool push(uint32_t key, bool pressed);
+        bool pop(KeyEvent *event);
+        bool empty() const;
+    };
+
+#if LVGL_VERSION_MAJOR >= 9
+    typedef lv_indev_t vk_lv_indev_arg_t;
+#else
+    typedef lv_indev_drv_t vk_lv_indev_arg_t;
+#endif
+    static void _encoderRead(vk_lv_indev_arg_t *indev, lv_indev_data_t *data);
+    static void _keypadRead(vk_lv_indev_arg_t *indev, lv_indev_data_t *data);
+    static VK3809IPLvgl *_self(vk_lv_indev_arg_t *indev);
+    static void _readNow(lv_indev_t *indev);
+
+    // 生产者(触摸任务)
+    uint8_t _slider;
+    uint8_t _buttonKey;
+    uint32_t _keyMap[VK_LVGL_KEYS];
+    VK3809IPRing _track;                // 线性模式，由帧时间戳得到速度供加速使用
+    VK3809IPEncoder _encoder;
+    uint16_t _keys;
+    vk_notify_fptr_t _wake_cb;
+    void *_wake_arg;
+    uint32_t _wakes;
+
+    // 交接
+    KeyQueue _keyQueue;
+    KeyQueue _buttonQueue;
+    std::atomic<int32_t> _encDiff;
+    std::atomic<bool> _pending;
+    std::atomic<uint32_t> _dropped;
+
+    // 消费者(LVGL 任务)
+    lv_indev_t *_encIndev;
+    lv_indev_t *_keyIndev;
+#if LVGL_VERSION_MAJOR < 9
+    lv_indev_drv_t _encDrv;
+    lv_indev_drv_t _keyDrv;
+#endif
+    KeyEvent _lastKey;
+    bool _buttonPressed;
+};
+
+#endif // __has_include("lvgl.h")
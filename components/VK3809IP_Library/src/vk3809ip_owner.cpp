@@ -0,0 +1,562 @@
+/**
+ * @file vk3809ip_owner.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip single-owner command-queue front end for concurrent access
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_owner.hpp"
+
+#if defined(ESP_PLATFORM)
+#include "esp_attr.h"
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+static_assert((VK_OWNER_QUEUE_DEPTH & (VK_OWNER_QUEUE_DEPTH - 1)) == 0, "VK_OWNER_QUEUE_DEPTH must be a power of 2");
+static_assert((VK_OWNER_SNAPSHOTS & (VK_OWNER_SNAPSHOTS - 1)) == 0, "VK_OWNER_SNAPSHOTS must be a power of 2");
+static_assert((VK_OWNER_RESULTS & (VK_OWNER_RESULTS - 1)) == 0 && VK_OWNER_RESULTS >= 4,
+              "VK_OWNER_RESULTS must be a power of 2 and at least 4");
+
+VK3809IPOwner::VK3809IPOwner()
+    : _running(false), _alive(false), _head(0), _completed(0), _frameSeq(0),
+      _executed(0), _merged(0), _batches(0), _dropped(0), _failed(0)
+{
+  _chip = nullptr;
+  _pollMs = 0;
+  _frame_cb = nullptr;
+  _frame_arg = nullptr;
+  _tail = 0;
+  for (int i = 0; i < VK_OWNER_QUEUE_DEPTH; i++)
+  {
+    _commands[i].seq.store(0, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < VK_OWNER_RESULTS; i++)
+  {
+    _results[i].store(VK_CMD_RESULT_PENDING, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < VK_OWNER_SNAPSHOTS; i++)
+  {
+    _snapshots[i].seq.store(0, std::memory_order_relaxed);
+    memset(&_snapshots[i].snapshot, 0, sizeof(vk_owner_snapshot_t));
+  }
+#if defined(ESP_PLATFORM)
+  _task.store(nullptr, std::memory_order_relaxed);
+  _notifying.store(0, std::memory_order_relaxed);
+#else
+  _events.store(0, std::memory_order_relaxed);
+  sem_init(&_wake, 0, 0);
+#endif
+}
+
+/**
+ * @brief 默认配置：中断方式，不绑定内核，优先级与例程中的触摸任务相同
+ *
+ * @return vk_owner_config_t
+ */
+vk_owner_config_t VK3809IPOwner::defaultConfig()
+{
+  vk_owner_config_t config;
+  config.core = VK_OWNER_NO_AFFINITY;
+  config.priority = 10;
+  config.stack = 3 * 1024;
+  config.poll_ms = 0;
+  return config;
+}
+
+/**
+ * @brief 创建所有者任务，之后芯片只由该任务访问
+ *
+ * @param chip 已完成 begin() 与配置的芯片
+ * @param config
+ * @return true 启动成功
+ */
+bool VK3809IPOwner::start(VK3809IPDevice &chip, const vk_owner_config_t &config)
+{
+  if (isRunning())
+  {
+    return VK_FAIL;
+  }
+  _chip = &chip;
+  _pollMs = config.poll_ms;
+  _running.store(true, std::memory_order_relaxed);
+  _alive.store(true, std::memory_order_relaxed);
+#if defined(ESP_PLATFORM)
+#if CONFIG_FREERTOS_UNICORE
+  BaseType_t core = tskNO_AFFINITY;
+#else
+  BaseType_t core = (config.core < 0) ? tskNO_AFFINITY : config.core;
+#endif
+  TaskHandle_t task = nullptr;
+  if (xTaskCreatePinnedToCore(_entry, "vk_owner", config.stack, this, config.priority, &task, core) != pdPASS)
+  {
+    _running.store(false, std::memory_order_relaxed);
+    _alive.store(false, std::memory_order_relaxed);
+    return VK_FAIL;
+  }
+  _task.store(task);
+#else
+  if (pthread_create(&_task, nullptr, [](void *self) -> void * { _entry(self); return nullptr; }, this) != 0)
+  {
+    _running.store(false, std::memory_order_relaxed);
+    _alive.store(false, std::memory_order_relaxed);
+    return VK_FAIL;
+  }
+#endif
+  _notify(EVT_COMMAND | EVT_FRAME);   // 执行启动前提交的命令并读取第一帧
+  return VK_PASS;
+}
+
+/**
+ * @brief 停止所有者任务，已提交的命令执行完后退出，之后可以重新直接访问芯片
+ *
+ */
+void VK3809IPOwner::stop()
+{
+  if (!_running.exchange(false))
+  {
+    return;
+  }
+  _notify(EVT_COMMAND);
+#if defined(ESP_PLATFORM)
+  while (_alive.load(std::memory_order_acquire))
+  {
+    vTaskDelay(1);
+  }
+#else
+  pthread_join(_task, nullptr);
+  _alive.store(false, std::memory_order_relaxed);
+#endif
+}
+
+/**
+ * @brief 设置新帧通知，在所有者任务中发布快照后调用，回调内不要阻塞:
+ * 回调中读到的快照就是刚发布的一帧，需要逐帧处理(不丢按键边沿)时在这里取出
+ *
+ * @param frame_cb
+ * @param arg
+ */
+void VK3809IPOwner::setFrameCallback(vk_owner_notify_fptr_t frame_cb, void *arg)
+{
+  _frame_arg = arg;
+  _frame_cb = frame_cb;
+}
+
+/**
+ * @brief 通知所有者任务读取一帧，在任务中调用，例如INT的GPIO队列处理任务
+ *
+ */
+void VK3809IPOwner::notifyFrame()
+{
+  _notify(EVT_FRAME);
+}
+
+#if defined(ESP_PLATFORM)
+/**
+ * @brief 在INT的GPIO中断中通知所有者任务读取一帧
+ *
+ */
+void IRAM_ATTR VK3809IPOwner::notifyFrameFromISR()
+{
+  BaseType_t woken = pdFALSE;
+  _notifying.fetch_add(1);
+  TaskHandle_t task = _task.load();
+  if (task != nullptr)
+  {
+    xTaskNotifyFromISR(task, EVT_FRAME, eSetBits, &woken);
+  }
+  _notifying.fetch_sub(1);
+  portYIELD_FROM_ISR(woken);
+}
+#endif
+
+/**
+ * @brief 提交一条配置命令:
+ * 多个任务用CAS抢占队列位置，不加锁；队列满时直接返回
+ *
+ * @param cmd
+ * @return uint32_t 凭据，用 isDone()、getResult() 查询是否已写入芯片；队列满时返回0
+ */
+uint32_t VK3809IPOwner::submit(const vk_command_t &cmd)
+{
+  uint32_t pos = _head.load(std::memory_order_relaxed);
+  CommandSlot *slot;
+  for (;;)
+  {
+    slot = &_commands[pos & (VK_OWNER_QUEUE_DEPTH - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - (pos & ~(uint32_t)(VK_OWNER_QUEUE_DEPTH - 1)));
+    if (diff == 0)
+    {
+      if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (diff < 0)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return 0;
+    }
+    else
+    {
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+  slot->cmd = cmd;
+  slot->seq.store((pos & ~(uint32_t)(VK_OWNER_QUEUE_DEPTH - 1)) + 1, std::memory_order_release);
+  _notify(EVT_COMMAND);
+  return pos + 1;   // 凭据从1开始，0 表示提交失败
+}
+
+uint32_t VK3809IPOwner::setting(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4)
+{
+  vk_command_t cmd = {};
+  cmd.type = VK_CMD_SETTING;
+  cmd.data[0] = DataByte1;
+  cmd.data[1] = DataByte2;
+  cmd.data[2] = DataByte3;
+  cmd.data[3] = DataByte4;
+  return submit(cmd);
+}
+
+uint32_t VK3809IPOwner::setThreshold(uint16_t thresholdValue, tpx_setting_number_t tpNum)
+{
+  vk_command_t cmd = {};
+  cmd.type = VK_CMD_THRESHOLD;
+  cmd.target = (uint8_t)tpNum;
+  cmd.value = thresholdValue;
+  return submit(cmd);
+}
+
+uint32_t VK3809IPOwner::setSleepThreshold(uint16_t thresholdValue)
+{
+  vk_command_t cmd = {};
+  cmd.type = VK_CMD_SLEEP_THRESHOLD;
+  cmd.value = thresholdValue;
+  return submit(cmd);
+}
+
+uint32_t VK3809IPOwner::applyProfile(const vk_profile_t *profile)
+{
+  if (profile == nullptr)
+  {
+    return 0;
+  }
+  vk_command_t cmd = {};
+  cmd.type = VK_CMD_PROFILE;
+  cmd.profile = profile;
+  return submit(cmd);
+}
+
+uint32_t VK3809IPOwner::setDataMode(i2c_data_mode_t mode)
+{
+  vk_command_t cmd = {};
+  cmd.type = VK_CMD_DATA_MODE;
+  cmd.value = (uint16_t)mode;
+  return submit(cmd);
+}
+
+/**
+ * @brief 命令是否已经执行(被同一批中后面的命令覆盖的也算执行)，成功与否用 getResult() 查询
+ *
+ * @param ticket submit() 返回的凭据
+ * @return true
+ */
+bool VK3809IPOwner::isDone(uint32_t ticket) const
+{
+  return ticket != 0 && (int32_t)(_completed.load(std::memory_order_acquire) - ticket) >= 0;
+}
+
+/**
+ * @brief 查询命令的执行结果
+ *
+ * @param ticket submit() 返回的凭据
+ * @return vk_command_result_t 最近 VK_OWNER_RESULTS 条以前的命令返回 VK_CMD_RESULT_EXPIRED
+ */
+vk_command_result_t VK3809IPOwner::getResult(uint32_t ticket) const
+{
+  if (!isDone(ticket))
+  {
+    return VK_CMD_RESULT_PENDING;
+  }
+  uint32_t word = _results[ticket & (VK_OWNER_RESULTS - 1)].load(std::memory_order_acquire);
+  if ((word & ~(uint32_t)(VK_OWNER_RESULTS - 1)) != (ticket & ~(uint32_t)(VK_OWNER_RESULTS - 1)))
+  {
+    return VK_CMD_RESULT_EXPIRED;
+  }
+  return (vk_command_result_t)(word & (VK_OWNER_RESULTS - 1));
+}
+
+/**
+ * @brief 读取最近一帧的快照:
+ * 快照按槽轮换写入，读取方拷贝后检查槽序号与帧序号，只有所有者任务在拷贝期间写满一圈时才需要重读，
+ * 因此连续读取得到的 seq 不会回退
+ *
+ * @param snapshot
+ * @return true 已经读取过至少一帧
+ */
+bool VK3809IPOwner::getSnapshot(vk_owner_snapshot_t *snapshot) const
+{
+  for (;;)
+  {
+    uint32_t n = _frameSeq.load(std::memory_order_acquire);
+    if (n == 0)
+    {
+      memset(snapshot, 0, sizeof(vk_owner_snapshot_t));
+      return false;
+    }
+    const SnapshotSlot &slot = _snapshots[(n - 1) & (VK_OWNER_SNAPSHOTS - 1)];
+    uint32_t before = slot.seq.load(std::memory_order_acquire);
+    memcpy(snapshot, (const void *)&slot.snapshot, sizeof(vk_owner_snapshot_t));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!(before & 1) && slot.seq.load(std::memory_order_relaxed) == before && snapshot->seq == n)
+    {
+      return true;
+    }
+  }
+}
+
+/**
+ * @brief 最近一帧的触摸状态
+ *
+ * @param state
+ * @return true 最近一帧有效
+ */
+bool VK3809IPOwner::getTouchState(vk_touch_state_t *state) const
+{
+  vk_owner_snapshot_t snapshot;
+  getSnapshot(&snapshot);
+  *state = snapshot.state;
+  return snapshot.valid;
+}
+
+uint16_t VK3809IPOwner::getKeyMask() const
+{
+  vk_owner_snapshot_t snapshot;
+  getSnapshot(&snapshot);
+  return snapshot.state.key_mask;
+}
+
+/**
+ * @brief 最近一帧的滑条位置
+ *
+ * @param sliderIndex 0~2 对应 Slide1~Slide3
+ * @return uint8_t
+ */
+uint8_t VK3809IPOwner::getSliderData(uint8_t sliderIndex) const
+{
+  if (sliderIndex >= 3)
+  {
+    return 0;
+  }
+  vk_owner_snapshot_t snapshot;
+  getSnapshot(&snapshot);
+  return snapshot.state.slider_position[sliderIndex];
+}
+
+void VK3809IPOwner::_entry(void *arg)
+{
+  VK3809IPOwner *self = (VK3809IPOwner *)arg;
+  self->_loop();
+#if defined(ESP_PLATFORM)
+  // 先清空句柄，再等已经读到句柄的通知完成，之后删除自身不会有调用者再访问已释放的任务
+  self->_task.store(nullptr);
+  while (self->_notifying.load() != 0)
+  {
+    vTaskDelay(1);                  // 被抢占的低优先级通知者需要运行才能离开
+  }
+  self->_alive.store(false, std::memory_order_release);
+  vTaskDelete(NULL);
+#else
+  self->_alive.store(false, std::memory_order_release);
+#endif
+}
+
+/**
+ * @brief 所有者任务:
+ * 先执行积压的命令再读取状态帧，同一时刻总线上只有一个传输
+ *
+ */
+void VK3809IPOwner::_loop()
+{
+  uint32_t timeout = _pollMs ? _pollMs : 100;
+  while (_running.load(std::memory_order_acquire))
+  {
+    uint32_t events = _wait(timeout);
+    _runCommands();
+    if ((events & EVT_FRAME) || (events == 0 && _pollMs != 0))
+    {
+      _readFrame();
+    }
+  }
+  _runCommands();
+}
+
+/**
+ * @brief 取出队列中全部命令，同一寄存器只保留最后一次写入，按提交顺序执行:
+ * 被覆盖的命令记录最终写入的结果，最终写入失败时它们同样报告失败
+ *
+ */
+void VK3809IPOwner::_runCommands()
+{
+  vk_command_t batch[VK_OWNER_QUEUE_DEPTH];
+  uint8_t last[VK_OWNER_QUEUE_DEPTH];    // 同一寄存器在本批中最后一条命令的位置
+  bool ok[VK_OWNER_QUEUE_DEPTH];
+  uint32_t first = _tail + 1;           // 本批第一条命令的凭据
+  uint32_t n = 0;
+  while (n < VK_OWNER_QUEUE_DEPTH)
+  {
+    CommandSlot &slot = _commands[_tail & (VK_OWNER_QUEUE_DEPTH - 1)];
+    uint32_t base = _tail & ~(uint32_t)(VK_OWNER_QUEUE_DEPTH - 1);
+    if (slot.seq.load(std::memory_order_acquire) != base + 1)
+    {
+      break;
+    }
+    batch[n++] = slot.cmd;
+    slot.seq.store(base + VK_OWNER_QUEUE_DEPTH, std::memory_order_release);
+    _tail++;
+  }
+  if (n == 0)
+  {
+    return;
+  }
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    last[i] = (uint8_t)i;
+    for (uint32_t j = i + 1; j < n; j++)
+    {
+      if (batch[j].type == batch[i].type &&
+          (batch[i].type != VK_CMD_THRESHOLD || batch[j].target == batch[i].target))
+      {
+        last[i] = (uint8_t)j;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    if (last[i] != i)
+    {
+      _merged.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    ok[i] = _execute(batch[i]);
+    _executed.fetch_add(1, std::memory_order_relaxed);
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    uint32_t ticket = first + i;
+    bool passed = ok[last[i]];
+    _results[ticket & (VK_OWNER_RESULTS - 1)].store(
+        (ticket & ~(uint32_t)(VK_OWNER_RESULTS - 1)) | (passed ? VK_CMD_RESULT_OK : VK_CMD_RESULT_FAILED),
+        std::memory_order_relaxed);
+    if (!passed)
+    {
+      _failed.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  _batches.fetch_add(1, std::memory_order_relaxed);
+  _completed.store(_tail, std::memory_order_release);
+}
+
+/**
+ * @brief 执行一条命令
+ *
+ * @param cmd
+ * @return true 全部配置包写入成功
+ */
+bool VK3809IPOwner::_execute(const vk_command_t &cmd)
+{
+  switch (cmd.type)
+  {
+  case VK_CMD_SETTING:
+    return _chip->settingCommandsData(cmd.data[0], cmd.data[1], cmd.data[2], cmd.data[3]);
+  case VK_CMD_THRESHOLD:
+    return _chip->settingTpxThresholdData(cmd.value, (tpx_setting_number_t)cmd.target);
+  case VK_CMD_SLEEP_THRESHOLD:
+    return _chip->settingSleepThresholdData(cmd.value);
+  case VK_CMD_PROFILE:
+    return _chip->applyProfile(cmd.profile) >= 0;
+  case VK_CMD_DATA_MODE:
+    return _chip->setDataMode((i2c_data_mode_t)cmd.value);
+  default:
+    return VK_FAIL;
+  }
+}
+
+/**
+ * @brief 读取一帧并发布快照
+ *
+ */
+void VK3809IPOwner::_readFrame()
+{
+  uint32_t n = _frameSeq.load(std::memory_order_relaxed);
+  SnapshotSlot &slot = _snapshots[n & (VK_OWNER_SNAPSHOTS - 1)];
+  vk_owner_snapshot_t snapshot;
+  snapshot.valid = _chip->getTouchState(&snapshot.state);
+  snapshot.switching = _chip->isSwitching();
+  snapshot.reset_count = _chip->getResetCount();
+  snapshot.seq = n + 1;
+
+  uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy((void *)&slot.snapshot, &snapshot, sizeof(vk_owner_snapshot_t));
+  slot.seq.store(seq + 2, std::memory_order_release);
+  _frameSeq.store(n + 1, std::memory_order_release);
+
+  if (_frame_cb != nullptr)
+  {
+    _frame_cb(_frame_arg);
+  }
+}
+
+void VK3809IPOwner::_notify(uint32_t events)
+{
+#if defined(ESP_PLATFORM)
+  _notifying.fetch_add(1);
+  TaskHandle_t task = _task.load();
+  if (task != nullptr)
+  {
+    xTaskNotify(task, events, eSetBits);
+  }
+  _notifying.fetch_sub(1);
+#else
+  _events.fetch_or(events, std::memory_order_release);
+  sem_post(&_wake);
+#endif
+}
+
+/**
+ * @brief 等待通知
+ *
+ * @param timeout_ms
+ * @return uint32_t 收到的 EVT_xxx，超时为0
+ */
+uint32_t VK3809IPOwner::_wait(uint32_t timeout_ms)
+{
+#if defined(ESP_PLATFORM)
+  uint32_t events = 0;
+  xTaskNotifyWait(0, UINT32_MAX, &events, pdMS_TO_TICKS(timeout_ms));
+  return events;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += timeout_ms / 1000;
+  ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L)
+  {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  while (sem_timedwait(&_wake, &ts) != 0 && errno == EINTR)
+  {
+  }
+  return _events.exchange(0, std::memory_order_acquire);
+#endif
+}
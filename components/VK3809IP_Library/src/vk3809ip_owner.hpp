@@ -0,0 +1,200 @@
+/**
+ * @file vk3809ip_owner.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip single-owner command-queue front end for concurrent access
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include "vk3809ip.hpp"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define VK_OWNER_QUEUE_DEPTH 16         // 命令队列深度，必须为2的幂
+#define VK_OWNER_SNAPSHOTS 4            // 状态快照槽数，必须为2的幂
+#define VK_OWNER_RESULTS 32             // 保留最近多少条命令的执行结果，必须为2的幂且不小于4
+
+/*
+    ! start() 之后芯片只由所有者任务访问，其它任务不要再直接调用 slider 的任何读写函数。
+    ! 命令接口可以在任意任务中调用(不能在中断中调用)，队列满时返回0而不等待；中断中只能调用 notifyFrameFromISR()。
+*/
+
+/**
+ * @brief 配置命令类型
+ *
+ */
+typedef enum{
+    VK_CMD_SETTING,                     // settingCommandsData(data[0]~data[3])
+    VK_CMD_THRESHOLD,                   // settingTpxThresholdData(value, target)
+    VK_CMD_SLEEP_THRESHOLD,             // settingSleepThresholdData(value)
+    VK_CMD_PROFILE,                     // applyProfile(profile)
+    VK_CMD_DATA_MODE,                   // setDataMode(value)
+}vk_command_type_t;
+/**
+ * @brief 命令执行结果:
+ * 被同一批中后面的同一寄存器命令覆盖的命令没有单独写入，结果与最终写入该寄存器的命令相同
+ *
+ */
+typedef enum{
+    VK_CMD_RESULT_PENDING,              // 还没有执行
+    VK_CMD_RESULT_OK,
+    VK_CMD_RESULT_FAILED,               // 写入失败(NACK或超时)，芯片保持原配置
+    VK_CMD_RESULT_EXPIRED,              // 已执行，但结果已被之后 VK_OWNER_RESULTS 条命令覆盖
+}vk_command_result_t;
+/**
+ * @brief 一条配置命令
+ *
+ */
+typedef struct{
+    uint8_t type;                       // vk_command_type_t
+    uint8_t target;                     // 阈值命令的 TP 编号
+    uint16_t value;
+    uint8_t data[4];
+    const vk_profile_t *profile;        // 需要在命令完成前保持有效
+}vk_command_t;
+/**
+ * @brief 所有者任务最近一次读取的状态
+ *
+ */
+typedef struct{
+    uint32_t seq;                       // 读取序号，0 表示还没有读取过
+    bool valid;                         // false 表示读取失败或正在重置恢复
+    bool switching;                     // 切换配置后等待校正完成
+    uint32_t reset_count;
+    vk_touch_state_t state;
+}vk_owner_snapshot_t;
+
+/**
+ * @brief 所有者任务读取新帧后的通知，例如对接处理任务的 xTaskNotifyGive()
+ */
+typedef void (*vk_owner_notify_fptr_t)(void *arg);
+
+/**
+ * @brief 所有者任务配置:
+ * poll_ms 为0时只在 notifyFrame() 后读取(中断方式)，否则没有通知时也按该周期读取(轮询方式)
+ */
+typedef struct{
+    int core;                           // VK_OWNER_NO_AFFINITY 为不绑定
+    int priority;
+    uint32_t stack;
+    uint32_t poll_ms;
+}vk_owner_config_t;
+
+#define VK_OWNER_NO_AFFINITY -1
+
+/**************************************************************************/
+/*!
+    @brief 单一所有者的命令队列前端:
+    一个所有者任务执行全部芯片读写，配置写入与状态读取不会在总线上交错。其它任务通过有界无锁
+    命令队列提交配置，所有者任务一次取出全部命令，同一寄存器只保留最后一次写入后按提交顺序执行；
+    状态查询直接读取最近一帧的快照，不经过总线。提交与查询都不加锁、不阻塞。
+*/
+/**************************************************************************/
+class VK3809IPOwner
+{
+public:
+    VK3809IPOwner(void);
+
+    static vk_owner_config_t defaultConfig();
+
+    bool start(VK3809IPDevice &chip, const vk_owner_config_t &config = defaultConfig());
+    void stop();
+    bool isRunning() const { return _running.load(std::memory_order_relaxed); }
+    void setFrameCallback(vk_owner_notify_fptr_t frame_cb, void *arg = nullptr);
+
+    // 中断通知
+    void notifyFrame();
+#if defined(ESP_PLATFORM)
+    void notifyFrameFromISR();
+#endif
+
+    // 配置命令，返回凭据，队列满时返回0
+    uint32_t submit(const vk_command_t &cmd);
+    uint32_t setting(uint8_t DataByte1, uint8_t DataByte2, uint8_t DataByte3, uint8_t DataByte4);
+    uint32_t setThreshold(uint16_t thresholdValue, tpx_setting_number_t tpNum);
+    uint32_t setSleepThreshold(uint16_t thresholdValue);
+    uint32_t applyProfile(const vk_profile_t *profile);
+    uint32_t setDataMode(i2c_data_mode_t mode);
+    bool isDone(uint32_t ticket) const;
+    vk_command_result_t getResult(uint32_t ticket) const;
+
+    // 状态查询，读取最近一帧的快照
+    bool getSnapshot(vk_owner_snapshot_t *snapshot) const;
+    bool getTouchState(vk_touch_state_t *state) const;
+    uint16_t getKeyMask() const;
+    uint8_t getSliderData(uint8_t sliderIndex) const;
+    uint32_t getFrameSeq() const { return _frameSeq.load(std::memory_order_acquire); }
+
+    uint32_t getCommandCount() const { return _executed.load(std::memory_order_relaxed); }
+    uint32_t getMergedCount() const { return _merged.load(std::memory_order_relaxed); }
+    uint32_t getBatchCount() const { return _batches.load(std::memory_order_relaxed); }
+    uint32_t getDropCount() const { return _dropped.load(std::memory_order_relaxed); }
+    uint32_t getFailedCount() const { return _failed.load(std::memory_order_relaxed); }
+
+private:
+    enum
+    {
+        EVT_FRAME = 1 << 0,
+        EVT_COMMAND = 1 << 1,
+    };
+    struct CommandSlot
+    {
+        std::atomic<uint32_t> seq;      // 与 vk_log 相同：seq == 本圈起点时可写，+1 时可读
+        vk_command_t cmd;
+    };
+    struct SnapshotSlot
+    {
+        std::atomic<uint32_t> seq;      // 奇数为写入中
+        vk_owner_snapshot_t snapshot;
+    };
+
+    static void _entry(void *arg);
+    void _loop();
+    uint32_t _wait(uint32_t timeout_ms);
+    void _notify(uint32_t events);
+    void _runCommands();
+    bool _execute(const vk_command_t &cmd);
+    void _readFrame();
+
+    VK3809IPDevice *_chip;
+    uint32_t _pollMs;
+    vk_owner_notify_fptr_t _frame_cb;
+    void *_frame_arg;
+    std::atomic<bool> _running;
+    std::atomic<bool> _alive;
+
+    CommandSlot _commands[VK_OWNER_QUEUE_DEPTH];
+    std::atomic<uint32_t> _head;        // 提交位置，多个任务 CAS 抢占
+    uint32_t _tail;                     // 只由所有者任务修改
+    std::atomic<uint32_t> _completed;   // 已执行的命令位置，凭据不大于它即已完成
+    std::atomic<uint32_t> _results[VK_OWNER_RESULTS];  // 凭据去掉低位后与结果合并，先于 _completed 写入
+
+    SnapshotSlot _snapshots[VK_OWNER_SNAPSHOTS];
+    std::atomic<uint32_t> _frameSeq;    // 已发布的快照数
+
+    std::atomic<uint32_t> _executed;
+    std::atomic<uint32_t> _merged;
+    std::atomic<uint32_t> _batches;
+    std::atomic<uint32_t> _dropped;
+    std::atomic<uint32_t> _failed;
+
+#if defined(ESP_PLATFORM)
+    std::atomic<TaskHandle_t> _task;    // 任务删除自身前清空
+    std::atomic<uint32_t> _notifying;   // 已读取句柄、正在通知的调用者数，任务等它归零后才删除自身
+#else
+    pthread_t _task;
+    sem_t _wake;
+    std::atomic<uint32_t> _events;
+#endif
+};
@@ -0,0 +1,338 @@
+/**
+ * @file vk3809ip_pipeline.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip two-stage reader/processor pipeline across cores
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_pipeline.hpp"
+
+#if !defined(ESP_PLATFORM)
+#include <errno.h>
+#include <time.h>
+#endif
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP frame queue.
+*/
+/**************************************************************************/
+
+VK3809IPFrameQueue::VK3809IPFrameQueue()
+{
+  static_assert((VK_PIPELINE_DEPTH & (VK_PIPELINE_DEPTH - 1)) == 0, "VK_PIPELINE_DEPTH must be a power of 2");
+  _head.store(0, std::memory_order_relaxed);
+  _tail.store(0, std::memory_order_relaxed);
+  _dropped.store(0, std::memory_order_relaxed);
+  _maxDepth = 0;
+}
+
+/**
+ * @brief 写入一帧，只能在读取任务中调用
+ *
+ * @param msg
+ * @return true 写入成功
+ * @return false 队列已满，该帧被丢弃
+ */
+bool VK3809IPFrameQueue::push(const vk_pipeline_msg_t &msg)
+{
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  uint32_t depth = head - _tail.load(std::memory_order_acquire);
+  if (depth >= VK_PIPELINE_DEPTH)
+  {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  _slots[head & (VK_PIPELINE_DEPTH - 1)] = msg;
+  _head.store(head + 1, std::memory_order_release);
+  if (depth + 1 > _maxDepth)
+  {
+    _maxDepth = depth + 1;
+  }
+  return true;
+}
+/**
+ * @brief 读出一帧，只能在处理任务中调用
+ *
+ * @param msg
+ * @return true 读出成功
+ * @return false 队列为空
+ */
+bool VK3809IPFrameQueue::pop(vk_pipeline_msg_t *msg)
+{
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail == _head.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  *msg = _slots[tail & (VK_PIPELINE_DEPTH - 1)];
+  _tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+uint32_t VK3809IPFrameQueue::getDepth() const
+{
+  return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP pipeline.
+*/
+/**************************************************************************/
+
+VK3809IPPipeline::VK3809IPPipeline()
+{
+  _chip = nullptr;
+  _wait_cb = nullptr;
+  _process_cb = nullptr;
+  _arg = nullptr;
+  _running.store(false, std::memory_order_relaxed);
+  _alive.store(0, std::memory_order_relaxed);
+  _readCount = 0;
+  _processCount = 0;
+#if defined(ESP_PLATFORM)
+  _reader = nullptr;
+  _processor.store(nullptr, std::memory_order_relaxed);
+  _notifying.store(0, std::memory_order_relaxed);
+#endif
+}
+
+/**
+ * @brief 默认配置:
+ * 读取任务在内核1(避开内核0上的WiFi/蓝牙协议栈)以较高优先级运行，处理任务在内核0
+ *
+ * @return vk_pipeline_config_t
+ */
+vk_pipeline_config_t VK3809IPPipeline::defaultConfig()
+{
+  vk_pipeline_config_t config;
+  config.reader_core = 1;
+  config.reader_priority = 12;
+  config.reader_stack = 3 * 1024;
+  config.processor_core = 0;
+  config.processor_priority = 10;
+  config.processor_stack = 4 * 1024;
+  return config;
+}
+
+/**
+ * @brief 创建读取与处理任务
+ *
+ * @param chip 已完成 begin() 与配置的芯片，启动后只由读取任务访问
+ * @param wait_cb 读取任务等待 INT
+ * @param process_cb 处理任务中对每一帧调用
+ * @param arg 两个回调的透传参数
+ * @param config 内核与优先级
+ * @return true 启动成功
+ */
+bool VK3809IPPipeline::start(VK3809IPDevice &chip, vk_pipeline_wait_fptr_t wait_cb, vk_pipeline_process_fptr_t process_cb,
+                             void *arg, const vk_pipeline_config_t &config)
+{
+  if (wait_cb == nullptr || process_cb == nullptr || isRunning())
+  {
+    return VK_FAIL;
+  }
+  _chip = &chip;
+  _wait_cb = wait_cb;
+  _process_cb = process_cb;
+  _arg = arg;
+  _running.store(true, std::memory_order_relaxed);
+  _alive.store(2, std::memory_order_relaxed);
+
+#if defined(ESP_PLATFORM)
+#if CONFIG_FREERTOS_UNICORE
+  BaseType_t readerCore = tskNO_AFFINITY;
+  BaseType_t processorCore = tskNO_AFFINITY;
+#else
+  BaseType_t readerCore = (config.reader_core < 0) ? tskNO_AFFINITY : config.reader_core;
+  BaseType_t processorCore = (config.processor_core < 0) ? tskNO_AFFINITY : config.processor_core;
+#endif
+  // 先创建处理任务，读取任务唤醒时它的句柄已经有效
+  TaskHandle_t processor = nullptr;
+  if (xTaskCreatePinnedToCore(_processorEntry, "vk_proc", config.processor_stack, this,
+                              config.processor_priority, &processor, processorCore) != pdPASS)
+  {
+    _running.store(false, std::memory_order_relaxed);
+    _alive.store(0, std::memory_order_relaxed);
+    return VK_FAIL;
+  }
+  _processor.store(processor);
+  if (xTaskCreatePinnedToCore(_readerEntry, "vk_read", config.reader_stack, this,
+                              config.reader_priority, &_reader, readerCore) != pdPASS)
+  {
+    _alive.store(1, std::memory_order_relaxed);
+    stop();
+    return VK_FAIL;
+  }
+#else
+  // 主机端不修改调度优先级(需要实时调度权限)，只设置内核亲和性
+  sem_init(&_wake, 0, 0);
+  if (pthread_create(&_processor, nullptr, [](void *self) -> void * { _processorEntry(self); return nullptr; }, this) != 0)
+  {
+    _running.store(false, std::memory_order_relaxed);
+    _alive.store(0, std::memory_order_relaxed);
+    sem_destroy(&_wake);
+    return VK_FAIL;
+  }
+  if (pthread_create(&_reader, nullptr, [](void *self) -> void * { _readerEntry(self); return nullptr; }, this) != 0)
+  {
+    _running.store(false, std::memory_order_relaxed);
+    _wakeProcessor();
+    pthread_join(_processor, nullptr);
+    _alive.store(0, std::memory_order_relaxed);
+    sem_destroy(&_wake);
+    return VK_FAIL;
+  }
+#if defined(__linux__)
+  cpu_set_t cpus;
+  if (config.reader_core >= 0)
+  {
+    CPU_ZERO(&cpus);
+    CPU_SET(config.reader_core, &cpus);
+    pthread_setaffinity_np(_reader, sizeof(cpus), &cpus);
+  }
+  if (config.processor_core >= 0)
+  {
+    CPU_ZERO(&cpus);
+    CPU_SET(config.processor_core, &cpus);
+    pthread_setaffinity_np(_processor, sizeof(cpus), &cpus);
+  }
+#endif
+#endif
+  return VK_PASS;
+}
+
+/**
+ * @brief 停止流水:
+ * 读取任务在 wait_cb 返回后退出，处理任务处理完队列中剩余的帧后退出
+ *
+ */
+void VK3809IPPipeline::stop()
+{
+  if (!_running.exchange(false))
+  {
+    return;
+  }
+  _wakeProcessor();
+#if defined(ESP_PLATFORM)
+  while (_alive.load(std::memory_order_acquire) != 0)
+  {
+    vTaskDelay(1);
+  }
+#else
+  pthread_join(_reader, nullptr);
+  pthread_join(_processor, nullptr);
+  sem_destroy(&_wake);
+  _alive.store(0, std::memory_order_relaxed);
+#endif
+}
+
+void VK3809IPPipeline::_readerEntry(void *arg)
+{
+  VK3809IPPipeline *self = (VK3809IPPipeline *)arg;
+  self->_readerLoop();
+  self->_alive.fetch_sub(1, std::memory_order_release);
+#if defined(ESP_PLATFORM)
+  vTaskDelete(NULL);
+#endif
+}
+
+void VK3809IPPipeline::_processorEntry(void *arg)
+{
+  VK3809IPPipeline *self = (VK3809IPPipeline *)arg;
+  self->_processorLoop();
+#if defined(ESP_PLATFORM)
+  // 与 VK3809IPOwner 相同：先清空句柄，再等已经读到句柄的通知完成，之后才删除自身
+  self->_processor.store(nullptr);
+  while (self->_notifying.load() != 0)
+  {
+    vTaskDelay(1);
+  }
+  self->_alive.fetch_sub(1, std::memory_order_release);
+  vTaskDelete(NULL);
+#else
+  self->_alive.fetch_sub(1, std::memory_order_release);
+#endif
+}
+
+void VK3809IPPipeline::_readerLoop()
+{
+  vk_pipeline_msg_t msg;
+  while (_running.load(std::memory_order_relaxed))
+  {
+    if (!_wait_cb(_arg))
+    {
+      continue;
+    }
+    msg.valid = _chip->getTouchState(&msg.state);
+    msg.reset_count = _chip->getResetCount();
+    msg.seq = ++_readCount;
+    _queue.push(msg);
+    _wakeProcessor();
+  }
+}
+
+void VK3809IPPipeline::_processorLoop()
+{
+  vk_pipeline_msg_t msg;
+  for (;;)
+  {
+    while (_queue.pop(&msg))
+    {
+      _process_cb(&msg, _arg);
+      _processCount++;
+    }
+    if (!_running.load(std::memory_order_acquire) && _alive.load(std::memory_order_acquire) == 1)
+    {
+      // 读取任务已退出，队列也已处理完
+      if (_queue.getDepth() == 0)
+      {
+        break;
+      }
+      continue;
+    }
+    _waitProcessor();
+  }
+}
+
+void VK3809IPPipeline::_wakeProcessor()
+{
+#if defined(ESP_PLATFORM)
+  _notifying.fetch_add(1);
+  TaskHandle_t processor = _processor.load();
+  if (processor != nullptr)
+  {
+    xTaskNotifyGive(processor);
+  }
+  _notifying.fetch_sub(1);
+#else
+  sem_post(&_wake);
+#endif
+}
+
+/**
+ * @brief 处理任务等待新帧，100ms 超时用于检查 stop()
+ *
+ */
+void VK3809IPPipeline::_waitProcessor()
+{
+#if defined(ESP_PLATFORM)
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += 100 * 1000000L;
+  if (ts.tv_nsec >= 1000000000L)
+  {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  while (sem_timedwait(&_wake, &ts) != 0 && errno == EINTR)
+  {
+  }
+#endif
+}
@@ -0,0 +1,138 @@
+/**
+ * @file vk3809ip_pipeline.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip two-stage reader/processor pipeline across cores
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include "vk3809ip.hpp"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define VK_PIPELINE_DEPTH 16            // 读取与处理之间的帧队列深度，必须为2的幂
+#define VK_PIPELINE_NO_AFFINITY -1      // 不绑定内核
+
+/**
+ * @brief 读取任务交给处理任务的一帧
+ *
+ */
+typedef struct{
+    uint32_t seq;                       // 读取序号，不连续说明队列满时丢弃过帧
+    uint32_t reset_count;               // 芯片累计重置次数
+    bool valid;                         // false 表示读取失败或正在重置恢复
+    vk_touch_state_t state;
+}vk_pipeline_msg_t;
+
+/**
+ * @brief 读取任务等待 INT 的接口，例如从GPIO中断队列取一次事件。返回false时本轮不读取芯片，
+ * 需要能周期性超时返回，stop() 才能结束读取任务
+ */
+typedef bool (*vk_pipeline_wait_fptr_t)(void *arg);
+/**
+ * @brief 处理任务中对每一帧调用，运行滤波、手势与事件分发
+ */
+typedef void (*vk_pipeline_process_fptr_t)(const vk_pipeline_msg_t *msg, void *arg);
+
+/**
+ * @brief 任务配置:
+ * 内核号为 VK_PIPELINE_NO_AFFINITY 时不绑定，单核配置(CONFIG_FREERTOS_UNICORE)下忽略内核号
+ */
+typedef struct{
+    int reader_core;
+    int reader_priority;
+    uint32_t reader_stack;
+    int processor_core;
+    int processor_priority;
+    uint32_t processor_stack;
+}vk_pipeline_config_t;
+
+/**************************************************************************/
+/*!
+    @brief 单生产者单消费者帧队列:
+    读取任务写入，处理任务读出，两端各自只修改自己的位置，不需要加锁。
+    队列满时丢弃新帧并计数，读取任务不会被处理任务拖慢。
+*/
+/**************************************************************************/
+class VK3809IPFrameQueue
+{
+public:
+    VK3809IPFrameQueue(void);
+
+    bool push(const vk_pipeline_msg_t &msg);
+    bool pop(vk_pipeline_msg_t *msg);
+
+    uint32_t getDepth() const;
+    uint32_t getMaxDepth() const { return _maxDepth; }
+    uint32_t getDropCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    vk_pipeline_msg_t _slots[VK_PIPELINE_DEPTH];
+    std::atomic<uint32_t> _head;        // 写入位置，只由读取任务修改
+    std::atomic<uint32_t> _tail;        // 读出位置，只由处理任务修改
+    std::atomic<uint32_t> _dropped;
+    uint32_t _maxDepth;
+};
+
+/**************************************************************************/
+/*!
+    @brief 读取/处理两级流水:
+    读取任务只等待 INT 并读取、解码状态帧(包括重置检测与恢复，它是唯一访问总线的任务)，
+    处理任务在另一个内核上执行耗时的滤波与分发，总线读取不会被处理任务的抖动推迟。
+*/
+/**************************************************************************/
+class VK3809IPPipeline
+{
+public:
+    VK3809IPPipeline(void);
+
+    static vk_pipeline_config_t defaultConfig();
+
+    bool start(VK3809IPDevice &chip, vk_pipeline_wait_fptr_t wait_cb, vk_pipeline_process_fptr_t process_cb,
+               void *arg = nullptr, const vk_pipeline_config_t &config = defaultConfig());
+    void stop();
+    bool isRunning() const { return _running.load(std::memory_order_relaxed); }
+
+    const VK3809IPFrameQueue &getQueue() const { return _queue; }
+    uint32_t getReadCount() const { return _readCount; }
+    uint32_t getProcessCount() const { return _processCount; }
+
+private:
+    static void _readerEntry(void *arg);
+    static void _processorEntry(void *arg);
+    void _readerLoop();
+    void _processorLoop();
+    void _wakeProcessor();
+    void _waitProcessor();
+
+    VK3809IPDevice *_chip;
+    vk_pipeline_wait_fptr_t _wait_cb;
+    vk_pipeline_process_fptr_t _process_cb;
+    void *_arg;
+    VK3809IPFrameQueue _queue;
+    std::atomic<bool> _running;
+    std::atomic<uint8_t> _alive;        // 仍在运行的任务数
+    uint32_t _readCount;
+    uint32_t _processCount;
+
+#if defined(ESP_PLATFORM)
+    TaskHandle_t _reader;
+    std::atomic<TaskHandle_t> _processor;   // 处理任务删除自身前清空
+    std::atomic<uint32_t> _notifying;       // 已读取处理任务句柄、正在通知的调用者数
+#else
+    pthread_t _reader;
+    pthread_t _processor;
+    sem_t _wake;
+#endif
+};
@@ -0,0 +1,225 @@
+/**
+ * @file vk3809ip_predict.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip latency-compensating slider position prediction
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "vk3809ip_predict.hpp"
+
+#define VK_PREDICT_VEL_LIMIT (1 << 24)  // 256 counts/ms，远超手指速度，只用于防止溢出
+#define VK_PREDICT_ACC_LIMIT (1 << 22)  // 64 counts/ms²
+
+static int32_t vk_predict_clamp(int64_t value, int32_t limit)
+{
+  if (value > limit)
+  {
+    return limit;
+  }
+  if (value < -limit)
+  {
+    return -limit;
+  }
+  return (int32_t)value;
+}
+
+VK3809IPPredictor::VK3809IPPredictor()
+{
+  for (int i = 0; i < VK_PREDICT_SLIDERS; i++)
+  {
+    _tracks[i].fullScale = vk_slider_full_scale(SLIDE_X_NUM_9);
+    reset(i);
+  }
+  // alpha=0.8，beta=0.5，gamma=0.08：10ms帧间隔、±2 counts噪声的合成滑动轨迹上误差较小
+  setGains(204, 128, 20);
+  _horizon = VK_PREDICT_HORIZON_US;
+}
+
+/**
+ * @brief 配置滑条量程
+ *
+ * @param sliderIndex 0~2 对应 Slide1~Slide3
+ * @param keys 滑条按键数，与 settingCommandsDataByte3/4 中的设定一致
+ * @param full_scale 位置最大值，0 时按按键数取 vk_slider_full_scale()
+ */
+void VK3809IPPredictor::configure(uint8_t sliderIndex, slide_x_number_t keys, uint16_t full_scale)
+{
+  if (sliderIndex >= VK_PREDICT_SLIDERS)
+  {
+    return;
+  }
+  _tracks[sliderIndex].fullScale = full_scale ? full_scale : vk_slider_full_scale(keys);
+  reset(sliderIndex);
+}
+/**
+ * @brief 设置滤波增益(Q8):
+ * alpha 越大位置越贴近测量值，beta/gamma 越大速度与加速度响应越快但越容易被噪声带偏。
+ * gamma 为0时退化为 alpha-beta 滤波，只按速度外推
+ *
+ * @param alpha_q8 位置增益
+ * @param beta_q8 速度增益
+ * @param gamma_q8 加速度增益
+ */
+void VK3809IPPredictor::setGains(uint8_t alpha_q8, uint8_t beta_q8, uint8_t gamma_q8)
+{
+  _alpha = alpha_q8;
+  _beta = beta_q8;
+  _gamma = gamma_q8;
+}
+
+/**
+ * @brief 清除滑条的跟踪状态
+ *
+ * @param sliderIndex
+ */
+void VK3809IPPredictor::reset(uint8_t sliderIndex)
+{
+  if (sliderIndex >= VK_PREDICT_SLIDERS)
+  {
+    return;
+  }
+  Track &t = _tracks[sliderIndex];
+  t.active = false;
+  t.frames = 0;
+  t.time = 0;
+  t.pos = 0;
+  t.vel = 0;
+  t.acc = 0;
+}
+
+/**
+ * @brief 输入一帧:
+ * 触摸开始的第一帧只记录位置，第二帧由两点估计初速度，之后按 alpha-beta-gamma 更新；
+ * 松手的帧清除状态
+ *
+ * @param state 带时间戳的触摸状态
+ */
+void VK3809IPPredictor::update(const vk_touch_state_t &state)
+{
+  for (uint8_t i = 0; i < VK_PREDICT_SLIDERS; i++)
+  {
+    Track &t = _tracks[i];
+    if (!(state.slider_touch & (1 << i)))
+    {
+      if (t.active)
+      {
+        reset(i);
+      }
+      continue;
+    }
+    uint16_t position = state.slider_position[i];
+    if (position > t.fullScale)
+    {
+      position = t.fullScale;
+    }
+    int32_t meas = (int32_t)position << VK_PREDICT_Q;
+    uint32_t dt = state.timestamp - t.time;
+
+    if (!t.active || dt > VK_PREDICT_MAX_GAP_US)
+    {
+      t.active = true;
+      t.frames = 1;
+      t.time = state.timestamp;
+      t.pos = meas;
+      t.vel = 0;
+      t.acc = 0;
+      continue;
+    }
+    if (dt == 0)
+    {
+      continue;
+    }
+    if (t.frames == 1)
+    {
+      t.vel = vk_predict_clamp((int64_t)(meas - t.pos) * 1000 / dt, VK_PREDICT_VEL_LIMIT);
+      t.pos = meas;
+      t.time = state.timestamp;
+      t.frames = 2;
+      continue;
+    }
+
+    int32_t vel;
+    int32_t pos = _extrapolate(t, dt, &vel);
+    int64_t residual = (int64_t)meas - pos;
+    t.pos = (int32_t)(pos + ((residual * _alpha) >> 8));
+    t.vel = vk_predict_clamp(vel + ((residual * _beta) >> 8) * 1000 / dt, VK_PREDICT_VEL_LIMIT);
+    t.acc = vk_predict_clamp(t.acc + ((residual * _gamma) >> 7) * 1000000 / ((int64_t)dt * dt), VK_PREDICT_ACC_LIMIT);
+    t.time = state.timestamp;
+    if (t.frames < 255)
+    {
+      t.frames++;
+    }
+  }
+}
+
+/**
+ * @brief 从最近一帧外推 dt_us:
+ * 加速度项在最大加速度、100ms 间隔下超出32位，先在64位中限制到 0~满量程 再转换
+ *
+ * @param t
+ * @param dt_us
+ * @param vel 外推后的速度，可以为NULL
+ * @return int32_t 外推后的位置(Q16)，在 0~满量程 之内
+ */
+int32_t VK3809IPPredictor::_extrapolate(const Track &t, uint32_t dt_us, int32_t *vel)
+{
+  int64_t dt = dt_us;
+  int64_t pos = t.pos + (int64_t)t.vel * dt / 1000 + (int64_t)t.acc * dt * dt / 2000000;
+  int64_t max = (int64_t)t.fullScale << VK_PREDICT_Q;
+  if (vel != nullptr)
+  {
+    *vel = vk_predict_clamp(t.vel + (int64_t)t.acc * dt / 1000, VK_PREDICT_VEL_LIMIT);
+  }
+  return (int32_t)((pos < 0) ? 0 : (pos > max) ? max : pos);
+}
+
+bool VK3809IPPredictor::isTracking(uint8_t sliderIndex) const
+{
+  return sliderIndex < VK_PREDICT_SLIDERS && _tracks[sliderIndex].active;
+}
+
+/**
+ * @brief 预测 now 时刻的滑条位置:
+ * 外推时间不超过 setHorizon() 设定值，手指停住后(INT 不再触发)预测位置不会一直跑下去
+ *
+ * @param sliderIndex 0~2 对应 Slide1~Slide3
+ * @param now 当前时间(us)，与触摸状态时间戳同一时钟
+ * @return uint16_t 限制在 0~满量程 的位置，未触摸时返回0
+ */
+uint16_t VK3809IPPredictor::predict(uint8_t sliderIndex, uint32_t now) const
+{
+  if (!isTracking(sliderIndex))
+  {
+    return 0;
+  }
+  const Track &t = _tracks[sliderIndex];
+  int32_t dt = (int32_t)(now - t.time);
+  if (dt < 0)
+  {
+    dt = 0;
+  }
+  if ((uint32_t)dt > _horizon)
+  {
+    dt = (int32_t)_horizon;
+  }
+  int32_t pos = (t.frames >= 2) ? _extrapolate(t, (uint32_t)dt, nullptr) : t.pos;
+  return (uint16_t)((pos + (1 << (VK_PREDICT_Q - 1))) >> VK_PREDICT_Q);
+}
+
+/**
+ * @brief 当前速度估计
+ *
+ * @param sliderIndex
+ * @return int32_t counts/s，位置增大为正
+ */
+int32_t VK3809IPPredictor::getVelocity(uint8_t sliderIndex) const
+{
+  if (!isTracking(sliderIndex))
+  {
+    return 0;
+  }
+  return (int32_t)(((int64_t)_tracks[sliderIndex].vel * 1000) >> VK_PREDICT_Q);
+}
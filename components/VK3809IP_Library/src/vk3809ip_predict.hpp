@@ -0,0 +1,65 @@
+/**
+ * @file vk3809ip_predict.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip latency-compensating slider position prediction
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+#include "vk3809ip_ring.hpp"
+
+#define VK_PREDICT_SLIDERS 3
+#define VK_PREDICT_Q 16                 // 位置定点小数位数，速度/加速度同为 Q16 counts/ms、counts/ms²
+#define VK_PREDICT_HORIZON_US 30000     // 默认最远外推时间
+#define VK_PREDICT_MAX_GAP_US 100000    // 两帧间隔超过该值时认为手指停过，速度清零重新估计
+
+/**************************************************************************/
+/*!
+    @brief 滑条位置预测:
+    每个滑条用定点 alpha-beta-gamma 滤波估计位置、速度与加速度，
+    渲染时把位置外推到当前时间，补偿 INT、总线读取与处理带来的延迟。
+    外推结果限制在滑条量程内，松手后清除状态，下一次触摸重新估计。
+    ! 只适用于线性滑条，滑环请先用 VK3809IPRing 还原接缝。
+*/
+/**************************************************************************/
+class VK3809IPPredictor
+{
+public:
+    VK3809IPPredictor(void);
+
+    void configure(uint8_t sliderIndex, slide_x_number_t keys, uint16_t full_scale = 0);
+    void setGains(uint8_t alpha_q8, uint8_t beta_q8, uint8_t gamma_q8);
+    void setHorizon(uint32_t max_horizon_us) { _horizon = max_horizon_us; }
+
+    void update(const vk_touch_state_t &state);
+    void reset(uint8_t sliderIndex);
+
+    bool isTracking(uint8_t sliderIndex) const;
+    uint16_t predict(uint8_t sliderIndex, uint32_t now) const;
+    int32_t getVelocity(uint8_t sliderIndex) const;
+
+private:
+    struct Track
+    {
+        bool active;
+        uint8_t frames;         // 本次触摸已收到的帧数，前两帧只做初始化
+        uint32_t time;          // 最近一帧的时间戳(us)
+        int32_t pos;            // Q16 counts
+        int32_t vel;            // Q16 counts/ms
+        int32_t acc;            // Q16 counts/ms²
+        uint16_t fullScale;
+    };
+
+    static int32_t _extrapolate(const Track &t, uint32_t dt_us, int32_t *vel);
+
+    Track _tracks[VK_PREDICT_SLIDERS];
+    uint8_t _alpha;
+    uint8_t _beta;
+    uint8_t _gamma;
+    uint32_t _horizon;
+};
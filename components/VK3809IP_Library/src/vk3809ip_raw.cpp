@@ -0,0 +1,123 @@
+/**
+ * @file vk3809ip_raw.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip PC link mode raw channel count streaming
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_raw.hpp"
+
+VK3809IPRawStream::VK3809IPRawStream()
+{
+  memset(_buffer, 0, sizeof(_buffer));
+  _front.store(0, std::memory_order_relaxed);
+  _seq.store(0, std::memory_order_relaxed);
+  _errors = 0;
+}
+
+/**
+ * @brief 切换到 PC link 模式开始采集
+ * 
+ * @param chip 
+ * @return true 
+ * @return false 
+ */
+bool VK3809IPRawStream::start(VK3809IPDevice &chip)
+{
+  return chip.setDataMode(PC_LINK_MODE);
+}
+/**
+ * @brief 切换回滑条应用模式
+ * 
+ * @param chip 
+ * @return true 
+ * @return false 
+ */
+bool VK3809IPRawStream::stop(VK3809IPDevice &chip)
+{
+  return chip.setDataMode(SLIDE_APP_MODE);
+}
+
+/**
+ * @brief 采样一次:
+ * 一次传输读取全部通道，解码到后台缓冲后再切换为前台。只能在一个采集任务中调用
+ * 
+ * @param chip 
+ * @param timestamp 采样时间(us)
+ * @return true 
+ * @return false 读取失败，前台缓冲保持上一帧
+ */
+bool VK3809IPRawStream::capture(VK3809IPDevice &chip, uint32_t timestamp)
+{
+  uint8_t data[VK3809IP_RAW_FRAME_LEN];
+  if (chip.readRawData(data, sizeof(data)) != 0)
+  {
+    _errors++;
+    return false;
+  }
+
+  uint8_t back = _front.load(std::memory_order_relaxed) ^ 1;
+  vk_raw_frame_t *frame = &_buffer[back];
+  uint32_t seq = _seq.load(std::memory_order_relaxed) + 1;
+
+  frame->seq = 0;  // 写入期间标记为无效
+  std::atomic_thread_fence(std::memory_order_release);
+  _decode(data, frame);
+  frame->timestamp = timestamp;
+  std::atomic_thread_fence(std::memory_order_release);
+  frame->seq = seq;
+
+  _front.store(back, std::memory_order_release);
+  _seq.store(seq, std::memory_order_release);
+  return true;
+}
+/**
+ * @brief 取得最近一次完整采样的视图，没有采样时 frame 为 nullptr
+ * 
+ * @return vk_raw_view_t 
+ */
+vk_raw_view_t VK3809IPRawStream::acquire() const
+{
+  vk_raw_view_t view;
+  uint32_t seq = _seq.load(std::memory_order_acquire);
+  view.frame = seq ? &_buffer[_front.load(std::memory_order_acquire)] : nullptr;
+  view.seq = seq;
+  return view;
+}
+/**
+ * @brief 视图是否仍然有效:
+ * 采集任务再采样两次后原缓冲会被重写，读取方处理完一帧后调用该函数确认结果可用
+ * 
+ * @param view 
+ * @return true 
+ * @return false 
+ */
+bool VK3809IPRawStream::isValid(const vk_raw_view_t &view) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return view.frame != nullptr && view.frame->seq == view.seq;
+}
+
+/**
+ * @brief 总线频率下的采样上限:
+ * 按 twi_read 的寻址+读取两次传输计算，每字节9个时钟，另加起始/停止条件
+ * 
+ * @param bus_hz 
+ * @return uint32_t 每秒最多采样帧数，乘以 VK3809IP_RAW_CHANNELS 为每秒通道采样数
+ */
+uint32_t VK3809IPRawStream::maxFramesPerSecond(uint32_t bus_hz)
+{
+  uint32_t clocks = (VK3809IP_RAW_FRAME_LEN + 2) * 9 + 4;
+  return bus_hz / clocks;
+}
+
+void VK3809IPRawStream::_decode(const uint8_t *data, vk_raw_frame_t *frame) const
+{
+  for (int i = 0; i < VK3809IP_RAW_CHANNELS; i++)
+  {
+    frame->counts[i] = (uint16_t)((data[i * 2] << 8) | data[i * 2 + 1]);
+  }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file vk3809ip_raw.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip PC link mode raw channel count streaming
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include <atomic>
+#include "vk3809ip.hpp"
+
+/* 
+    ! PC link 模式的数据帧格式以手册为准。此处按 TP0~TP8 每通道2字节计数、高字节在前排列，
+    ! 格式不同时只需要修改下面的长度定义与 VK3809IPRawStream::_decode()。
+*/
+#define VK3809IP_RAW_CHANNELS 9
+#define VK3809IP_RAW_BYTES_PER_CHANNEL 2
+#define VK3809IP_RAW_FRAME_LEN (VK3809IP_RAW_CHANNELS * VK3809IP_RAW_BYTES_PER_CHANNEL)
+
+/**
+ * @brief 一帧原始通道计数
+ * 
+ */
+typedef struct{
+    uint32_t seq;                               // 采样序号，从1开始
+    uint32_t timestamp;                         // 采样时间(us)
+    uint16_t counts[VK3809IP_RAW_CHANNELS];     // TP0~TP8 计数
+}vk_raw_frame_t;
+/**
+ * @brief 原始帧的只读视图:
+ * 直接指向双缓冲中的数据，不复制。使用完后用 VK3809IPRawStream::isValid() 确认期间没有被覆盖
+ */
+typedef struct{
+    const vk_raw_frame_t *frame;
+    uint32_t seq;
+}vk_raw_view_t;
+
+/**************************************************************************/
+/*!
+    @brief 原始通道计数采集:
+    把芯片切换到 PC link 模式，每次采样用一次传输读取全部通道，写入预先分配的双缓冲。
+    采集任务与分析任务之间不复制数据，读取方拿到的是最近一次完整采样的视图。
+*/
+/**************************************************************************/
+class VK3809IPRawStream
+{
+public:
+    VK3809IPRawStream(void);
+
+    bool start(VK3809IPDevice &chip);
+    bool stop(VK3809IPDevice &chip);
+
+    bool capture(VK3809IPDevice &chip, uint32_t timestamp = 0);
+    vk_raw_view_t acquire() const;
+    bool isValid(const vk_raw_view_t &view) const;
+
+    uint32_t getSampleCount() const { return _seq.load(std::memory_order_relaxed); }
+    uint32_t getErrorCount() const { return _errors; }
+
+    static uint32_t maxFramesPerSecond(uint32_t bus_hz);
+
+private:
+    void _decode(const uint8_t *data, vk_raw_frame_t *frame) const;
+
+    vk_raw_frame_t _buffer[2];
+    std::atomic<uint8_t> _front;    // 读取方使用的缓冲
+    std::atomic<uint32_t> _seq;
+    uint32_t _errors;
+};
@@ -0,0 +1,143 @@
+/**
+ * @file vk3809ip_ring.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip slide ring position unwrapping and angular velocity
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_ring.hpp"
+
+uint16_t vk_slider_full_scale(slide_x_number_t keys)
+{
+  int n = (keys >= SLIDE_X_NUM_3) ? keys + 1 : 3;
+  return (uint16_t)(170 + ((n - 3) * (227 - 170) + 3) / 6);
+}
+
+VK3809IPRing::VK3809IPRing()
+{
+  configure(SLIDE_X_NUM_9);
+}
+
+/**
+ * @brief 配置滑环:
+ * 默认接缝窗口为半圈，即单帧位移超过半圈就认为是从另一侧跨过接缝
+ * 
+ * @param keys 滑条按键数，与 settingCommandsDataByte3/4 中的设定一致
+ * @param ring true 为滑环，false 为普通滑条
+ * @param full_scale 位置最大值，0 时按按键数取 vk_slider_full_scale()
+ */
+void VK3809IPRing::configure(slide_x_number_t keys, bool ring, uint16_t full_scale)
+{
+  _ring = ring;
+  _keys = (keys >= SLIDE_X_NUM_3) ? (uint8_t)(keys + 1) : 3;
+  _fullScale = full_scale ? full_scale : vk_slider_full_scale(keys);
+  _seamWindow = _fullScale / 2;
+  reset();
+}
+/**
+ * @brief 按按键数设定接缝窗口:
+ * 手指单帧最多划过 seam_keys 个按键，超过 满量程-seam_keys个按键宽度 的跳变视为跨过接缝。
+ * 手指划得越快需要越大，但不能超过按键数的一半
+ * 
+ * @param seam_keys 
+ */
+void VK3809IPRing::setSeamKeys(uint8_t seam_keys)
+{
+  if (seam_keys == 0)
+  {
+    seam_keys = 1;
+  }
+  if (seam_keys > _keys / 2)
+  {
+    seam_keys = _keys / 2;
+  }
+  _seamWindow = (uint16_t)((uint32_t)_fullScale * seam_keys / _keys);
+}
+/**
+ * @brief 清除触摸状态与累计量
+ * 
+ */
+void VK3809IPRing::reset()
+{
+  _touched = false;
+  _position = 0;
+  _lastTime = 0;
+  _delta = 0;
+  _rotation = 0;
+  _velocity = 0;
+}
+
+/**
+ * @brief 输入一帧:
+ * 松开后再触摸不计算位移，避免把手指落点的变化算成旋转
+ * 
+ * @param state 解码后的帧，timestamp 为0时不计算速度
+ * @param sliderIndex 滑条序号(0~2)
+ * @return true 本帧有位移
+ * @return false 
+ */
+bool VK3809IPRing::update(const vk_touch_state_t &state, uint8_t sliderIndex)
+{
+  bool touched = (state.slider_touch >> sliderIndex) & 0x01;
+  uint16_t position = state.slider_position[sliderIndex];
+
+  _delta = 0;
+  if (!touched)
+  {
+    _touched = false;
+    _velocity = 0;
+    return false;
+  }
+  if (!_touched)
+  {
+    _touched = true;
+    _position = position;
+    _lastTime = state.timestamp;
+    return false;
+  }
+
+  _delta = _unwrap((int16_t)(position - _position));
+  _position = position;
+  _rotation += _delta;
+
+  uint32_t dt = state.timestamp - _lastTime;
+  _lastTime = state.timestamp;
+  if (dt != 0)
+  {
+    const int64_t limit = (int64_t)VK_RING_VELOCITY_MAX << VK_RING_VELOCITY_Q;
+    int64_t instant = (int64_t)_delta * 1000000 * (1 << VK_RING_VELOCITY_Q) / dt;
+    instant = (instant > limit) ? limit : (instant < -limit) ? -limit : instant;
+    _velocity += ((int32_t)instant - _velocity) >> VK_RING_VELOCITY_SMOOTH;
+  }
+  return _delta != 0;
+}
+/**
+ * @brief 角速度
+ * 
+ * @return int32_t 千分之一圈每秒
+ */
+int32_t VK3809IPRing::getAngularVelocity() const
+{
+  return (int32_t)(((int64_t)_velocity * 1000 >> VK_RING_VELOCITY_Q) / (_fullScale + 1));
+}
+
+int16_t VK3809IPRing::_unwrap(int16_t delta) const
+{
+  if (!_ring)
+  {
+    return delta;
+  }
+  int16_t seam = (int16_t)(_fullScale - _seamWindow);
+  if (delta > seam)
+  {
+    delta -= _fullScale + 1;
+  }
+  else if (delta < -seam)
+  {
+    delta += _fullScale + 1;
+  }
+  return delta;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file vk3809ip_ring.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip slide ring position unwrapping and angular velocity
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include "vk3809ip.hpp"
+
+#define VK_RING_VELOCITY_Q 8        // 速度定点小数位数，counts/s 的 Q8 格式
+#define VK_RING_VELOCITY_SMOOTH 2   // 速度平滑系数，每帧向新速度靠近 1/2^n
+#define VK_RING_VELOCITY_MAX 1000000L  // 单帧瞬时速度上限(counts/s)，两次读取间隔很短时防止溢出
+
+/**
+ * @brief 滑条满量程:
+ * 3键(170)与9键(227)为例程实测值，其余按键数线性插值，板子不同时建议实测后直接指定
+ * @param keys 滑条按键数设定
+ * @return uint16_t 位置最大值
+ */
+uint16_t vk_slider_full_scale(slide_x_number_t keys);
+
+/**************************************************************************/
+/*!
+    @brief 滑环(滑条首尾相接)位置跟踪:
+    手指跨过首尾接缝时位置会从最大值跳回0，环形模式下把这类跳变还原成连续的小位移，
+    累计旋转量并用定点数计算角速度。线性模式只做位移与速度统计，不做还原。
+*/
+/**************************************************************************/
+class VK3809IPRing
+{
+public:
+    VK3809IPRing(void);
+
+    void configure(slide_x_number_t keys, bool ring = true, uint16_t full_scale = 0);
+    void setSeamKeys(uint8_t seam_keys);
+
+    bool update(const vk_touch_state_t &state, uint8_t sliderIndex);
+    void reset();
+
+    bool isTouched() const { return _touched; }
+    uint16_t getPosition() const { return _position; }
+    uint16_t getFullScale() const { return _fullScale; }
+    int16_t getDelta() const { return _delta; }
+    int32_t getRotation() const { return _rotation; }
+    int32_t getVelocity() const { return _velocity; }
+    int32_t getRevolutions() const { return _rotation / ((int32_t)_fullScale + 1); }
+    int32_t getAngularVelocity() const;
+
+private:
+    int16_t _unwrap(int16_t delta) const;
+
+    bool _ring;
+    uint8_t _keys;
+    uint16_t _fullScale;    // 位置范围 0~_fullScale，一圈为 _fullScale+1 counts
+    uint16_t _seamWindow;   // 位移超过 满量程-窗口 时视为跨过接缝
+
+    bool _touched;
+    uint16_t _position;
+    uint32_t _lastTime;
+    int16_t _delta;
+    int32_t _rotation;      // 累计位移(counts)，顺时针(位置增大)为正
+    int32_t _velocity;      // counts/s，Q8
+};
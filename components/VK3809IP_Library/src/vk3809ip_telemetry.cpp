@@ -0,0 +1,421 @@
+/**
+ * @file vk3809ip_telemetry.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip compact binary telemetry stream
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_telemetry.hpp"
+
+static uint8_t vk_put_varint(uint8_t *out, uint32_t value)
+{
+  uint8_t n = 0;
+  while (value >= 0x80)
+  {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+static bool vk_get_varint(const uint8_t *in, uint8_t len, uint8_t *pos, uint32_t *value)
+{
+  uint32_t result = 0;
+  for (int shift = 0; shift < 35 && *pos < len; shift += 7)
+  {
+    uint8_t byte = in[(*pos)++];
+    result |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+    {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// CRC-8，多项式 0x07，初值0
+static uint8_t vk_crc8(const uint8_t *data, uint32_t len)
+{
+  uint8_t crc = 0;
+  for (uint32_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++)
+    {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP telemetry encoder.
+*/
+/**************************************************************************/
+
+VK3809IPTelemetry::VK3809IPTelemetry()
+{
+  static_assert((VK_TELEMETRY_BUFFER & (VK_TELEMETRY_BUFFER - 1)) == 0, "VK_TELEMETRY_BUFFER must be a power of 2");
+  _head.store(0, std::memory_order_relaxed);
+  _tail.store(0, std::memory_order_relaxed);
+  _dropped.store(0, std::memory_order_relaxed);
+  memset(_lastFrame, 0, sizeof(_lastFrame));
+  _lastTime = 0;
+  _framesSinceKey = 0;
+  _seq = 0;
+}
+
+/**
+ * @brief 写入一帧:
+ * 只记录与上一条帧记录相比变化的字节，每隔 VK_TELEMETRY_KEYFRAME_INTERVAL 条写一次完整帧
+ * 
+ * @param frame 6字节状态帧，例如 slider.getFrame()
+ * @param timestamp 读取时间(us)
+ * @return true 
+ * @return false 缓冲已满，记录被丢弃
+ */
+bool VK3809IPTelemetry::writeFrame(const uint8_t *frame, uint32_t timestamp)
+{
+  uint8_t payload[VK_TELEMETRY_MAX_RECORD];
+  uint8_t len = 0;
+  uint8_t type;
+
+  if (_framesSinceKey == 0)
+  {
+    type = VK_TELEMETRY_KEYFRAME;
+    payload[len++] = (uint8_t)timestamp;
+    payload[len++] = (uint8_t)(timestamp >> 8);
+    payload[len++] = (uint8_t)(timestamp >> 16);
+    payload[len++] = (uint8_t)(timestamp >> 24);
+    memcpy(&payload[len], frame, VK3809IP_FRAME_LEN);
+    len += VK3809IP_FRAME_LEN;
+  }
+  else
+  {
+    type = VK_TELEMETRY_FRAME;
+    len = _putTime(payload, timestamp);
+    uint8_t *mask = &payload[len++];
+    *mask = 0;
+    for (int i = 0; i < VK3809IP_FRAME_LEN; i++)
+    {
+      if (frame[i] != _lastFrame[i])
+      {
+        *mask |= (uint8_t)(1 << i);
+        payload[len++] = frame[i];
+      }
+    }
+  }
+
+  if (!_commit(type, payload, len, timestamp))
+  {
+    return VK_FAIL;
+  }
+  memcpy(_lastFrame, frame, VK3809IP_FRAME_LEN);
+  _framesSinceKey = (type == VK_TELEMETRY_KEYFRAME) ? VK_TELEMETRY_KEYFRAME_INTERVAL : _framesSinceKey - 1;
+  return VK_PASS;
+}
+/**
+ * @brief 写入一条事件记录
+ * 
+ * @param event VK3809IPBroker 发布的事件
+ * @return true 
+ * @return false 缓冲已满，记录被丢弃
+ */
+bool VK3809IPTelemetry::writeEvent(const vk_touch_event_t &event)
+{
+  uint8_t payload[VK_TELEMETRY_MAX_RECORD];
+  uint8_t len = _putTime(payload, event.state.timestamp);
+  payload[len++] = event.events;
+  payload[len++] = event.slider_touched;
+  payload[len++] = event.slider_moved;
+  payload[len++] = event.slider_released;
+  payload[len++] = (uint8_t)event.keys_pressed;
+  payload[len++] = (uint8_t)(event.keys_pressed >> 8);
+  payload[len++] = (uint8_t)event.keys_released;
+  payload[len++] = (uint8_t)(event.keys_released >> 8);
+  return _commit(VK_TELEMETRY_EVENT, payload, len, event.state.timestamp);
+}
+/**
+ * @brief 写入一条统计记录
+ * 
+ * @param chip 
+ * @param timestamp 
+ * @return true 
+ * @return false 缓冲已满，记录被丢弃
+ */
+bool VK3809IPTelemetry::writeStats(const VK3809IPDevice &chip, uint32_t timestamp)
+{
+  uint8_t payload[VK_TELEMETRY_MAX_RECORD];
+  uint8_t len = _putTime(payload, timestamp);
+  len += vk_put_varint(&payload[len], chip.getResetCount());
+  len += vk_put_varint(&payload[len], chip.getBusErrorCount());
+  len += vk_put_varint(&payload[len], getDropCount());
+  return _commit(VK_TELEMETRY_STATS, payload, len, timestamp);
+}
+
+/**
+ * @brief 把缓冲中的数据送到输出端:
+ * 在低优先级任务中调用，输出端接受的字节才会从缓冲中移除
+ * 
+ * @param sink 
+ * @param arg 
+ * @param max_bytes 本次最多输出的字节数
+ * @return uint32_t 实际输出的字节数
+ */
+uint32_t VK3809IPTelemetry::drain(vk_telemetry_sink_t sink, void *arg, uint32_t max_bytes)
+{
+  uint32_t total = 0;
+  while (total < max_bytes)
+  {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    uint32_t offset = tail & (VK_TELEMETRY_BUFFER - 1);
+    uint32_t len = head - tail;
+    if (len == 0)
+    {
+      break;
+    }
+    if (len > VK_TELEMETRY_BUFFER - offset)
+    {
+      len = VK_TELEMETRY_BUFFER - offset;
+    }
+    if (len > max_bytes - total)
+    {
+      len = max_bytes - total;
+    }
+    uint32_t sent = sink(&_buffer[offset], len, arg);
+    _tail.store(tail + sent, std::memory_order_release);
+    total += sent;
+    if (sent < len)
+    {
+      break;
+    }
+  }
+  return total;
+}
+/**
+ * @brief 缓冲中等待输出的字节数
+ * 
+ * @return uint32_t 
+ */
+uint32_t VK3809IPTelemetry::getPending() const
+{
+  return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+}
+
+bool VK3809IPTelemetry::_commit(uint8_t type, const uint8_t *payload, uint8_t len, uint32_t timestamp)
+{
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  uint32_t tail = _tail.load(std::memory_order_acquire);
+  uint32_t total = (uint32_t)len + 5;
+  if (total > VK_TELEMETRY_BUFFER - (head - tail))
+  {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return VK_FAIL;
+  }
+
+  // 丢弃的记录不占用序号，解码端看到的序号始终连续
+  uint8_t record[VK_TELEMETRY_MAX_RECORD + 5] = {VK_TELEMETRY_SYNC, (uint8_t)(len + 2), _seq, type};
+  memcpy(&record[4], payload, len);
+  record[total - 1] = vk_crc8(&record[1], total - 2);
+  for (uint32_t i = 0; i < total; i++)
+  {
+    _buffer[(head + i) & (VK_TELEMETRY_BUFFER - 1)] = record[i];
+  }
+  _head.store(head + total, std::memory_order_release);
+  _lastTime = timestamp;
+  _seq++;
+  return VK_PASS;
+}
+
+uint8_t VK3809IPTelemetry::_putTime(uint8_t *out, uint32_t timestamp) const
+{
+  return vk_put_varint(out, timestamp - _lastTime);
+}
+
+/**************************************************************************/
+/*!
+    @brief The VK3809IP telemetry decoder.
+*/
+/**************************************************************************/
+
+VK3809IPTelemetryDecoder::VK3809IPTelemetryDecoder(vk_telemetry_record_cb_t cb, void *arg)
+{
+  _cb = cb;
+  _arg = arg;
+  _fill = 0;
+  _synced = false;
+  _seq = 0;
+  _lost = 0;
+  memset(_frame, 0, sizeof(_frame));
+  _time = 0;
+  _errors = 0;
+}
+
+/**
+ * @brief 输入一段数据
+ * 
+ * @param data 
+ * @param len 
+ */
+void VK3809IPTelemetryDecoder::feed(const uint8_t *data, uint32_t len)
+{
+  for (uint32_t i = 0; i < len; i++)
+  {
+    _push(data[i]);
+  }
+}
+
+void VK3809IPTelemetryDecoder::_push(uint8_t byte)
+{
+  if (_fill == 0)
+  {
+    if (byte == VK_TELEMETRY_SYNC)
+    {
+      _record[_fill++] = byte;
+    }
+    return;
+  }
+  if (_fill == 1 && (byte < 2 || byte > VK_TELEMETRY_MAX_RECORD + 2))
+  {
+    _errors++;
+    _fill = (byte == VK_TELEMETRY_SYNC) ? 1 : 0;
+    return;
+  }
+  _record[_fill++] = byte;
+  if (_fill < _record[1] + 3)
+  {
+    return;
+  }
+  if (vk_crc8(&_record[1], _fill - 2) != _record[_fill - 1])
+  {
+    _errors++;
+    _synced = false;
+    _resync();
+    return;
+  }
+  _fill = 0;
+  if (!_decode(&_record[2], _record[1]))
+  {
+    _errors++;
+    _synced = false;
+  }
+}
+
+/**
+ * @brief 校验失败:
+ * 起始字节可能是数据中的 0xA5，丢掉它后把已收到的字节重新输入，从下一个起始字节开始同步
+ */
+void VK3809IPTelemetryDecoder::_resync()
+{
+  uint8_t pending[sizeof(_record)];
+  uint8_t count = _fill - 1;
+  memcpy(pending, &_record[1], count);
+  _fill = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    _push(pending[i]);
+  }
+}
+
+bool VK3809IPTelemetryDecoder::_decode(const uint8_t *record, uint8_t len)
+{
+  vk_telemetry_record_t out;
+  uint8_t pos = 1;
+  uint32_t delta;
+
+  memset(&out, 0, sizeof(out));
+  uint8_t seq = record[0];
+  record++;
+  len--;
+  out.type = record[0];
+  if (seq != _seq && _synced)
+  {
+    // 中间丢失了记录，之后的差分记录无法还原
+    _lost++;
+    _synced = false;
+  }
+  _seq = seq + 1;
+  if (out.type == VK_TELEMETRY_KEYFRAME)
+  {
+    if (len != 1 + 4 + VK3809IP_FRAME_LEN)
+    {
+      return false;
+    }
+    _time = (uint32_t)record[1] | ((uint32_t)record[2] << 8) | ((uint32_t)record[3] << 16) | ((uint32_t)record[4] << 24);
+    memcpy(_frame, &record[5], VK3809IP_FRAME_LEN);
+    _synced = true;
+  }
+  else
+  {
+    if (!_synced)
+    {
+      return true;
+    }
+    if (!vk_get_varint(record, len, &pos, &delta))
+    {
+      return false;
+    }
+    _time += delta;
+
+    switch (out.type)
+    {
+    case VK_TELEMETRY_FRAME:
+    {
+      if (pos >= len)
+      {
+        return false;
+      }
+      uint8_t mask = record[pos++];
+      if (pos + __builtin_popcount(mask) != len || (mask >> VK3809IP_FRAME_LEN))
+      {
+        return false;
+      }
+      for (int i = 0; i < VK3809IP_FRAME_LEN; i++)
+      {
+        if (mask & (1 << i))
+        {
+          _frame[i] = record[pos++];
+        }
+      }
+      break;
+    }
+    case VK_TELEMETRY_EVENT:
+      if (pos + 8 != len)
+      {
+        return false;
+      }
+      out.events = record[pos];
+      out.slider_touched = record[pos + 1];
+      out.slider_moved = record[pos + 2];
+      out.slider_released = record[pos + 3];
+      out.keys_pressed = (uint16_t)(record[pos + 4] | (record[pos + 5] << 8));
+      out.keys_released = (uint16_t)(record[pos + 6] | (record[pos + 7] << 8));
+      break;
+    case VK_TELEMETRY_STATS:
+      if (!vk_get_varint(record, len, &pos, &out.reset_count) ||
+          !vk_get_varint(record, len, &pos, &out.bus_errors) ||
+          !vk_get_varint(record, len, &pos, &out.dropped) || pos != len)
+      {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+
+  out.timestamp = _time;
+  memcpy(out.frame, _frame, VK3809IP_FRAME_LEN);
+  if (_cb != nullptr)
+  {
+    _cb(&out, _arg);
+  }
+  return true;
+}
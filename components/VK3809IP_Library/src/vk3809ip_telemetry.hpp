@@ -0,0 +1,129 @@
+/**
+ * @file vk3809ip_telemetry.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip compact binary telemetry stream
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include <atomic>
+#include "vk3809ip_broker.hpp"
+
+#define VK_TELEMETRY_BUFFER 1024        // 发送缓冲大小，必须为2的幂
+#define VK_TELEMETRY_SYNC 0xA5          // 每条记录的起始字节
+#define VK_TELEMETRY_KEYFRAME_INTERVAL 64 // 每隔多少条帧记录插入一条完整帧，解码端从这里开始同步
+#define VK_TELEMETRY_MAX_RECORD 32
+
+/*
+    记录格式: [0xA5][len][seq][type][payload...][crc]，len 为 seq+type+payload 的字节数，
+    seq 为每条记录加1的序号，crc 为 len~payload 的 CRC-8(多项式 0x07)。
+    校验失败时解码端从下一个起始字节重新查找；序号不连续说明丢失了记录，差分状态作废，等待下一条 KEYFRAME
+    KEYFRAME : 时间(u32 LE) + 6字节完整帧
+    FRAME    : 时间差(varint us) + 变化掩码(1字节，bit n 表示 Byte n 变化) + 变化的字节
+    EVENT    : 时间差(varint us) + events + touched + moved + released + pressed(u16 LE) + released(u16 LE)
+    STATS    : 时间差(varint us) + 重置次数、总线错误、遥测丢弃记录数(均为 varint)
+*/
+typedef enum{
+    VK_TELEMETRY_KEYFRAME = 1,
+    VK_TELEMETRY_FRAME,
+    VK_TELEMETRY_EVENT,
+    VK_TELEMETRY_STATS,
+}vk_telemetry_type_t;
+
+/**
+ * @brief 解码后的一条记录
+ * 
+ */
+typedef struct{
+    uint8_t type;
+    uint32_t timestamp;
+    uint8_t frame[VK3809IP_FRAME_LEN];  // KEYFRAME/FRAME，为还原后的完整帧
+    uint8_t events;                     // EVENT
+    uint8_t slider_touched;
+    uint8_t slider_moved;
+    uint8_t slider_released;
+    uint16_t keys_pressed;
+    uint16_t keys_released;
+    uint32_t reset_count;               // STATS
+    uint32_t bus_errors;
+    uint32_t dropped;
+}vk_telemetry_record_t;
+
+/**
+ * @brief 输出端接口，返回实际接受的字节数，可以少于 len
+ */
+typedef uint32_t (*vk_telemetry_sink_t)(const uint8_t *data, uint32_t len, void *arg);
+typedef void (*vk_telemetry_record_cb_t)(const vk_telemetry_record_t *record, void *arg);
+
+/**************************************************************************/
+/*!
+    @brief 二进制遥测编码:
+    触摸任务把帧、事件与统计写成带长度前缀的差分记录放进无锁缓冲，缓冲满时直接丢弃不等待；
+    低优先级任务调用 drain() 把缓冲送到串口、文件或网络。只允许一个写入任务和一个输出任务。
+*/
+/**************************************************************************/
+class VK3809IPTelemetry
+{
+public:
+    VK3809IPTelemetry(void);
+
+    bool writeFrame(const uint8_t *frame, uint32_t timestamp);
+    bool writeEvent(const vk_touch_event_t &event);
+    bool writeStats(const VK3809IPDevice &chip, uint32_t timestamp);
+
+    uint32_t drain(vk_telemetry_sink_t sink, void *arg, uint32_t max_bytes = VK_TELEMETRY_BUFFER);
+
+    uint32_t getDropCount() const { return _dropped.load(std::memory_order_relaxed); }
+    uint32_t getPending() const;
+
+private:
+    bool _commit(uint8_t type, const uint8_t *payload, uint8_t len, uint32_t timestamp);
+    uint8_t _seq;
+    uint8_t _putTime(uint8_t *out, uint32_t timestamp) const;
+
+    uint8_t _buffer[VK_TELEMETRY_BUFFER];
+    std::atomic<uint32_t> _head;        // 写入位置
+    std::atomic<uint32_t> _tail;        // 输出位置
+    std::atomic<uint32_t> _dropped;
+
+    uint8_t _lastFrame[VK3809IP_FRAME_LEN];
+    uint32_t _lastTime;
+    uint32_t _framesSinceKey;
+};
+
+/**************************************************************************/
+/*!
+    @brief 遥测解码:
+    可以分段输入任意长度的数据，每还原出一条记录调用一次回调。收到第一条 KEYFRAME 之前
+    的差分记录会被跳过；校验失败时从下一个起始字节重新查找，序号不连续时跳过差分记录直到下一条 KEYFRAME。
+*/
+/**************************************************************************/
+class VK3809IPTelemetryDecoder
+{
+public:
+    VK3809IPTelemetryDecoder(vk_telemetry_record_cb_t cb, void *arg = nullptr);
+
+    void feed(const uint8_t *data, uint32_t len);
+    uint32_t getErrorCount() const { return _errors; }
+    uint32_t getLostCount() const { return _lost; }
+
+private:
+    void _push(uint8_t byte);
+    void _resync();
+    bool _decode(const uint8_t *record, uint8_t len);
+
+    vk_telemetry_record_cb_t _cb;
+    void *_arg;
+    uint8_t _record[VK_TELEMETRY_MAX_RECORD + 5];
+    uint8_t _fill;
+    bool _synced;
+    uint8_t _seq;                       // 期望的下一条记录序号
+    uint32_t _lost;                     // 序号不连续的次数
+    uint8_t _frame[VK3809IP_FRAME_LEN];
+    uint32_t _time;
+    uint32_t _errors;
+};
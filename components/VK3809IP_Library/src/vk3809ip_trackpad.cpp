@@ -0,0 +1,98 @@
+/**
+ * @file vk3809ip_trackpad.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip two-slider virtual trackpad
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include "vk3809ip_trackpad.hpp"
+
+VK3809IPTrackpad::VK3809IPTrackpad()
+{
+  configure(0, SLIDE_X_NUM_3, 1, SLIDE_X_NUM_3);
+}
+
+/**
+ * @brief 选择作为X/Y轴的滑条:
+ * 输出范围默认与输入相同，可以再用 setAxisScale() 单独缩放
+ * 
+ * @param xSlider X轴滑条序号(0~2)
+ * @param xKeys X轴滑条按键数
+ * @param ySlider Y轴滑条序号(0~2)
+ * @param yKeys Y轴滑条按键数
+ */
+void VK3809IPTrackpad::configure(uint8_t xSlider, slide_x_number_t xKeys, uint8_t ySlider, slide_x_number_t yKeys)
+{
+  _axis[VK_TRACKPAD_X].slider = (xSlider < 3) ? xSlider : 0;
+  _axis[VK_TRACKPAD_Y].slider = (ySlider < 3) ? ySlider : 1;
+  setAxisScale(VK_TRACKPAD_X, vk_slider_full_scale(xKeys), false, vk_slider_full_scale(xKeys));
+  setAxisScale(VK_TRACKPAD_Y, vk_slider_full_scale(yKeys), false, vk_slider_full_scale(yKeys));
+  memset(&_point, 0, sizeof(_point));
+}
+/**
+ * @brief 单独缩放一个轴
+ * 
+ * @param axis VK_TRACKPAD_X 或 VK_TRACKPAD_Y
+ * @param out_max 输出最大值
+ * @param invert 是否反向，滑条安装方向与坐标方向相反时使用
+ * @param in_max 滑条位置最大值，0 时保持 configure() 中按按键数推算的值
+ */
+void VK3809IPTrackpad::setAxisScale(uint8_t axis, uint16_t out_max, bool invert, uint16_t in_max)
+{
+  if (axis > VK_TRACKPAD_Y)
+  {
+    return;
+  }
+  if (in_max != 0)
+  {
+    _axis[axis].in_max = in_max;
+  }
+  _axis[axis].out_max = out_max;
+  _axis[axis].invert = invert;
+}
+
+/**
+ * @brief 输入一帧
+ * 
+ * @param state 解码后的帧
+ * @param point 可选，输出合成后的点
+ * @return true 至少有一个轴被触摸
+ * @return false 
+ */
+bool VK3809IPTrackpad::update(const vk_touch_state_t &state, vk_point_t *point)
+{
+  const Axis &x = _axis[VK_TRACKPAD_X];
+  const Axis &y = _axis[VK_TRACKPAD_Y];
+  uint8_t touch = (uint8_t)(((state.slider_touch >> x.slider) & 0x01) |
+                            (((state.slider_touch >> y.slider) & 0x01) << 1));
+
+  if (touch & 0x01)
+  {
+    _point.x = _scale(x, state.slider_position[x.slider]);
+  }
+  if (touch & 0x02)
+  {
+    _point.y = _scale(y, state.slider_position[y.slider]);
+  }
+  _point.touch = touch;
+  _point.timestamp = state.timestamp;
+
+  if (point != nullptr)
+  {
+    *point = _point;
+  }
+  return touch != 0;
+}
+
+uint16_t VK3809IPTrackpad::_scale(const Axis &axis, uint8_t position) const
+{
+  uint32_t in = (position > axis.in_max) ? axis.in_max : position;
+  if (axis.invert)
+  {
+    in = axis.in_max - in;
+  }
+  return (uint16_t)((in * axis.out_max + axis.in_max / 2) / axis.in_max);
+}
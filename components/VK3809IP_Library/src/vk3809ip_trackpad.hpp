@@ -0,0 +1,60 @@
+/**
+ * @file vk3809ip_trackpad.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip two-slider virtual trackpad
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#pragma once
+
+#include "vk3809ip_ring.hpp"
+
+#define VK_TRACKPAD_X 0
+#define VK_TRACKPAD_Y 1
+
+/**
+ * @brief 二维触摸点
+ * 
+ */
+typedef struct{
+    uint32_t timestamp;     // 两个轴来自同一帧，共用该帧的时间
+    uint16_t x;
+    uint16_t y;
+    uint8_t touch;          // bit0 X轴被触摸，bit1 Y轴被触摸
+}vk_point_t;
+
+/**************************************************************************/
+/*!
+    @brief 双滑条虚拟触摸板:
+    两条滑条正交安装，同一帧中的两个滑条位置与触摸标志合成一个二维点，一次读取同时得到两个轴。
+    只有一个轴被触摸时，另一个轴保持最后的值。
+*/
+/**************************************************************************/
+class VK3809IPTrackpad
+{
+public:
+    VK3809IPTrackpad(void);
+
+    void configure(uint8_t xSlider, slide_x_number_t xKeys, uint8_t ySlider, slide_x_number_t yKeys);
+    void setAxisScale(uint8_t axis, uint16_t out_max, bool invert = false, uint16_t in_max = 0);
+
+    bool update(const vk_touch_state_t &state, vk_point_t *point);
+    const vk_point_t &getPoint() const { return _point; }
+
+private:
+    struct Axis
+    {
+        uint8_t slider;
+        uint16_t in_max;
+        uint16_t out_max;
+        bool invert;
+    };
+
+    uint16_t _scale(const Axis &axis, uint8_t position) const;
+
+    Axis _axis[2];
+    vk_point_t _point;
+};
@@ -0,0 +1,240 @@
+/**
+ * @file vk3809ip_transport.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip compile-time bus transport policies
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+    传输策略约定，VK3809IPT<Transport> 在编译期绑定，调用可以被内联:
+        int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us);
+        int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us);
+    返回0表示成功。timeout_us 由驱动按总线频率计算，不支持超时的传输直接忽略即可，
+    该计算随之被编译器优化掉。
+*/
+
+/**
+ * @brief I2C读写函数指针接口，对接相应芯片开发平台的I2C读写函数
+ *
+ */
+typedef uint32_t (*vk_com_fptr_t)(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len); //! 类型错误：int
+/**
+ * @brief 带超时的I2C读写函数指针接口:
+ * timeout_us 为本次传输的截止时间(从调用开始计)，超时应返回非0错误码
+ */
+typedef uint32_t (*vk_com_timeout_fptr_t)(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len, uint32_t timeout_us);
+
+#define VK_TRANSPORT_REG_NONE 0xFF      // 与 REG_ADDR_NONE 相同，禁用 Single Read and Write
+
+/**************************************************************************/
+/*!
+    @brief 函数指针传输:
+    兼容原有的 begin(read_cb, write_cb) 接口，优先使用带超时的回调。
+*/
+/**************************************************************************/
+struct VKCallbackTransport
+{
+    vk_com_fptr_t read_cb = nullptr;
+    vk_com_fptr_t write_cb = nullptr;
+    vk_com_timeout_fptr_t read_timeout_cb = nullptr;
+    vk_com_timeout_fptr_t write_timeout_cb = nullptr;
+
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        if (read_timeout_cb != nullptr)
+        {
+            return (int)read_timeout_cb(dev_addr, VK_TRANSPORT_REG_NONE, data, len, timeout_us);
+        }
+        if (read_cb != nullptr)
+        {
+            return (int)read_cb(dev_addr, VK_TRANSPORT_REG_NONE, data, len);
+        }
+        return 0;
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        if (write_timeout_cb != nullptr)
+        {
+            return (int)write_timeout_cb(dev_addr, VK_TRANSPORT_REG_NONE, data, len, timeout_us);
+        }
+        if (write_cb != nullptr)
+        {
+            return (int)write_cb(dev_addr, VK_TRANSPORT_REG_NONE, data, len);
+        }
+        return 0;
+    }
+};
+
+/**************************************************************************/
+/*!
+    @brief 模拟传输:
+    读取返回 frame 中预置的数据，写入保存最后一个配置包，用于主机端调试上层逻辑。
+*/
+/**************************************************************************/
+struct VKMockTransport
+{
+    uint8_t frame[32] = {0};
+    uint8_t lastWrite[4] = {0};
+    uint8_t lastWriteLen = 0;
+    uint32_t readCount = 0;
+    uint32_t writeCount = 0;
+    int error = 0;                      // 非0时所有传输返回该错误码
+
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)timeout_us;
+        readCount++;
+        if (error != 0)
+        {
+            return error;
+        }
+        memcpy(data, frame, (len < sizeof(frame)) ? len : sizeof(frame));
+        return 0;
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)timeout_us;
+        writeCount++;
+        if (error != 0)
+        {
+            return error;
+        }
+        lastWriteLen = (len < sizeof(lastWrite)) ? len : sizeof(lastWrite);
+        memcpy(lastWrite, data, lastWriteLen);
+        // 写入配置会使芯片重置并完成校正
+        frame[0] = 0x80;
+        return 0;
+    }
+};
+
+/**************************************************************************/
+/*!
+    @brief 回放传输:
+    依次返回录制好的状态帧(每帧 VK3809IP_FRAME_LEN 字节)，播放完后重复最后一帧或从头循环，写入被忽略。
+*/
+/**************************************************************************/
+struct VKReplayTransport
+{
+    const uint8_t *frames = nullptr;
+    uint32_t frameCount = 0;
+    uint8_t frameLen = 6;
+    bool loop = false;
+    uint32_t index = 0;
+
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)timeout_us;
+        if (frames == nullptr || frameCount == 0)
+        {
+            return -1;
+        }
+        const uint8_t *src = frames + (uint32_t)index * frameLen;
+        memcpy(data, src, (len < frameLen) ? len : frameLen);
+        if (index + 1 < frameCount)
+        {
+            index++;
+        }
+        else if (loop)
+        {
+            index = 0;
+        }
+        return 0;
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)data;
+        (void)len;
+        (void)timeout_us;
+        return 0;
+    }
+};
+
+/**************************************************************************/
+/*!
+    @brief 总线频率模拟传输:
+    错误率随频率变化，cleanHz 以下不出错，cleanHz~failHz 之间按线性增加到100%。出错的传输中
+    corruptPercent 的比例读取成功但有一位翻转(模拟上升沿太慢导致的采样错误)，其余返回错误(NACK)。
+    nowUs 按每次传输的线上时间与 overheadUs 推进，可作为时间源。用于主机端验证 VK3809IPBusProbe。
+*/
+/**************************************************************************/
+struct VKSimBusTransport
+{
+    uint8_t frame[6] = {0x80, 0, 0, 0, 0, 0};
+    uint32_t hz = 400000;
+    uint32_t cleanHz = 400000;
+    uint32_t failHz = 1000000;
+    uint8_t corruptPercent = 30;
+    uint32_t overheadUs = 40;           // 驱动调用与中断开销
+    uint32_t seed = 1;
+    uint32_t nowUs = 0;
+    uint32_t readCount = 0;
+    uint32_t errorCount = 0;
+
+    static bool setSpeed(uint32_t bus_hz, void *arg)
+    {
+        ((VKSimBusTransport *)arg)->hz = bus_hz;
+        return true;
+    }
+    uint32_t errorPpm() const
+    {
+        if (hz <= cleanHz)
+        {
+            return 0;
+        }
+        if (hz >= failHz)
+        {
+            return 1000000;
+        }
+        return (uint32_t)((uint64_t)(hz - cleanHz) * 1000000 / (failHz - cleanHz));
+    }
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)timeout_us;
+        readCount++;
+        nowUs += (uint32_t)(((uint64_t)(len + 2) * 9 + 4) * 1000000 / hz) + overheadUs;
+        memcpy(data, frame, (len < sizeof(frame)) ? len : sizeof(frame));
+        if (_random() % 1000000 >= errorPpm())
+        {
+            return 0;
+        }
+        errorCount++;
+        if (_random() % 100 < corruptPercent && len > 0)
+        {
+            data[_random() % len] ^= (uint8_t)(1 << (_random() % 8));
+            return 0;
+        }
+        return -1;
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)data;
+        (void)len;
+        (void)timeout_us;
+        nowUs += overheadUs;
+        return (_random() % 1000000 < errorPpm()) ? -1 : 0;
+    }
+
+private:
+    uint32_t _random()
+    {
+        // xorshift32，结果可复现
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+};
@@ -0,0 +1,78 @@
+/**
+ * @file vk3809ip_transport_idf.hpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief vk3809ip ESP-IDF bus transport policies
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "vk3809ip_transport.hpp"
+
+#if defined(ESP_PLATFORM)
+
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief 超时时间(us)转换为tick，向上取整后再加1个tick，与 i2c_port.c 一致
+ */
+static inline TickType_t vk_transport_ticks(uint32_t timeout_us)
+{
+    // 按 configTICK_RATE_HZ 计算，tick 短于1ms时 portTICK_PERIOD_MS 为0
+    return (TickType_t)(((uint64_t)timeout_us * configTICK_RATE_HZ + 999999) / 1000000 + 1);
+}
+
+#if __has_include("driver/i2c.h")
+#include "driver/i2c.h"
+
+/**************************************************************************/
+/*!
+    @brief 旧版 I2C 驱动(driver/i2c.h)传输:
+    端口在编译期确定，调用方负责 i2c_param_config() 与 i2c_driver_install()。
+*/
+/**************************************************************************/
+template <i2c_port_t Port>
+struct VKIdfLegacyTransport
+{
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        return i2c_master_read_from_device(Port, dev_addr, data, len, vk_transport_ticks(timeout_us));
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        return i2c_master_write_to_device(Port, dev_addr, data, len, vk_transport_ticks(timeout_us));
+    }
+};
+#endif
+
+#if __has_include("driver/i2c_master.h")
+#include "driver/i2c_master.h"
+
+/**************************************************************************/
+/*!
+    @brief 新版 I2C 驱动(driver/i2c_master.h)传输:
+    设备地址已绑定在 dev 句柄中，dev_addr 参数被忽略。
+    ! 新旧两套 I2C 驱动不能在同一工程中同时使用。
+*/
+/**************************************************************************/
+struct VKIdfMasterTransport
+{
+    i2c_master_dev_handle_t dev = nullptr;
+
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        return i2c_master_receive(dev, data, len, (int)((timeout_us + 999) / 1000));
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        return i2c_master_transmit(dev, data, len, (int)((timeout_us + 999) / 1000));
+    }
+};
+#endif
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,1051 @@
+/**
+ * @file vk_host_check.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief Linux host self-check for vk3809ip driver paths that are hard to reach on hardware
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * 编译: g++ -std=gnu++20 -O2 -Wall -Wextra -I../src vk_host_check.cpp ../src/vk3809ip.cpp ../src/vk3809ip_log.cpp ../src/vk3809ip_ring.cpp ../src/vk3809ip_debounce.cpp \
+ *      ../src/vk3809ip_telemetry.cpp ../src/vk3809ip_broker.cpp ../src/vk3809ip_linux.cpp \
+ *      ../src/vk3809ip_energy.cpp ../src/vk3809ip_busprobe.cpp ../src/vk3809ip_owner.cpp ../src/vk3809ip_coro.cpp \
+ *      ../src/vk3809ip_predict.cpp ../src/vk3809ip_encoder.cpp -pthread -o vk_host_check
+ * 用法: vk_host_check，全部通过时返回0，否则打印失败的检查并返回1
+ */
+#include <cstdio>
+#include "vk3809ip.hpp"
+#include "vk3809ip_ring.hpp"
+#include "vk3809ip_debounce.hpp"
+#include "vk3809ip_telemetry.hpp"
+#include "vk3809ip_broker.hpp"
+#include "vk3809ip_linux.hpp"
+#include "vk3809ip_energy.hpp"
+#include "vk3809ip_busprobe.hpp"
+#include "vk3809ip_owner.hpp"
+#include "vk3809ip_coro.hpp"
+#include "vk3809ip_predict.hpp"
+#include "vk3809ip_encoder.hpp"
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+// 传输出错时配置写入与状态读取都要返回失败，并计入 getBusErrorCount()
+static void check_transport_errors()
+{
+    VK3809IPT<VKMockTransport> chip;
+    CHECK(chip.begin() == 0);
+    CHECK(chip.getBusErrorCount() == 0);
+
+    chip.getTransport().error = -1;
+    CHECK(chip.settingTpxThresholdData(20, TP_NUM_3) == VK_FAIL);
+    CHECK(chip.getBusErrorCount() == 1);
+    vk_touch_state_t state;
+    CHECK(!chip.getTouchState(&state));
+    CHECK(chip.getBusErrorCount() == 2);
+    CHECK(chip.settingCommandsData(0x80, 0, 0, 0x09) == VK_FAIL);
+    CHECK(chip.getBusErrorCount() == 3);
+
+    chip.getTransport().error = 0;
+    CHECK(chip.settingTpxThresholdData(20, TP_NUM_3) == VK_PASS);
+    CHECK(chip.getBusErrorCount() == 3);
+
+    VK3809IPT<VKMockTransport> dead;
+    dead.getTransport().error = -1;
+    CHECK(dead.begin() == -2);
+}
+
+// 芯片启动过程中写入的配置包会被丢弃：传输成功，但写入标志不清零；failWrites 模拟写入NACK
+struct VKBootingTransport : VKMockTransport
+{
+    int dropWrites = 0;
+    int failWrites = 0;
+
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        if (failWrites > 0)
+        {
+            failWrites--;
+            writeCount++;
+            return -1;
+        }
+        if (dropWrites > 0)
+        {
+            dropWrites--;
+            writeCount++;
+            return 0;
+        }
+        return VKMockTransport::write(dev_addr, data, len, timeout_us);
+    }
+};
+
+static int read_until_recovered(VK3809IPT<VKBootingTransport> &chip, int limit)
+{
+    vk_touch_state_t state;
+    int frames = 0;
+    do
+    {
+        chip.getTouchState(&state);
+        frames++;
+    } while (chip.isRecovering() && frames < limit);
+    return frames;
+}
+
+// 重置恢复时配置没有生效要有限次重写，全部失败后上报 isRecoveryFailed()
+static void check_reset_recovery()
+{
+    VK3809IPT<VKBootingTransport> chip;
+    vk_touch_state_t state;
+    CHECK(chip.begin() == 0);
+    chip.getTouchState(&state);                         // 配置生效，开始监测
+
+    // 第一次重写落在启动过程中被丢弃，等待后重写成功
+    chip.getTransport().frame[0] = 0xC0;                // 校正完成，写入标志为1
+    chip.getTransport().dropWrites = 1;
+    read_until_recovered(chip, 4 * VK3809IP_REAPPLY_SETTLE);
+    CHECK(!chip.isRecovering());
+    CHECK(!chip.isRecoveryFailed());
+    CHECK(chip.getResetCount() == 1);
+
+    // 重写的传输失败，下一帧立即重写
+    chip.getTransport().frame[0] = 0xC0;
+    chip.getTransport().failWrites = 1;
+    chip.getTouchState(&state);                         // 检测到重置，重写失败
+    CHECK(chip.isRecovering());
+    chip.getTouchState(&state);                         // 重写成功
+    chip.getTouchState(&state);
+    CHECK(!chip.isRecovering());
+    CHECK(chip.getResetCount() == 2);
+
+    // 配置始终不生效，重写 VK3809IP_REAPPLY_RETRIES 次后放弃，帧恢复上报
+    chip.getTransport().frame[0] = 0xC0;
+    chip.getTransport().dropWrites = 1000;
+    uint32_t writes = chip.getTransport().writeCount;
+    read_until_recovered(chip, 10 * VK3809IP_REAPPLY_SETTLE * (VK3809IP_REAPPLY_RETRIES + 1));
+    CHECK(!chip.isRecovering());
+    CHECK(chip.isRecoveryFailed());
+    CHECK(chip.getTransport().writeCount - writes == VK3809IP_REAPPLY_RETRIES + 1);
+    chip.getTransport().frame[0] = 0xC1;                // Slide1 触摸
+    CHECK(chip.getTouchState(&state));
+    CHECK(state.slider_touch == 0x01);
+}
+
+// 两次读取间隔很短时瞬时速度被限幅，不会溢出成反向速度
+static void check_ring_velocity()
+{
+    VK3809IPRing ring;
+    ring.configure(SLIDE_X_NUM_9, false);
+    vk_touch_state_t state = {};
+    state.slider_touch = 0x01;
+    state.slider_position[0] = 10;
+    state.timestamp = 1000;
+    ring.update(state, 0);
+    state.slider_position[0] = 110;
+    state.timestamp = 1020;                             // 20us 内移动100
+    ring.update(state, 0);
+    CHECK(ring.getAngularVelocity() > 0);
+    state.slider_position[0] = 10;
+    state.timestamp = 1021;
+    ring.update(state, 0);
+    CHECK(ring.getAngularVelocity() < 0);
+}
+
+/**
+ * @brief 合成滑动轨迹: 从 start 开始每帧移动 stride(环形回绕)，帧间隔 frame_us，最后松手
+ *
+ * @return int 输出了步数的帧数
+ */
+static int encoder_swipe(VK3809IPRing &ring, VK3809IPEncoder &encoder, uint32_t *now,
+                         uint8_t start, const int *strides, int frames, uint32_t frame_us)
+{
+    vk_touch_state_t state = {};
+    state.slider_touch = 0x01;
+    int position = start;
+    int outputs = 0;
+    for (int i = 0; i <= frames; i++)
+    {
+        if (i > 0)
+        {
+            position = (position + strides[i - 1] + ring.getFullScale() + 1) % (ring.getFullScale() + 1);
+        }
+        state.slider_position[0] = (uint8_t)position;
+        state.timestamp = *now;
+        *now += frame_us;
+        ring.update(state, 0);
+        outputs += encoder.update(ring) != 0;
+    }
+    state.slider_touch = 0;
+    state.timestamp = *now;
+    ring.update(state, 0);
+    encoder.update(ring);
+    return outputs;
+}
+
+// 滑环上转两圈正好输出两圈的档位数，跨过接缝不丢步，反转回到起点
+static void check_encoder_detents()
+{
+    VK3809IPRing ring;
+    ring.configure(SLIDE_X_NUM_9, true, 239);
+    VK3809IPEncoder encoder;
+    encoder.configure(239, 24);                         // 一圈24档，每档10 counts
+    uint32_t now = 0;
+    int forward[40];
+    int backward[40];
+    for (int i = 0; i < 40; i++)
+    {
+        forward[i] = 12;
+        backward[i] = -12;
+    }
+    encoder_swipe(ring, encoder, &now, 200, forward, 40, 10000);
+    CHECK(encoder.getCount() == 48);
+    CHECK(ring.getRotation() == 480);
+    encoder_swipe(ring, encoder, &now, 200, backward, 40, 10000);
+    CHECK(encoder.getCount() == 0);
+    CHECK(ring.getRotation() == 0);
+}
+
+// 手指停在档位边界附近来回抖动4 counts: 有回滞时只输出一步，没有回滞时每次抖动都来回跳
+static void check_encoder_hysteresis()
+{
+    int jitter[21] = {8};
+    for (int i = 1; i < 21; i++)
+    {
+        jitter[i] = (i & 1) ? -4 : 4;
+    }
+    const uint8_t percents[] = {25, 0};
+    int outputs[2];
+    for (int i = 0; i < 2; i++)
+    {
+        VK3809IPRing ring;
+        ring.configure(SLIDE_X_NUM_9, false, 239);
+        VK3809IPEncoder encoder;
+        encoder.configure(239, 24, percents[i]);
+        uint32_t now = 0;
+        outputs[i] = encoder_swipe(ring, encoder, &now, 100, jitter, 21, 10000);
+        CHECK(encoder.getCount() == 1);
+    }
+    CHECK(outputs[0] == 1);
+    CHECK(outputs[1] == 21);
+}
+
+// 同样的位移慢速滑动不加速，快速滑动时随平滑后的速度依次进入2倍、4倍段
+static void check_encoder_acceleration()
+{
+    static const vk_encoder_accel_t curve[] = {{1000, 2}, {3000, 4}};
+    const int strides[5] = {10, 10, 10, 10, 10};       // 每帧一档
+    const uint32_t frame_us[2] = {50000, 2000};         // 200 counts/s 与 5000 counts/s
+    const int32_t expect[2] = {5, 2 + 2 + 2 + 4 + 4};   // 平滑速度约 1250/2188/2891/3418/3813 counts/s
+    for (int i = 0; i < 2; i++)
+    {
+        VK3809IPRing ring;
+        ring.configure(SLIDE_X_NUM_9, false, 239);
+        VK3809IPEncoder encoder;
+        encoder.configure(239, 24);
+        CHECK(encoder.setAcceleration(curve, 2));
+        uint32_t now = 1000;
+        encoder_swipe(ring, encoder, &now, 50, strides, 5, frame_us[i]);
+        CHECK(encoder.getCount() == expect[i]);
+    }
+    VK3809IPEncoder encoder;
+    static const vk_encoder_accel_t unsorted[] = {{3000, 4}, {1000, 2}};
+    CHECK(!encoder.setAcceleration(unsorted, 2));
+}
+
+// 每1ms一帧按 pattern 输入 Key1 与 Slide1 触摸标志，edges 为两个通道消抖后的边沿数，返回原始边沿数
+static int debounce_edges(VK3809IPDebounce &debounce, const char *pattern, uint32_t *now, int edges[2])
+{
+    vk_touch_state_t in = {}, out = {};
+    uint16_t key = 0;
+    uint8_t touch = 0;
+    int raw = 0;
+    char last = '0';
+    edges[0] = edges[1] = 0;
+    for (const char *p = pattern; *p; p++)
+    {
+        raw += (*p != last);
+        last = *p;
+        in.key_mask = (*p == '1') ? 0x001 : 0;
+        in.slider_touch = (*p == '1') ? 0x01 : 0;
+        *now += 1000;
+        in.timestamp = *now;
+        debounce.filter(in, &out);
+        edges[0] += (out.key_mask & 0x001) != key;
+        edges[1] += (out.slider_touch & 0x01) != touch;
+        key = out.key_mask & 0x001;
+        touch = out.slider_touch & 0x01;
+    }
+    return raw;
+}
+
+// 按下与松开各带一段抖动，空闲时有1~3帧毛刺: 积分器(4帧)与时间窗(4ms)都只输出一次按下一次松开
+static void check_debounce_bounce()
+{
+    static const char *bounce = "10101" "111111111111111" "0101" "000111" "000000000000000"
+                                "0001000" "00100000" "0111000";
+    static const struct
+    {
+        vk_debounce_mode_t mode;
+        uint32_t param;
+    } modes[] = {{VK_DEBOUNCE_INTEGRATOR, 4}, {VK_DEBOUNCE_WINDOW, 4000}};
+    int edges[2];
+
+    VK3809IPDebounce debounce;
+    uint32_t now = 0;
+    int raw = debounce_edges(debounce, bounce, &now, edges);
+    CHECK(raw == 18);
+    CHECK(edges[0] == raw && edges[1] == raw);
+
+    for (const auto &m : modes)
+    {
+        debounce.configureAll(m.mode, m.param);
+        CHECK(debounce_edges(debounce, bounce, &now, edges) == raw);
+        CHECK(edges[0] == 2 && edges[1] == 2);
+        CHECK(!debounce.hasPending());
+        // 按下2次、松开3次、空闲3次毛刺
+        CHECK(debounce.getSuppressedCount(0) == 8);
+        CHECK(debounce.getSuppressedCount(9) == 8);
+    }
+
+    // 抖动间隔都不超过确认时间时一直不翻转
+    for (const auto &m : modes)
+    {
+        debounce.configureAll(m.mode, m.param);
+        debounce_edges(debounce, "101010101010101010100", &now, edges);
+        CHECK(edges[0] == 0 && edges[1] == 0);
+    }
+}
+
+// 积分器帧数为0时直接输出，帧数超出计数器范围时取上限而不是永远无法确认
+static void check_debounce_params()
+{
+    VK3809IPDebounce debounce;
+    vk_touch_state_t in = {}, out;
+    debounce.configureAll(VK_DEBOUNCE_INTEGRATOR, 0);
+    in.key_mask = 0x001;
+    for (int i = 0; i < 3; i++)
+    {
+        debounce.filter(in, &out);
+        CHECK(out.key_mask == 0x001);
+    }
+    in.key_mask = 0;
+    debounce.filter(in, &out);
+    CHECK(out.key_mask == 0);
+
+    debounce.configureAll(VK_DEBOUNCE_INTEGRATOR, 100000);
+    in.key_mask = 0x001;
+    for (uint32_t i = 1; i < VK_DEBOUNCE_INTEGRATOR_MAX; i++)
+    {
+        debounce.filter(in, &out);
+    }
+    CHECK(out.key_mask == 0);
+    debounce.filter(in, &out);
+    CHECK(out.key_mask == 0x001);
+}
+
+static void telemetry_frame(uint32_t i, uint8_t *frame)
+{
+    frame[0] = 0x80 | (uint8_t)((i / 7) & 0x01);
+    frame[1] = (uint8_t)(i / 5);
+    frame[2] = 0;
+    frame[3] = (uint8_t)(i * 3);
+    frame[4] = 0;
+    frame[5] = 0;
+}
+
+static uint32_t telemetry_sink(const uint8_t *data, uint32_t len, void *arg)
+{
+    std::vector<uint8_t> *stream = (std::vector<uint8_t> *)arg;
+    stream->insert(stream->end(), data, data + len);
+    return len;
+}
+
+struct TelemetryResult
+{
+    uint32_t frames;
+    uint32_t wrong;
+};
+
+static void telemetry_record(const vk_telemetry_record_t *r, void *arg)
+{
+    TelemetryResult *result = (TelemetryResult *)arg;
+    if (r->type != VK_TELEMETRY_KEYFRAME && r->type != VK_TELEMETRY_FRAME)
+    {
+        return;
+    }
+    uint8_t expect[VK3809IP_FRAME_LEN];
+    telemetry_frame(r->timestamp / 1000, expect);
+    result->frames++;
+    result->wrong += memcmp(expect, r->frame, VK3809IP_FRAME_LEN) != 0;
+}
+
+// 一个字节损坏或丢失一整条记录后不能还原出错误的帧，并在下一条 KEYFRAME 恢复
+static void check_telemetry_resync()
+{
+    const uint32_t count = 3 * VK_TELEMETRY_KEYFRAME_INTERVAL;
+    VK3809IPTelemetry telemetry;
+    std::vector<uint8_t> stream;
+    std::vector<size_t> starts;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t frame[VK3809IP_FRAME_LEN];
+        telemetry_frame(i, frame);
+        starts.push_back(stream.size());
+        telemetry.writeFrame(frame, i * 1000);
+        telemetry.drain(telemetry_sink, &stream);
+    }
+
+    TelemetryResult clean = {0, 0};
+    VK3809IPTelemetryDecoder decoder(telemetry_record, &clean);
+    decoder.feed(stream.data(), (uint32_t)stream.size());
+    CHECK(clean.frames == count && clean.wrong == 0 && decoder.getErrorCount() == 0);
+
+    std::vector<uint8_t> corrupted = stream;
+    corrupted[starts[10] + 5] ^= 0x10;                  // 差分记录中的一个字节
+    TelemetryResult bad = {0, 0};
+    VK3809IPTelemetryDecoder decoder2(telemetry_record, &bad);
+    decoder2.feed(corrupted.data(), (uint32_t)corrupted.size());
+    CHECK(bad.wrong == 0);
+    CHECK(decoder2.getErrorCount() >= 1);
+    CHECK(bad.frames >= count - VK_TELEMETRY_KEYFRAME_INTERVAL);
+
+    std::vector<uint8_t> gap(stream.begin(), stream.begin() + starts[20]);
+    gap.insert(gap.end(), stream.begin() + starts[21], stream.end());   // 丢失第20条记录
+    TelemetryResult lost = {0, 0};
+    VK3809IPTelemetryDecoder decoder3(telemetry_record, &lost);
+    decoder3.feed(gap.data(), (uint32_t)gap.size());
+    CHECK(lost.wrong == 0);
+    CHECK(decoder3.getLostCount() == 1);
+    CHECK(lost.frames < count - 1 && lost.frames >= count - 1 - VK_TELEMETRY_KEYFRAME_INTERVAL);
+}
+
+// 其它传输的驱动通过 VK3809IPDeviceT 声明后也可以交给事件分发等模块
+static void check_device_interface()
+{
+    VK3809IPDeviceT<VKMockTransport> chip;
+    VK3809IPDevice &device = chip;
+    vk_touch_state_t state;
+    CHECK(chip.begin() == 0);
+    CHECK(device.getTouchState(&state));
+
+    VK3809IPBroker broker;
+    vk_event_filter_t filter = {VK_EVT_SLIDER_TOUCH, 0x07, 0};
+    int id = broker.subscribeQueue(filter);
+    CHECK(id >= 0);
+    chip.getTransport().frame[0] = 0x81;                // Slide1 触摸
+    CHECK(broker.process(device));
+    vk_touch_event_t event;
+    CHECK(broker.poll(id, &event));
+    CHECK(event.slider_touched == 0x01);
+
+    chip.getTransport().error = -1;
+    CHECK(device.settingSleepThresholdData(20) == VK_FAIL);
+    CHECK(device.getBusErrorCount() == chip.getBusErrorCount() && chip.getBusErrorCount() == 1);
+}
+
+// 多个线程反复订阅、取消订阅，同一订阅号同时只能分配给一个线程(多核主机上才容易触发竞争)
+static void check_broker_subscribe_race()
+{
+    const int threads = 4;
+    const int rounds = 20000;
+    VK3809IPBroker broker;
+    vk_event_filter_t filter = {VK_EVT_FRAME, 0, 0};
+    std::atomic<int> owners[VK_BROKER_MAX_SUBSCRIBERS];
+    for (std::atomic<int> &owner : owners)
+    {
+        owner = 0;
+    }
+    std::atomic<uint32_t> shared{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < rounds; i++)
+            {
+                int id = broker.subscribeQueue(filter);
+                if (id < 0)
+                {
+                    continue;
+                }
+                shared += owners[id].fetch_add(1) != 0;
+                std::this_thread::yield();              // 持有期间让其它线程运行
+                owners[id].fetch_sub(1);
+                broker.unsubscribe(id);
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    CHECK(shared.load() == 0);
+}
+
+static int failing_ioctl(int fd, unsigned long request, void *arg)
+{
+    (void)fd;
+    (void)arg;
+    if (request == I2C_TIMEOUT)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+static int ok_ioctl(int fd, unsigned long request, void *arg)
+{
+    (void)fd;
+    (void)request;
+    (void)arg;
+    return 0;
+}
+
+// 设置超时失败时 open() 返回 -errno 并关闭设备；移动后只有新对象持有设备
+static void check_linux_transport()
+{
+    VKLinuxI2CTransport bus;
+    bus.ioctl_cb = failing_ioctl;
+    CHECK(bus.open("/dev/null") == -EINVAL);
+    CHECK(bus.fd == -1);
+
+    bus.ioctl_cb = ok_ioctl;
+    CHECK(bus.open("/dev/null") == 0);
+    int fd = bus.fd;
+    VK3809IPT<VKLinuxI2CTransport> chip(std::move(bus));
+    CHECK(bus.fd == -1);
+    CHECK(chip.getTransport().fd == fd);
+}
+
+// 超过 2^31us(约35.8分钟)的空闲间隔照常累计，32位时间戳回绕也不影响
+static void check_energy_long_gap()
+{
+    const uint32_t gap = 37UL * 60 * 1000000;         // 37分钟
+    const uint32_t timeout = VK_ENERGY_SLEEP_TIMEOUT_MS * 1000;
+    const uint32_t starts[] = {0, 0xFFFFFFFFUL - 1000000};
+    for (uint32_t start : starts)
+    {
+        VK3809IPEnergy energy;
+        energy.reset(start);
+        vk_touch_state_t state = {};
+        state.timestamp = start;
+        energy.recordFrame(state);
+        energy.advance(start + gap);
+        CHECK(energy.getElapsedTime() == gap);
+        CHECK(energy.getStateTime(VK_POWER_ACTIVE) == timeout);
+        CHECK(energy.getStateTime(VK_POWER_SLEEP) == gap - timeout);
+        CHECK(energy.getPowerState() == VK_POWER_SLEEP);
+
+        state.timestamp = start + gap + 1000;            // 睡眠中读取唤醒芯片
+        energy.recordFrame(state);
+        CHECK(energy.getWakeReadCount() == 1);
+        energy.advance(state.timestamp + gap);
+        CHECK(energy.getStateTime(VK_POWER_ACTIVE) == 2ULL * timeout);
+        CHECK(energy.getElapsedTime() == 2ULL * gap + 1000);
+    }
+}
+
+// 短时间统计的平均电流不受 nAh 取整影响: 睡眠1秒为 6.8uA
+static void check_energy_average()
+{
+    vk_energy_config_t config = VK3809IPEnergy::defaultConfig();
+    config.sleep_timeout_ms = 0;
+    VK3809IPEnergy energy;
+    energy.configure(config, true);
+    energy.reset(0);
+    energy.advance(1000000);
+    CHECK(energy.getStateTime(VK_POWER_SLEEP) == 1000000);
+    CHECK(energy.getAverageCurrentNa() == VK_ENERGY_CHIP_SLEEP_NA);
+}
+
+// 录制的触摸记录: 20秒后滑动一次，再过10秒按住1.5秒，共60秒
+struct EnergyTraceEvent
+{
+    uint32_t ms;
+    uint8_t touch;
+    uint8_t position;
+};
+static const EnergyTraceEvent energy_trace[] = {
+    {0, 0, 0}, {20000, 1, 40}, {20100, 1, 80}, {20200, 1, 120}, {20300, 0, 120}, {31000, 1, 200}, {32500, 0, 200},
+};
+static const uint32_t energy_trace_ms = 60000;
+static uint32_t energy_now;
+
+static uint32_t energy_time()
+{
+    return energy_now;
+}
+
+static void energy_trace_frame(uint32_t ms, uint8_t *frame)
+{
+    const EnergyTraceEvent *event = &energy_trace[0];
+    for (const EnergyTraceEvent &e : energy_trace)
+    {
+        if (e.ms <= ms)
+        {
+            event = &e;
+        }
+    }
+    memset(frame, 0, VK3809IP_FRAME_LEN);
+    frame[0] = 0x80 | event->touch;                     // 已校正、配置已写入
+    frame[SLIDE_1_POSITION] = event->position;
+}
+
+/**
+ * @brief 用回放传输按一种读取方式重放触摸记录:
+ * poll_ms 为0时只在触摸变化(INT)时读取，否则按周期轮询
+ */
+static VK3809IPEnergy replay_energy(uint32_t poll_ms, bool power_save)
+{
+    std::vector<uint32_t> times;
+    if (poll_ms == 0)
+    {
+        for (const EnergyTraceEvent &e : energy_trace)
+        {
+            times.push_back(e.ms);
+        }
+    }
+    else
+    {
+        for (uint32_t ms = 0; ms < energy_trace_ms; ms += poll_ms)
+        {
+            times.push_back(ms);
+        }
+    }
+    std::vector<uint8_t> frames(times.size() * VK3809IP_FRAME_LEN);
+    for (size_t i = 0; i < times.size(); i++)
+    {
+        energy_trace_frame(times[i], &frames[i * VK3809IP_FRAME_LEN]);
+    }
+
+    VK3809IPDeviceT<VKReplayTransport> chip;
+    CHECK(chip.begin() == 0);
+    chip.getTransport().frames = frames.data();
+    chip.getTransport().frameCount = (uint32_t)times.size();
+    chip.getTransport().frameLen = VK3809IP_FRAME_LEN;
+    chip.setTimeSource(energy_time);
+
+    VK3809IPEnergy energy;
+    energy.configure(VK3809IPEnergy::defaultConfig(), power_save);
+    energy.reset(0);
+    vk_touch_state_t state;
+    for (uint32_t ms : times)
+    {
+        energy_now = ms * 1000;
+        CHECK(chip.getTouchState(&state));
+        energy.recordFrame(state);
+    }
+    energy.advance(energy_trace_ms * 1000);
+    return energy;
+}
+
+// 比较轮询、中断与省电模式: 轮询让芯片无法睡眠，中断加省电模式只在触摸前后工作
+static void check_energy_replay()
+{
+    VK3809IPEnergy poll = replay_energy(10, false);
+    VK3809IPEnergy pollSave = replay_energy(10, true);
+    VK3809IPEnergy irq = replay_energy(0, false);
+    VK3809IPEnergy irqSave = replay_energy(0, true);
+
+    CHECK(poll.getReadCount() == energy_trace_ms / 10);
+    CHECK(pollSave.getWakeReadCount() > 0);             // 每次睡下后下一次轮询就把芯片唤醒
+    CHECK(pollSave.getStateTime(VK_POWER_SLEEP) * 100 < pollSave.getElapsedTime());
+    CHECK(pollSave.getAverageCurrentNa() * 100 > poll.getAverageCurrentNa() * 99);
+    CHECK(irq.getReadCount() == sizeof(energy_trace) / sizeof(energy_trace[0]));
+    CHECK(irqSave.getStateTime(VK_POWER_SLEEP) == (16000 + 6700 + 23500) * 1000ULL);
+    CHECK(irqSave.getWakeReadCount() == 2);
+    CHECK(irq.getAverageCurrentNa() < poll.getAverageCurrentNa());
+    CHECK(irqSave.getAverageCurrentNa() < irq.getAverageCurrentNa());
+
+    const VK3809IPEnergy *results[] = {&poll, &pollSave, &irq, &irqSave};
+    const char *names[] = {"poll 10ms", "poll 10ms + power save", "interrupt", "interrupt + power save"};
+    for (int i = 0; i < 4; i++)
+    {
+        printf("energy: %-24s %8u nA, %6u h on 220 mAh\n", names[i],
+               (unsigned)results[i]->getAverageCurrentNa(), (unsigned)results[i]->estimateBatteryHours(220));
+    }
+}
+
+// 最大加速度下外推几十ms就超出32位，预测位置仍停在量程端点而不是回绕
+static void check_predict_overflow()
+{
+    static const uint8_t swipes[2][3] = {{0, 0, 255}, {255, 255, 0}};
+    for (int dir = 0; dir < 2; dir++)
+    {
+        VK3809IPPredictor predictor;
+        predictor.configure(0, SLIDE_X_NUM_9, 255);
+        predictor.setHorizon(100000);
+        vk_touch_state_t state = {};
+        state.slider_touch = 0x01;
+        for (int i = 0; i < 3; i++)
+        {
+            state.timestamp = 500 * (i + 1);
+            state.slider_position[0] = swipes[dir][i];
+            predictor.update(state);
+        }
+        int wrong = 0;
+        for (uint32_t ms = 1; ms <= 100; ms++)
+        {
+            wrong += predictor.predict(0, state.timestamp + ms * 1000) != swipes[dir][2];
+        }
+        CHECK(wrong == 0);
+    }
+}
+
+/**
+ * @brief 预测精度: 合成的往复滑动轨迹(10ms一帧，±2 counts噪声)，渲染时刻比读取晚 latency_us，
+ * 分别用最近一帧与预测位置作为渲染位置，返回两者相对真实位置的平均绝对误差(counts)
+ */
+static void predict_trace_error(uint32_t latency_us, double *raw_error, double *predict_error)
+{
+    const uint32_t frame_us = 10000;
+    const int frames = 300;
+    VK3809IPPredictor predictor;
+    predictor.configure(0, SLIDE_X_NUM_9, 255);
+    uint32_t seed = 12345;
+    double raw_sum = 0;
+    double predict_sum = 0;
+    int samples = 0;
+    auto truth = [](double t_us) { return 128.0 + 100.0 * sin(2 * M_PI * t_us / 800000.0); };
+    for (int i = 0; i < frames; i++)
+    {
+        uint32_t t = (uint32_t)i * frame_us;
+        seed = seed * 1103515245U + 12345U;
+        int noise = (int)((seed >> 16) % 5) - 2;
+        vk_touch_state_t state = {};
+        state.slider_touch = 0x01;
+        state.slider_position[0] = (uint8_t)lround(truth(t) + noise);
+        state.timestamp = t;
+        predictor.update(state);
+        if (i < 10)
+        {
+            continue;                                   // 跳过开始的收敛过程
+        }
+        double target = truth(t + latency_us);
+        raw_sum += fabs(state.slider_position[0] - target);
+        predict_sum += fabs(predictor.predict(0, t + latency_us) - target);
+        samples++;
+    }
+    *raw_error = raw_sum / samples;
+    *predict_error = predict_sum / samples;
+}
+
+static void check_predict_accuracy()
+{
+    const uint32_t latencies[] = {8000, 16000, 30000};
+    for (uint32_t latency : latencies)
+    {
+        double raw;
+        double predicted;
+        predict_trace_error(latency, &raw, &predicted);
+        CHECK(predicted < raw);
+        printf("predict: latency %2u ms, mean error %.2f counts raw vs %.2f predicted\n",
+               (unsigned)(latency / 1000), raw, predicted);
+    }
+}
+
+// 默认0.1%预算下错误率正好为0.1%的链路几乎不能通过，没有错误的链路读满 3/预算 次后通过
+static void check_busprobe_budget()
+{
+    CHECK(VK3809IPBusProbe::getRequiredSamples(VK_BUSPROBE_BUDGET_PPM) == 3000);
+    static const uint32_t speeds[] = {400000, 400500};  // 400.5kHz 下错误率为 1000ppm
+    vk_busprobe_config_t config = VK3809IPBusProbe::defaultConfig();
+    config.speeds = speeds;
+    config.count = 2;
+
+    int passed = 0;
+    const int runs = 40;
+    for (int seed = 1; seed <= runs; seed++)
+    {
+        VK3809IPBusProbe probe;
+        CHECK(probe.configure(config));
+        VKSimBusTransport bus;
+        bus.cleanHz = 400000;
+        bus.failHz = 900000;
+        bus.seed = (uint32_t)seed * 2654435761U;
+        probe.run(bus, VKSimBusTransport::setSpeed, &bus);
+        CHECK(probe.isPassed() && probe.getResult(0)->samples == 3000);
+        passed += probe.getSelectedSpeed() == speeds[1];
+    }
+    CHECK(passed <= runs / 5);                          // 期望约5%
+
+    VK3809IPBusProbe probe;
+    config.error_budget_ppm = 10;                       // 65535 次读取也无法说明
+    CHECK(!probe.configure(config));
+}
+
+// 所有者压力测试的传输: 两次传输在时间上重叠即说明有任务绕过了所有者；写 TP5 阈值时返回NACK
+struct VKOverlapStats
+{
+    std::atomic<int> active{0};
+    std::atomic<uint32_t> overlaps{0};
+    std::atomic<uint32_t> transfers{0};
+};
+
+struct VKOverlapTransport
+{
+    VKOverlapStats *stats = nullptr;
+
+    int read(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)timeout_us;
+        _enter();
+        memset(data, 0, len);
+        data[0] = 0x80;                                 // 已完成校正，没有触摸
+        _leave();
+        return 0;
+    }
+    int write(uint8_t dev_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
+    {
+        (void)dev_addr;
+        (void)timeout_us;
+        _enter();
+        int ret = (len == 3 && data[0] == TP_NUM_5) ? -1 : 0;
+        _leave();
+        return ret;
+    }
+
+private:
+    void _enter()
+    {
+        if (stats->active.fetch_add(1) != 0)
+        {
+            stats->overlaps.fetch_add(1);
+        }
+        stats->transfers.fetch_add(1);
+        usleep(20);                                     // 放大重叠窗口
+    }
+    void _leave() { stats->active.fetch_sub(1); }
+};
+
+static VK3809IPDeviceT<VKOverlapTransport> make_overlap_chip(VKOverlapStats &stats)
+{
+    VKOverlapTransport bus;
+    bus.stats = &stats;
+    return VK3809IPDeviceT<VKOverlapTransport>(bus);
+}
+
+// 写入失败的命令以及被它覆盖的同一寄存器命令都报告失败，其它命令不受影响
+static void check_owner_results()
+{
+    VKOverlapStats stats;
+    VK3809IPDeviceT<VKOverlapTransport> chip = make_overlap_chip(stats);
+    VK3809IPOwner owner;
+    uint32_t first = owner.setThreshold(30, TP_NUM_5);  // 启动前提交，同一批执行
+    uint32_t last = owner.setThreshold(40, TP_NUM_5);
+    uint32_t other = owner.setThreshold(30, TP_NUM_3);
+    CHECK(owner.getResult(first) == VK_CMD_RESULT_PENDING);
+    CHECK(owner.start(chip));
+    while (!owner.isDone(other))
+    {
+        usleep(100);
+    }
+    owner.stop();
+    CHECK(owner.getResult(first) == VK_CMD_RESULT_FAILED);
+    CHECK(owner.getResult(last) == VK_CMD_RESULT_FAILED);
+    CHECK(owner.getResult(other) == VK_CMD_RESULT_OK);
+    CHECK(owner.getFailedCount() == 2);
+    CHECK(owner.getMergedCount() == 1);
+    CHECK(owner.getResult(0) == VK_CMD_RESULT_PENDING);
+}
+
+// 多个线程同时提交命令、通知读取与查询快照，总线上不能出现重叠传输，每条命令的结果与目标一致
+static void check_owner_stress()
+{
+    const int threads = 6;
+    const int commands = 300;
+    VKOverlapStats stats;
+    VK3809IPDeviceT<VKOverlapTransport> chip = make_overlap_chip(stats);
+    VK3809IPOwner owner;
+    vk_owner_config_t config = VK3809IPOwner::defaultConfig();
+    config.poll_ms = 1;
+    CHECK(owner.start(chip, config));
+
+    std::atomic<uint32_t> wrong{0};
+    std::atomic<uint32_t> checked{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]() {
+            vk_touch_state_t state;
+            for (int i = 0; i < commands; i++)
+            {
+                tpx_setting_number_t tp = (tpx_setting_number_t)(TP_NUM_0 + (t + i) % 9);
+                uint32_t ticket;
+                while ((ticket = (i % 4 == 3) ? owner.setSleepThreshold((uint16_t)(10 + i))
+                                              : owner.setThreshold((uint16_t)(10 + i), tp)) == 0)
+                {
+                    usleep(50);                         // 队列满
+                }
+                owner.notifyFrame();
+                owner.getTouchState(&state);
+                while (!owner.isDone(ticket))
+                {
+                    usleep(20);
+                }
+                vk_command_result_t result = owner.getResult(ticket);
+                if (result == VK_CMD_RESULT_EXPIRED)
+                {
+                    continue;
+                }
+                bool fails = i % 4 != 3 && tp == TP_NUM_5;
+                wrong += result != (fails ? VK_CMD_RESULT_FAILED : VK_CMD_RESULT_OK);
+                checked++;
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    owner.stop();
+    CHECK(stats.overlaps.load() == 0);
+    CHECK(stats.transfers.load() > (uint32_t)(threads * commands / 2));
+    CHECK(wrong.load() == 0);
+    CHECK(checked.load() > (uint32_t)(threads * commands / 2));
+    CHECK(owner.getDropCount() == 0);
+    CHECK(owner.getCommandCount() + owner.getMergedCount() == (uint32_t)(threads * commands));
+    CHECK(owner.getFailedCount() > 0);
+}
+
+#if VK3809IP_HAS_CORO
+static uint32_t coro_now;
+
+static uint32_t coro_time()
+{
+    return coro_now;
+}
+
+static VK3809IPTask coro_switch(VK3809IPCoroScheduler &sched, const vk_profile_t *profile, int32_t *result)
+{
+    *result = co_await sched.applyConfig(profile);
+}
+
+static VK3809IPTask coro_frames(VK3809IPCoroScheduler &sched, int count, int *frames)
+{
+    while (*frames < count)
+    {
+        co_await sched.nextFrame();
+        (*frames)++;
+    }
+}
+
+// 配置切换的 co_await 结果: 写入失败为-1，与当前配置相同为0，否则为切换耗时
+static void check_coro_config()
+{
+    static const uint16_t thresholds[VK3809IP_TP_NUM] = {30, 30, 30, 30, 30, 30, 30, 30, 30};
+    vk_profile_t profile;
+    VK3809IP::buildProfile(&profile, "test", 0xC0, 0x20, 0x08, 0x00, thresholds, 10);  // Byte1 bit7 为滑条应用模式
+
+    VK3809IPDeviceT<VKBootingTransport> failing;
+    CHECK(failing.begin() == 0);
+    VK3809IPCoroScheduler failSched;
+    CHECK(failSched.begin(failing));
+    failing.getTransport().failWrites = 100;
+    int32_t result = 12345;
+    CHECK(coro_switch(failSched, &profile, &result).isStarted());
+    CHECK(result == -1);                                // 不挂起，也不是上一次的切换耗时
+
+    VK3809IPDeviceT<VKBootingTransport> chip;
+    CHECK(chip.begin() == 0);
+    chip.setTimeSource(coro_time);
+    VK3809IPCoroScheduler sched;
+    CHECK(sched.begin(chip));
+    coro_now = 1000;
+    result = 12345;
+    CHECK(coro_switch(sched, &profile, &result).isStarted());
+    CHECK(result == 12345 && sched.getWaiterCount() == 1);
+    coro_now = 1500;
+    sched.poll();
+    CHECK(result == 500);
+    CHECK(sched.getWaiterCount() == 0);
+
+    result = 12345;
+    coro_switch(sched, &profile, &result);
+    CHECK(result == 0);
+    CHECK(vk_coro_get_in_use() == 0);
+}
+
+// 协程方式只需要协程帧，共用调用 poll() 的任务的栈；每个处理一个任务时每个处理都要一个独立的栈
+static void check_coro_footprint()
+{
+    const int handlers = 4;
+    const uint32_t task_stack = 2048;                   // ESP-IDF 中调用驱动的处理任务常用的栈大小，不含TCB
+    VK3809IPDeviceT<VKMockTransport> chip;
+    CHECK(chip.begin() == 0);
+    chip.getTransport().frame[0] = 0x80;
+    VK3809IPCoroScheduler sched;
+    CHECK(sched.begin(chip));
+
+    int frames[handlers] = {0};
+    for (int i = 0; i < handlers; i++)
+    {
+        CHECK(coro_frames(sched, i + 1, &frames[i]).isStarted());
+    }
+    CHECK(vk_coro_get_in_use() == (uint32_t)handlers);
+    for (int i = 0; i < handlers; i++)
+    {
+        sched.poll();
+    }
+    for (int i = 0; i < handlers; i++)
+    {
+        CHECK(frames[i] == i + 1);
+    }
+    CHECK(vk_coro_get_in_use() == 0);
+
+    uint32_t coro_bytes = handlers * VK_CORO_BLOCK_SIZE;
+    CHECK(vk_coro_get_max_frame() <= VK_CORO_BLOCK_SIZE);
+    CHECK(coro_bytes < handlers * task_stack);
+    printf("footprint: %d handlers, largest coroutine frame %u B, pool %u B vs task-per-handler stacks %u B\n",
+           handlers, (unsigned)vk_coro_get_max_frame(), (unsigned)coro_bytes, (unsigned)(handlers * task_stack));
+}
+#endif
+
+int main()
+{
+    check_transport_errors();
+    check_reset_recovery();
+    check_ring_velocity();
+    check_encoder_detents();
+    check_encoder_hysteresis();
+    check_encoder_acceleration();
+    check_debounce_params();
+    check_debounce_bounce();
+    check_telemetry_resync();
+    check_device_interface();
+    check_broker_subscribe_race();
+    check_linux_transport();
+    check_energy_long_gap();
+    check_energy_average();
+    check_energy_replay();
+    check_predict_overflow();
+    check_predict_accuracy();
+    check_busprobe_budget();
+    check_owner_results();
+    check_owner_stress();
+#if VK3809IP_HAS_CORO
+    check_coro_config();
+    check_coro_footprint();
+#endif
+    if (failures != 0)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file vk_lvgl_check.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief Headless LVGL check for the vk3809ip encoder/keypad adapter
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * 需要 LVGL v8 或 v9 的源码(例如 git clone -b release/v9.2 https://github.com/lvgl/lvgl)，用默认配置，不需要 lv_conf.h:
+ *   mkdir -p lvobj && for f in $(find lvgl/src -name '*.c'); do gcc -c -O1 -DLV_CONF_SKIP -Ilvgl $f -o lvobj/$(echo $f | tr / _).o; done
+ *   ar rcs liblvgl.a $(find lvobj -name '*.o')
+ *   g++ -O2 -Wall -Wextra -DLV_CONF_SKIP -Ilvgl -I../src vk_lvgl_check.cpp ../src/vk3809ip_lvgl.cpp ../src/vk3809ip_encoder.cpp \
+ *       ../src/vk3809ip_ring.cpp liblvgl.a -o vk_lvgl_check
+ * 用法: vk_lvgl_check，用空显示驱动无界面运行，全部通过时返回0，否则打印失败的检查并返回1
+ */
+#include <cstdio>
+#include "vk3809ip_lvgl.hpp"
+
+#if !VK3809IP_HAS_LVGL
+#error "vk_lvgl_check needs lvgl.h in the include path"
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#define DISPLAY_WIDTH 64
+#define DISPLAY_HEIGHT 64
+#define BUTTONS 10
+#define FRAME_MS 20
+
+static lv_obj_t *buttons[BUTTONS];
+static int clicks[BUTTONS];
+static uint32_t now_us;
+
+// 空显示驱动: 不输出像素，只通知 LVGL 刷新完成
+#if LVGL_VERSION_MAJOR >= 9
+static void flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    (void)area;
+    (void)px_map;
+    lv_display_flush_ready(disp);
+}
+#else
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p)
+{
+    (void)area;
+    (void)color_p;
+    lv_disp_flush_ready(drv);
+}
+#endif
+
+static void create_display()
+{
+#if LVGL_VERSION_MAJOR >= 9
+    static uint8_t buf[DISPLAY_WIDTH * 10 * 4];
+    lv_display_t *disp = lv_display_create(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    lv_display_set_buffers(disp, buf, nullptr, sizeof(buf), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(disp, flush);
+#else
+    static lv_color_t buf[DISPLAY_WIDTH * 10];
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_disp_drv_t drv;
+    lv_disp_draw_buf_init(&draw_buf, buf, nullptr, DISPLAY_WIDTH * 10);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = DISPLAY_WIDTH;
+    drv.ver_res = DISPLAY_HEIGHT;
+    drv.flush_cb = flush;
+    drv.draw_buf = &draw_buf;
+    lv_disp_drv_register(&drv);
+#endif
+}
+
+static void clicked(lv_event_t *e)
+{
+    clicks[(intptr_t)lv_event_get_user_data(e)]++;
+}
+
+static lv_group_t *create_buttons()
+{
+    lv_group_t *group = lv_group_create();
+    for (intptr_t i = 0; i < BUTTONS; i++)
+    {
+#if LVGL_VERSION_MAJOR >= 9
+        buttons[i] = lv_button_create(lv_screen_active());
+#else
+        buttons[i] = lv_btn_create(lv_scr_act());
+#endif
+        lv_obj_add_event_cb(buttons[i], clicked, LV_EVENT_CLICKED, (void *)i);
+        lv_group_add_obj(group, buttons[i]);
+    }
+    return group;
+}
+
+static int focused(lv_group_t *group)
+{
+    lv_obj_t *obj = lv_group_get_focused(group);
+    for (int i = 0; i < BUTTONS; i++)
+    {
+        if (buttons[i] == obj)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 触摸任务交接一帧，LVGL 任务随后运行一轮
+static void step(VK3809IPLvgl &adapter, uint8_t slider_touch, uint8_t position, uint16_t keys, uint32_t frame_ms = FRAME_MS)
+{
+    vk_touch_state_t state = {};
+    state.slider_touch = slider_touch;
+    state.slider_position[0] = position;
+    state.key_mask = keys;
+    now_us += frame_ms * 1000;
+    state.timestamp = now_us;
+    adapter.feed(state);
+    adapter.service();
+    lv_tick_inc(frame_ms);
+    lv_timer_handler();
+}
+
+// 按下后每帧滑过 stride，最后松开；返回焦点移动的按钮数
+static int swipe(VK3809IPLvgl &adapter, lv_group_t *group, int frames, uint8_t stride, uint32_t frame_ms)
+{
+    int before = focused(group);
+    uint8_t position = 16;
+    step(adapter, 0x01, position, 0, frame_ms);
+    for (int i = 0; i < frames; i++)
+    {
+        position += stride;
+        step(adapter, 0x01, position, 0, frame_ms);
+    }
+    step(adapter, 0x00, 0, 0);
+    return (focused(group) - before + BUTTONS) % BUTTONS;
+}
+
+int main()
+{
+    lv_init();
+    create_display();
+    lv_group_t *group = create_buttons();
+
+    // 一整条(0~255)8档，每滑过32个位置一步；Key9 作为编码器按钮
+    static const vk_encoder_accel_t curve[] = {{2000, 2}};
+    VK3809IPLvgl adapter;
+    adapter.configureEncoder(0, 255, 8, 8);
+    CHECK(adapter.setAcceleration(curve, 1));
+    CHECK(adapter.begin(group));
+    lv_group_focus_obj(buttons[0]);
+    CHECK(focused(group) == 0);
+
+    // 慢速滑动: 32位置/20ms 约 1600 counts/s，不加速
+    CHECK(swipe(adapter, group, 3, 32, FRAME_MS) == 3);
+    // 快速滑动: 同样的位移 2ms 一帧，速度由时间戳得到，超过 2000 counts/s 后每档两步
+    int before = focused(group);
+    CHECK(swipe(adapter, group, 3, 32, 2) == 6);
+
+    // Key8(LV_KEY_NEXT) 切换焦点，Key5(LV_KEY_ENTER) 点击当前按钮
+    int target = (before + 6 + 1) % BUTTONS;
+    step(adapter, 0, 0, 1 << 7);
+    step(adapter, 0, 0, 0);
+    CHECK(focused(group) == target);
+    step(adapter, 0, 0, 1 << 4);
+    step(adapter, 0, 0, 0);
+    CHECK(clicks[target] == 1);
+
+    // 编码器按钮
+    step(adapter, 0, 0, 1 << 8);
+    step(adapter, 0, 0, 0);
+    CHECK(clicks[target] == 2);
+    CHECK(adapter.getDropCount() == 0);
+
+    if (failures != 0)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file vk_size_report.py
+@author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+@brief 从链接 map 统计 VK3809IP_Library 各模块的 flash/RAM 占用
+@version 0.1
+@date 2024-07-24
+
+@copyright Copyright (c) 2024
+
+用法:
+  当前配置:   idf.py vk3809ip-size
+              或 vk_size_report.py --map build/VK3809IP.map
+  配置组合:   vk_size_report.py --matrix [--project .] [--json size.json] [--baseline <git版本>]
+              依次编译 minimal(全部功能与模块关闭)、每个功能或模块单独打开、full(全部打开)，
+              输出每个功能或模块相对 minimal 的整个固件 flash/RAM 增量。
+              --baseline 用 minimal 配置下 vk3809ip.cpp 的编译命令编译该版本的驱动源码，
+              比较两个对象文件的大小，minimal 的驱动核心更大时返回1，可用于CI。
+"""
+import argparse
+import io
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tarfile
+import tempfile
+
+LIB = 'libVK3809IP_Library.a'
+CORE_FEATURES = ['RECOVERY', 'PROFILE', 'LAYOUT', 'KEYMASK']
+FEATURES = CORE_FEATURES + ['LOG', 'BROKER', 'RING', 'ENCODER', 'TRACKPAD', 'RAW', 'ANALYSIS', 'DEBOUNCE',
+            'TELEMETRY', 'PIPELINE', 'PREDICT', 'CORO', 'LVGL', 'BUSPROBE', 'OWNER', 'ENERGY']
+
+RE_OUT = re.compile(r'^(\.\S+)')
+RE_IN = re.compile(r'^ (\.\S+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$')
+RE_CONT = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+RE_LIB_OBJ = re.compile(re.escape(LIB) + r'\((.+?)\.(?:cpp|c)\.obj\)')
+
+
+def section_kind(name):
+    """输出段计入 flash、RAM 还是两者; 调试信息等不加载的段返回 None"""
+    if 'bss' in name or 'noinit' in name:
+        return (False, True)
+    if name.startswith('.flash.'):
+        return (True, False)
+    if name.startswith(('.iram', '.dram', '.rtc')):
+        return (True, True)     # 从 flash 加载到 RAM 运行
+    return None
+
+
+def parse_map(path):
+    """
+    返回 (模块占用, 整个固件占用):
+    模块占用为 {对象名: [flash, ram]}，只统计 libVK3809IP_Library.a 中的对象
+    """
+    objects = {}
+    total = [0, 0]
+    kind = None
+    pending = None
+    started = False
+    with open(path, 'r', errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if not started:
+                started = line.startswith('Linker script and memory map')
+                continue
+            m = RE_OUT.match(line)
+            if m:
+                kind = section_kind(m.group(1))
+                pending = None
+                continue
+            if kind is None:
+                continue
+            m = RE_IN.match(line)
+            if m:
+                if m.group(2) is None:
+                    pending = m.group(1)    # 段名太长，地址与大小在下一行
+                    continue
+                addr, size, obj = int(m.group(2), 16), int(m.group(3), 16), m.group(4)
+            elif pending is not None:
+                m = RE_CONT.match(line)
+                pending = None
+                if not m:
+                    continue
+                addr, size, obj = int(m.group(1), 16), int(m.group(2), 16), m.group(3)
+            else:
+                continue
+            if size == 0 or addr == 0:
+                continue    # 地址为0的段没有加载
+            if kind[0]:
+                total[0] += size
+            if kind[1]:
+                total[1] += size
+            lib = RE_LIB_OBJ.search(obj)
+            if lib:
+                sizes = objects.setdefault(lib.group(1), [0, 0])
+                if kind[0]:
+                    sizes[0] += size
+                if kind[1]:
+                    sizes[1] += size
+    return objects, total
+
+
+def print_objects(objects):
+    print('%-24s %8s %8s' % ('object', 'flash', 'ram'))
+    flash = ram = 0
+    for name in sorted(objects):
+        print('%-24s %8d %8d' % (name, objects[name][0], objects[name][1]))
+        flash += objects[name][0]
+        ram += objects[name][1]
+    print('%-24s %8d %8d' % (LIB, flash, ram))
+    return flash, ram
+
+
+def find_map(build_dir):
+    for name in os.listdir(build_dir):
+        if name.endswith('.map'):
+            return os.path.join(build_dir, name)
+    raise FileNotFoundError('no .map file in ' + build_dir)
+
+
+def build_config(project, root, name, enabled):
+    """在独立的编译目录中按 项目sdkconfig + 模块开关 编译，不改动项目自己的 sdkconfig"""
+    build_dir = os.path.join(root, name)
+    os.makedirs(build_dir, exist_ok=True)
+    fragment = os.path.join(build_dir, 'sdkconfig.vk3809ip')
+    with open(fragment, 'w') as f:
+        for feature in FEATURES:
+            if feature in enabled:
+                f.write('CONFIG_VK3809IP_%s=y\n' % feature)
+            else:
+                f.write('# CONFIG_VK3809IP_%s is not set\n' % feature)
+    sdkconfig = os.path.join(build_dir, 'sdkconfig')
+    if os.path.exists(sdkconfig):
+        os.remove(sdkconfig)    # 让 SDKCONFIG_DEFAULTS 重新生效
+    defaults = [os.path.join(project, 'sdkconfig'), fragment]
+    cmd = ['idf.py', '-C', project, '-B', build_dir,
+           '-D', 'SDKCONFIG=' + sdkconfig,
+           '-D', 'SDKCONFIG_DEFAULTS=' + ';'.join(p for p in defaults if os.path.exists(p)),
+           'build']
+    print('== %s: %s' % (name, ' '.join(enabled) or '(core only)'), flush=True)
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+    return parse_map(find_map(build_dir))
+
+
+def object_size(size_tool, obj):
+    """返回对象文件的 (text, data, bss)"""
+    out = subprocess.run([size_tool, obj], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    text, data, bss = out.splitlines()[1].split()[:3]
+    return int(text), int(data), int(bss)
+
+
+def compare_baseline(build_dir, rev):
+    """
+    按 minimal 编译目录中 vk3809ip.cpp 的编译命令编译 rev 版本的驱动源码，
+    返回 (minimal 驱动对象大小, rev 驱动对象大小)，编译器与选项完全相同
+    """
+    with open(os.path.join(build_dir, 'compile_commands.json')) as f:
+        entries = json.load(f)
+    entry = next(e for e in entries if e['file'].replace('\\', '/').endswith('/src/vk3809ip.cpp'))
+    args = entry['arguments'] if 'arguments' in entry else shlex.split(entry['command'])
+    src_dir = os.path.dirname(entry['file'])
+    obj = entry.get('output') or args[args.index('-o') + 1]
+    obj = os.path.join(entry['directory'], obj)
+
+    top = subprocess.run(['git', '-C', src_dir, 'rev-parse', '--show-toplevel'], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout.strip()
+    rel = os.path.relpath(src_dir, top).replace('\\', '/')
+    archive = subprocess.run(['git', '-C', top, 'archive', rev, rel], check=True, stdout=subprocess.PIPE).stdout
+
+    size_tool = re.sub(r'(g\+\+|c\+\+|gcc|cc)$', 'size', args[0])
+    with tempfile.TemporaryDirectory() as tmp:
+        with tarfile.open(fileobj=io.BytesIO(archive)) as tar:
+            tar.extractall(tmp)
+        old_dir = os.path.join(tmp, rel)
+        old_obj = os.path.join(tmp, 'vk3809ip_baseline.o')
+        cmd = []
+        skip = False
+        for arg in args:
+            if skip:
+                cmd.append(old_obj)
+                skip = False
+            elif arg == '-o':
+                cmd.append(arg)
+                skip = True
+            elif arg == entry['file'] or arg.endswith('/src/vk3809ip.cpp'):
+                cmd.append(os.path.join(old_dir, 'vk3809ip.cpp'))
+            elif arg == '-I' + src_dir:
+                cmd.append('-I' + old_dir)
+            else:
+                cmd.append(arg)
+        subprocess.run(cmd, check=True, cwd=entry['directory'])
+        return object_size(size_tool, obj), object_size(size_tool, old_obj)
+
+
+def run_matrix(args):
+    project = os.path.abspath(args.project)
+    root = os.path.abspath(args.build_root or os.path.join(project, 'build_size'))
+    configs = [('minimal', [])] + [(f.lower(), [f]) for f in FEATURES] + [('full', FEATURES)]
+    results = {}
+    for name, enabled in configs:
+        objects, total = build_config(project, root, name, enabled)
+        results[name] = {'objects': objects, 'total': total}
+
+    base = results['minimal']['total']
+    print('\n%-10s %10s %10s %10s %10s' % ('config', 'flash', 'ram', 'd_flash', 'd_ram'))
+    for name, _ in configs:
+        total = results[name]['total']
+        print('%-10s %10d %10d %+10d %+10d' % (name, total[0], total[1], total[0] - base[0], total[1] - base[1]))
+    print('\nminimal (%s):' % LIB)
+    print_objects(results['minimal']['objects'])
+    print('\nfull (%s):' % LIB)
+    print_objects(results['full']['objects'])
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+    if args.baseline:
+        new, old = compare_baseline(os.path.join(root, 'minimal'), args.baseline)
+        print('\n%-24s %8s %8s %8s' % ('vk3809ip.cpp.obj', 'text', 'data', 'bss'))
+        print('%-24s %8d %8d %8d' % (args.baseline, old[0], old[1], old[2]))
+        print('%-24s %8d %8d %8d' % ('minimal', new[0], new[1], new[2]))
+        flash = (new[0] + new[1]) - (old[0] + old[1])
+        ram = (new[1] + new[2]) - (old[1] + old[2])
+        print('minimal vs %s: flash %+d, ram %+d' % (args.baseline, flash, ram))
+        if flash > 0 or ram > 0:
+            return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='VK3809IP_Library flash/RAM footprint report')
+    parser.add_argument('--map', help='统计已有的链接 map 文件')
+    parser.add_argument('--matrix', action='store_true', help='编译所有模块组合并比较')
+    parser.add_argument('--project', default='.', help='项目目录')
+    parser.add_argument('--build-root', help='组合编译目录，默认 <project>/build_size')
+    parser.add_argument('--json', help='保存组合结果')
+    parser.add_argument('--baseline', metavar='REV', help='与该 git 版本的驱动对象比较 minimal 配置的驱动核心')
+    args = parser.parse_args()
+
+    if args.matrix:
+        return run_matrix(args)
+    if not args.map:
+        parser.error('需要 --map 或 --matrix')
+    objects, total = parse_map(args.map)
+    print_objects(objects)
+    print('%-24s %8d %8d' % ('image', total[0], total[1]))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
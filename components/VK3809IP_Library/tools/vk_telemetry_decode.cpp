@@ -0,0 +1,96 @@
+/**
+ * @file vk_telemetry_decode.cpp
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief Linux host decoder/plotter for the vk3809ip binary telemetry stream
+ * @version 0.1
+ * @date 2024-07-24
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ * 编译: g++ -O2 -I../src vk_telemetry_decode.cpp ../src/vk3809ip_telemetry.cpp ../src/vk3809ip_broker.cpp ../src/vk3809ip.cpp ../src/vk3809ip_log.cpp -o vk_telemetry_decode
+ * 用法: vk_telemetry_decode [文件|-] [--plot]
+ *       串口可以先 stty -F /dev/ttyUSB0 921600 raw，再把 /dev/ttyUSB0 作为文件输入
+ */
+#include <cstdio>
+#include <cstring>
+#include "vk3809ip_telemetry.hpp"
+
+static bool plot = false;
+
+static void print_bar(uint8_t value, uint8_t touched)
+{
+    char bar[65];
+    int n = touched ? (value * 64 + 127) / 255 : 0;
+    memset(bar, touched ? '#' : '.', n);
+    memset(bar + n, ' ', 64 - n);
+    bar[64] = '\0';
+    printf("|%s| %3u", bar, value);
+}
+
+static void on_record(const vk_telemetry_record_t *r, void *arg)
+{
+    (void)arg;
+    switch (r->type)
+    {
+    case VK_TELEMETRY_KEYFRAME:
+    case VK_TELEMETRY_FRAME:
+        if (plot)
+        {
+            printf("%10u ", r->timestamp);
+            print_bar(r->frame[SLIDE_1_POSITION], r->frame[0] & 0x01);
+            printf(" keys=%03x\n", r->frame[1] | ((r->frame[2] & 0x01) << 8));
+        }
+        else
+        {
+            printf("frame,%u,%02x,%02x,%02x,%u,%u,%u\n", r->timestamp,
+                   r->frame[0], r->frame[1], r->frame[2], r->frame[3], r->frame[4], r->frame[5]);
+        }
+        break;
+    case VK_TELEMETRY_EVENT:
+        printf("event,%u,%02x,%x,%x,%x,%03x,%03x\n", r->timestamp, r->events,
+               r->slider_touched, r->slider_moved, r->slider_released, r->keys_pressed, r->keys_released);
+        break;
+    case VK_TELEMETRY_STATS:
+        printf("stats,%u,%u,%u,%u\n", r->timestamp, r->reset_count, r->bus_errors, r->dropped);
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "-";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--plot") == 0)
+            plot = true;
+        else
+            path = argv[i];
+    }
+
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (in == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    VK3809IPTelemetryDecoder decoder(on_record);
+    uint8_t buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        decoder.feed(buf, (uint32_t)n);
+        fflush(stdout);
+    }
+    if (decoder.getErrorCount())
+    {
+        fprintf(stderr, "%u corrupted records skipped\n", decoder.getErrorCount());
+    }
+    if (decoder.getLostCount())
+    {
+        fprintf(stderr, "%u sequence gaps, resynced at next keyframe\n", decoder.getLostCount());
+    }
+    if (in != stdin)
+        fclose(in);
+    return 0;
+}
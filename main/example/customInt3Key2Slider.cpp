@@ -11,24 +11,153 @@
  */
 //! Warnings: In hardware design, the slider must be independent and form a closed loop at both ends to obtain the correct values.
 
+#include "sdkconfig.h"
 #include "vk3809ip.hpp"
+#include "vk3809ip_log.hpp"
+#if CONFIG_VK3809IP_PIPELINE
+#include "vk3809ip_pipeline.hpp"
+#endif
+#if CONFIG_VK3809IP_BUSPROBE
+#include "vk3809ip_busprobe.hpp"
+#endif
+#if CONFIG_VK3809IP_OWNER
+#include "vk3809ip_owner.hpp"
+#endif
+
+// 本例程用 getTouchState() 一次读取两组滑条与三个按键，并注册重置回调
+#if !VK3809IP_LAYOUT || !VK3809IP_RECOVERY
+#error "customInt3Key2Slider needs VK3809IP_LAYOUT and VK3809IP_RECOVERY enabled in menuconfig"
+#endif
+
+#define SLIDER_PIPELINE_MODE 0  // 1: 读取任务与处理任务分别绑定在两个内核上运行(需要打开 VK3809IP_PIPELINE)
+#define SLIDER_BUS_AUTOSPEED 0  // 1: 上电自检选择总线频率，热启动使用缓存结果(需要打开 VK3809IP_BUSPROBE)
+#define SLIDER_OWNER_MODE 0     // 1: 所有者任务独占芯片，其它任务通过命令队列修改配置(需要打开 VK3809IP_OWNER)
+
+// menuconfig 中没有打开对应模块时回退到直接读取，避免链接时找不到模块函数
+#if SLIDER_PIPELINE_MODE && !CONFIG_VK3809IP_PIPELINE
+#warning "VK3809IP_PIPELINE is disabled in menuconfig, SLIDER_PIPELINE_MODE ignored"
+#undef SLIDER_PIPELINE_MODE
+#define SLIDER_PIPELINE_MODE 0
+#endif
+#if SLIDER_BUS_AUTOSPEED && !CONFIG_VK3809IP_BUSPROBE
+#warning "VK3809IP_BUSPROBE is disabled in menuconfig, SLIDER_BUS_AUTOSPEED ignored"
+#undef SLIDER_BUS_AUTOSPEED
+#define SLIDER_BUS_AUTOSPEED 0
+#endif
+#if SLIDER_OWNER_MODE && !CONFIG_VK3809IP_OWNER
+#warning "VK3809IP_OWNER is disabled in menuconfig, SLIDER_OWNER_MODE ignored"
+#undef SLIDER_OWNER_MODE
+#define SLIDER_OWNER_MODE 0
+#endif
+
+// 日志模块打开且等级足够时走延迟格式化，否则用 ESP_LOGx 直接输出
+#if CONFIG_VK3809IP_LOG && VK3809IP_LOG_LEVEL >= VK_LOG_INFO
+#define SLIDER_LOGI(fmt, ...) VK_LOGI(fmt "\n", ##__VA_ARGS__)
+#else
+#define SLIDER_LOGI(fmt, ...) ESP_LOGI(TAG, fmt, ##__VA_ARGS__)
+#endif
+#if CONFIG_VK3809IP_LOG && VK3809IP_LOG_LEVEL >= VK_LOG_WARN
+#define SLIDER_LOGW(fmt, ...) VK_LOGW(fmt "\n", ##__VA_ARGS__)
+#else
+#define SLIDER_LOGW(fmt, ...) ESP_LOGW(TAG, fmt, ##__VA_ARGS__)
+#endif
 
 extern "C"
 {
     #include "i2c_port.h"
+    #include "esp_timer.h"
+    #include "esp_attr.h"
+    #include "esp_system.h"
 }
 
 static const char *TAG = "main";
 
 static void slider_hander_task(void *);
+static void slider_process(const vk_touch_state_t &state);
+#if SLIDER_PIPELINE_MODE
+static VK3809IPPipeline pipeline;
+static bool slider_wait_irq(void *arg);
+static void slider_process_msg(const vk_pipeline_msg_t *msg, void *arg);
+#elif SLIDER_OWNER_MODE
+static VK3809IPOwner owner;
+static void slider_owner_process_task(void *);
+static void slider_frame_ready(void *arg);
+#endif
 static QueueHandle_t  gpio_evt_queue = NULL;
 
 static void custum_slider_setting();
 
+static uint32_t slider_time_us()
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+static void slider_reset_handler(uint32_t reset_count, void *arg)
+{
+    SLIDER_LOGW("vk3809ip reset detected (%u), config re-applied", reset_count);
+}
+
+#if CONFIG_VK3809IP_LOG
+static void log_output(uint8_t level, const char *line, void *arg)
+{
+    fputs(line, stdout);
+}
+
+// 低优先级任务中格式化输出日志，触摸任务只记录格式字符串与参数
+static void log_flush_task(void *args)
+{
+    for(;;)
+    {
+        vk_log_flush(log_output, NULL);
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+}
+#endif
+
+#if SLIDER_BUS_AUTOSPEED
+static RTC_NOINIT_ATTR vk_busprobe_cache_t bus_speed_cache;    // 软件复位后保留，上电时由校验判断无效
+
+static bool slider_set_bus_speed(uint32_t hz, void *arg)
+{
+    return i2c_master_set_speed(hz) == ESP_OK;
+}
+
+// 在各候选频率下读取状态帧，选出满足错误预算的最快频率；软件复位等热启动直接使用缓存结果
+static uint32_t slider_select_bus_speed()
+{
+    VK3809IPBusProbe probe;
+    if (esp_reset_reason() != ESP_RST_POWERON && probe.restore(bus_speed_cache))
+    {
+        i2c_master_set_speed(probe.getSelectedSpeed());
+        return probe.getSelectedSpeed();
+    }
+    VKCallbackTransport bus;
+    bus.read_timeout_cb = twi_read_timeout;
+    probe.setTimeSource(slider_time_us);
+    uint32_t hz = probe.run(bus, slider_set_bus_speed);
+    for (uint8_t i = 0; i < probe.getResultCount(); i++)
+    {
+        const vk_busprobe_result_t *r = probe.getResult(i);
+        ESP_LOGI(TAG, "bus %u Hz: %u reads, %u bus errors, %u data errors, rtt avg %u max %u us",
+                 (unsigned)r->hz, r->samples, r->bus_errors, r->data_errors, (unsigned)r->rtt_avg_us, (unsigned)r->rtt_max_us);
+    }
+    if (!probe.isPassed())
+    {
+        ESP_LOGW(TAG, "bus self-test failed at every speed, check pull-ups");
+    }
+    probe.store(&bus_speed_cache);
+    return hz;
+}
+#endif
+
 static void IRAM_ATTR slider_irq_handler(void *arg)
 {
+#if SLIDER_OWNER_MODE && !SLIDER_PIPELINE_MODE
+    owner.notifyFrameFromISR();
+#else
     uint32_t gpio_num = (uint32_t) arg;
     xQueueSendFromISR(gpio_evt_queue, &gpio_num, NULL);
+#endif
 }
 
 static void irq_init()
@@ -97,9 +226,14 @@ extern "C" void app_main(void)
     // Register slider interrupt pins
     irq_init();
 
+#if CONFIG_VK3809IP_LOG
+    vk_log_set_time_source(slider_time_us);
+    xTaskCreate(log_flush_task, "vk_log", 3 * 1024, NULL, 1, NULL);
+#endif
+
     ESP_ERROR_CHECK(i2c_master_init()); //初始化I2C
 
-    if (slider.begin(twi_read, twi_write, VK3809IP_ADDR)) // 初始化芯片
+    if (slider.begin(twi_read_timeout, twi_write_timeout, VK3809IP_ADDR, I2C_MASTER_FREQ_HZ)) // 初始化芯片
     {
         ESP_LOGE(TAG, "Error init vk3809ip !!!");
         for(;;)
@@ -113,14 +247,33 @@ extern "C" void app_main(void)
     {
         for(;;)
         {
-            ESP_LOGE(TAG, "Waitting for config vk3809ip !!!");
+            SLIDER_LOGI("Waitting for config vk3809ip !!!");
             vTaskDelay(pdMS_TO_TICKS(50));
             if ((slider.getSystemCorrectionFlagState() == 1 && slider.getSystemWriteFlagState() != 1) == 1){break;}
         }
     }
     ESP_LOGI(TAG, "Success write setting vk3809ip !!!");
 
+#if SLIDER_BUS_AUTOSPEED
+    // 校正完成后芯片状态稳定，自检期间不要触摸
+    slider.setBusHz(slider_select_bus_speed());
+    ESP_LOGI(TAG, "I2C bus speed %u Hz", (unsigned)slider.getBusHz());
+#endif
+
+    slider.setTimeSource(slider_time_us);                   // 用于统计重置恢复时间
+    slider.setResetCallback(slider_reset_handler);          // 芯片意外重置后自动恢复配置
+
+#if SLIDER_PIPELINE_MODE
+    vk_pipeline_config_t config = VK3809IPPipeline::defaultConfig();   // 读取任务在内核1，处理任务在内核0
+    pipeline.start(slider, slider_wait_irq, slider_process_msg, NULL, config);
+#elif SLIDER_OWNER_MODE
+    QueueHandle_t frame_queue = xQueueCreate(16, sizeof(vk_touch_state_t));
+    xTaskCreate(slider_owner_process_task, "App/pwr", 4 * 1024, frame_queue, 9, NULL);
+    owner.setFrameCallback(slider_frame_ready, frame_queue);
+    owner.start(slider);    // 之后不再直接访问 slider，配置改用 owner.setThreshold() 等接口
+#else
     xTaskCreate(slider_hander_task, "App/pwr", 4 * 1024, NULL, 10, NULL);
+#endif
 }
 
 static void slider_hander_task(void *args)
@@ -130,42 +283,82 @@ static void slider_hander_task(void *args)
     {
         if (xQueueReceive(gpio_evt_queue, &io_num, portMAX_DELAY)) 
         {
-            // 两组滑条
-            if (slider.getSliderPressedState(SLIDE_1_TOUCH_STATE))
-            {
-                static uint8_t afterValue = 0;
-                uint8_t beforeValue = slider.getSliderData(SLIDE_1_POSITION);
-                if (afterValue != beforeValue)
-                {
-                    afterValue = beforeValue;
-                    printf("Slider1 position(0-170): %.3d\n", afterValue);
-                    // printf("Slider1 position(0-255):: %.3d\n", scaleTo255(afterValue));
-                }
-            }
-            else if (slider.getSliderPressedState(SLIDE_2_TOUCH_STATE))
+            vk_touch_state_t state;
+            if (!slider.getTouchState(&state))                      // 一次读取得到两组滑条与三个按键
             {
-                static uint8_t afterValue = 0;
-                uint8_t beforeValue = slider.getSliderData(SLIDE_2_POSITION);
-                if (afterValue != beforeValue)
-                {
-                    afterValue = beforeValue;
-                    printf("Slider2 position(0-170): %.3d\n", afterValue);
-                    // printf("Slider2 position(0-255):: %.3d\n", scaleTo255(afterValue));
-                }
-            }
-            // 三个独立按键
-            if (slider.getKeyPressedState(KEY_NUM_1))
-            {
-                printf("Key1 pressed\n");
-            }
-            else if (slider.getKeyPressedState(KEY_NUM_2))
-            {
-                printf("Key2 pressed\n");
-            }
-            else if (slider.getKeyPressedState(KEY_NUM_3))
-            {
-                printf("Key3 pressed\n");
+                continue;
             }
+            slider_process(state);
+        }
+    }
+}
+
+// 滤波、手势与输出，两种模式共用
+static void slider_process(const vk_touch_state_t &state)
+{
+    static uint8_t lastPosition[2] = {0};
+    static uint16_t lastKeys = 0;
+    // 两组滑条
+    for (int i = 0; i < 2; i++)
+    {
+        if ((state.slider_touch & (1 << i)) && lastPosition[i] != state.slider_position[i])
+        {
+            lastPosition[i] = state.slider_position[i];
+            SLIDER_LOGI("Slider%d position(0-170): %.3d", i + 1, lastPosition[i]);
+            // printf("Slider%d position(0-255):: %.3d\n", i + 1, scaleTo255(lastPosition[i]));
+        }
+    }
+    // 三个独立按键，只在按下的那一帧输出。流水模式下芯片只归读取任务访问，这里用帧内的按键掩码比较
+    uint16_t pressed = state.key_mask & ~lastKeys;
+    lastKeys = state.key_mask;
+    int key;
+    while ((key = vk_mask_next(&pressed)) >= 0)
+    {
+        SLIDER_LOGI("Key%d pressed", key + 1);                             // 输出按键状态
+    }
+}
+
+#if SLIDER_PIPELINE_MODE
+// 读取任务：等待 INT，超时返回以便 stop() 结束任务
+static bool slider_wait_irq(void *arg)
+{
+    uint32_t io_num;
+    return xQueueReceive(gpio_evt_queue, &io_num, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+// 处理任务：另一个内核上处理读取任务交过来的帧
+static void slider_process_msg(const vk_pipeline_msg_t *msg, void *arg)
+{
+    if (msg->valid)
+    {
+        slider_process(msg->state);
+    }
+}
+#endif
+
+#if SLIDER_OWNER_MODE && !SLIDER_PIPELINE_MODE
+// 所有者任务发布新快照后在该任务中调用，此时最近的快照就是刚发布的这一帧。
+// 逐帧放入队列而不是只唤醒处理任务，按下与松开落在相邻两帧时处理任务也能看到两个边沿
+static void slider_frame_ready(void *arg)
+{
+    vk_touch_state_t state;
+    if (owner.getTouchState(&state))
+    {
+        xQueueSend((QueueHandle_t)arg, &state, 0);  // 处理任务跟不上时丢弃，不阻塞所有者任务
+    }
+}
+
+// 处理任务：逐帧处理所有者任务交过来的状态，不访问总线
+static void slider_owner_process_task(void *args)
+{
+    QueueHandle_t queue = (QueueHandle_t)args;
+    vk_touch_state_t state;
+    for(;;)
+    {
+        if (xQueueReceive(queue, &state, portMAX_DELAY) == pdTRUE)
+        {
+            slider_process(state);
         }
     }
 }
+#endif
@@ -90,7 +90,7 @@ extern "C" void app_main(void)
 
     ESP_ERROR_CHECK(i2c_master_init()); //初始化I2C
 
-    if (slider.begin(twi_read, twi_write, VK3809IP_ADDR)) // 初始化芯片
+    if (slider.begin(twi_read_timeout, twi_write_timeout, VK3809IP_ADDR, I2C_MASTER_FREQ_HZ)) // 初始化芯片
     {
         ESP_LOGE(TAG, "Error init vk3809ip !!!");
         for(;;)
@@ -0,0 +1,421 @@
+/**
+ * @file i2c_arbiter_check.c
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief Linux host check for the shared-bus arbiter in i2c_arbiter.c
+ * 信号量用 pthread 实现，esp_timer_get_time() 为模拟时钟，总线传输只记录顺序不访问硬件，
+ * 因此等待时间直方图是确定的；信号量超时仍按真实时间(1个tick为1ms)。
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * 编译(在工程根目录): gcc -O2 -Wall -Wextra -pthread -Imain/host_check/stub -Imain \
+ *      main/host_check/i2c_arbiter_check.c main/i2c_arbiter.c -o i2c_arbiter_check
+ * 用法: i2c_arbiter_check，全部通过时返回0，否则打印失败的检查并返回1
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "i2c_arbiter.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "driver/i2c.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#define QUEUE_SETTLE_US     20000       /*!< 等待另一个线程进入排队的真实时间 */
+
+/**************************************************************************/
+/*!
+    @brief pthread 信号量
+*/
+/**************************************************************************/
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+};
+
+static SemaphoreHandle_t host_semaphore_create(int count)
+{
+    SemaphoreHandle_t sem = calloc(1, sizeof(*sem));
+    if (sem == NULL) {
+        return NULL;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    sem->count = count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_semaphore_create(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_semaphore_create(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ticks / configTICK_RATE_HZ;
+    deadline.tv_nsec += (long)(ticks % configTICK_RATE_HZ) * (1000000000L / configTICK_RATE_HZ);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sem->lock);
+    int err = 0;
+    while (sem->count == 0 && err != ETIMEDOUT) {
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(&sem->cond, &sem->lock);
+        } else {
+            err = pthread_cond_timedwait(&sem->cond, &sem->lock, &deadline);
+        }
+    }
+    BaseType_t taken = sem->count > 0;
+    if (taken) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    BaseType_t given = sem->count == 0;
+    sem->count = 1;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+    return given ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->lock);
+    free(sem);
+}
+
+/**************************************************************************/
+/*!
+    @brief 模拟时钟与总线
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint8_t dev_addr;
+    bool read;
+    size_t len;
+    uint8_t first;                      /*!< 写入的第一个字节，用于确认分包的偏移 */
+} sim_xfer_t;
+
+static atomic_llong s_now;
+static pthread_mutex_t s_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_xfer_t s_trace[64];
+static int s_trace_num = 0;
+static esp_err_t s_xfer_ret = ESP_OK;
+static void (*s_xfer_hook)(int index) = NULL;   /*!< 每次传输时调用，用于在传输中途注入事件 */
+
+int64_t esp_timer_get_time(void)
+{
+    return atomic_load(&s_now);
+}
+
+static void sim_advance(int64_t us)
+{
+    atomic_fetch_add(&s_now, us);
+}
+
+static void sim_reset(void)
+{
+    pthread_mutex_lock(&s_trace_lock);
+    s_trace_num = 0;
+    pthread_mutex_unlock(&s_trace_lock);
+    s_xfer_ret = ESP_OK;
+    s_xfer_hook = NULL;
+}
+
+static esp_err_t sim_transfer(uint8_t dev_addr, bool read, const uint8_t *wr, size_t len)
+{
+    pthread_mutex_lock(&s_trace_lock);
+    int index = s_trace_num;
+    if (s_trace_num < (int)(sizeof(s_trace) / sizeof(s_trace[0]))) {
+        s_trace[s_trace_num++] = (sim_xfer_t){dev_addr, read, len, (wr != NULL && len > 0) ? wr[0] : 0};
+    }
+    pthread_mutex_unlock(&s_trace_lock);
+    if (s_xfer_hook != NULL) {
+        s_xfer_hook(index);
+    }
+    return s_xfer_ret;
+}
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t dev_addr, const uint8_t *wr, size_t wr_len,
+                                       uint8_t *rd, size_t rd_len, TickType_t ticks)
+{
+    (void)port;
+    (void)wr_len;
+    (void)rd;
+    (void)ticks;
+    return sim_transfer(dev_addr, true, wr, rd_len);
+}
+
+esp_err_t i2c_master_read_from_device(i2c_port_t port, uint8_t dev_addr, uint8_t *rd, size_t rd_len, TickType_t ticks)
+{
+    (void)port;
+    (void)rd;
+    (void)ticks;
+    return sim_transfer(dev_addr, true, NULL, rd_len);
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t dev_addr, const uint8_t *wr, size_t wr_len, TickType_t ticks)
+{
+    (void)port;
+    (void)ticks;
+    return sim_transfer(dev_addr, false, wr, wr_len);
+}
+
+/**************************************************************************/
+/*!
+    @brief 检查
+*/
+/**************************************************************************/
+
+#define TOUCH_ADDR      0x53
+#define EEPROM_ADDR     0x50
+#define SENSOR_ADDR     0x44
+
+static int s_touch = -1;
+static int s_eeprom = -1;
+static int s_sensor = -1;
+
+static esp_err_t s_touch_ret;
+static esp_err_t s_sensor_ret;
+static pthread_t s_touch_thread;
+static pthread_t s_sensor_thread;
+static int64_t s_injected_wait;
+
+static void *touch_read_task(void *arg)
+{
+    (void)arg;
+    uint8_t frame[6];
+    s_touch_ret = i2c_arbiter_transfer(s_touch, TOUCH_ADDR, NULL, 0, frame, sizeof(frame), 1000000);
+    return NULL;
+}
+
+static void *sensor_read_task(void *arg)
+{
+    (void)arg;
+    uint8_t reg = 0x00;
+    uint8_t value[2];
+    s_sensor_ret = i2c_arbiter_transfer(s_sensor, SENSOR_ADDR, &reg, 1, value, sizeof(value), 1000000);
+    return NULL;
+}
+
+// 第一个 EEPROM 包传输期间传感器与触摸读取先后进入排队，该包再占用 s_injected_wait 后结束
+static void requests_during_first_packet(int index)
+{
+    if (index != 0) {
+        return;
+    }
+    pthread_create(&s_sensor_thread, NULL, sensor_read_task, NULL);
+    usleep(QUEUE_SETTLE_US);
+    pthread_create(&s_touch_thread, NULL, touch_read_task, NULL);
+    usleep(QUEUE_SETTLE_US);
+    sim_advance(s_injected_wait);
+}
+
+// 分块写入时触摸读取只等待当前包，插在两个包之间，并且排在更早请求的普通优先级之前
+static void check_packet_boundary_preemption(void)
+{
+    i2c_arb_stats_t touch0, touch1, eeprom0, eeprom1;
+    uint8_t data[10];
+    for (int i = 0; i < 10; i++) {
+        data[i] = (uint8_t)i;
+    }
+    sim_reset();
+    i2c_arbiter_get_stats(s_touch, &touch0);
+    i2c_arbiter_get_stats(s_eeprom, &eeprom0);
+    s_injected_wait = 3000;
+    s_xfer_hook = requests_during_first_packet;
+
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, data, sizeof(data), 4, 1000000) == ESP_OK);
+    pthread_join(s_touch_thread, NULL);
+    pthread_join(s_sensor_thread, NULL);
+    CHECK(s_touch_ret == ESP_OK);
+    CHECK(s_sensor_ret == ESP_OK);
+
+    CHECK(s_trace_num == 5);
+    CHECK(s_trace[0].dev_addr == EEPROM_ADDR && s_trace[0].len == 4 && s_trace[0].first == 0);
+    CHECK(s_trace[1].dev_addr == TOUCH_ADDR && s_trace[1].read && s_trace[1].len == 6);
+    CHECK(s_trace[2].dev_addr == SENSOR_ADDR && s_trace[2].read);
+    CHECK(s_trace[3].dev_addr == EEPROM_ADDR && s_trace[3].len == 4 && s_trace[3].first == 4);
+    CHECK(s_trace[4].dev_addr == EEPROM_ADDR && s_trace[4].len == 2 && s_trace[4].first == 8);
+
+    i2c_arbiter_get_stats(s_touch, &touch1);
+    i2c_arbiter_get_stats(s_eeprom, &eeprom1);
+    CHECK(touch1.transfers - touch0.transfers == 1);
+    CHECK(touch1.wait_hist[8] - touch0.wait_hist[8] == 1);     // 3000us 在 [2048, 4096)
+    CHECK(touch1.max_wait_us == 3000);
+    CHECK(eeprom1.transfers - eeprom0.transfers == 3);          // 每包计一次
+}
+
+// 分包长度与偏移，以及参数错误
+static void check_write_packets_split(void)
+{
+    uint8_t data[9];
+    for (int i = 0; i < 9; i++) {
+        data[i] = (uint8_t)(0x10 + i);
+    }
+    sim_reset();
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, data, sizeof(data), 3, 1000000) == ESP_OK);
+    CHECK(s_trace_num == 3);
+    for (int i = 0; i < s_trace_num && i < 3; i++) {
+        CHECK(s_trace[i].len == 3 && s_trace[i].first == data[i * 3]);
+    }
+
+    sim_reset();
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, data, sizeof(data), 16, 1000000) == ESP_OK);
+    CHECK(s_trace_num == 1 && s_trace[0].len == 9);
+
+    sim_reset();
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, data, 0, 4, 1000000) == ESP_OK);
+    CHECK(s_trace_num == 0);
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, data, sizeof(data), 0, 1000000) == ESP_ERR_INVALID_ARG);
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, NULL, sizeof(data), 4, 1000000) == ESP_ERR_INVALID_ARG);
+
+    // 某一包传输失败时停止，之后的包不再写入
+    sim_reset();
+    s_xfer_ret = ESP_FAIL;
+    CHECK(i2c_arbiter_write_packets(s_eeprom, EEPROM_ADDR, data, sizeof(data), 3, 1000000) == ESP_FAIL);
+    CHECK(s_trace_num == 1);
+    s_xfer_ret = ESP_OK;
+}
+
+// 排队超时与传输超时都不能让总线保持占用
+static void check_timeout_releases_bus(void)
+{
+    i2c_arb_stats_t before, after;
+    sim_reset();
+    i2c_arbiter_get_stats(s_touch, &before);
+
+    CHECK(i2c_arbiter_acquire(s_eeprom, 0) == ESP_OK);
+    CHECK(i2c_arbiter_acquire(s_touch, 5000) == ESP_ERR_TIMEOUT);
+    i2c_arbiter_get_stats(s_touch, &after);
+    CHECK(after.timeouts - before.timeouts == 1);
+    CHECK(after.transfers == before.transfers);
+    i2c_arbiter_release(s_eeprom);
+
+    // 撤回的请求不会在释放时被交接，总线空闲，立即获得
+    CHECK(i2c_arbiter_acquire(s_touch, 0) == ESP_OK);
+    CHECK(i2c_arbiter_acquire(s_sensor, 0) == ESP_ERR_TIMEOUT);
+    i2c_arbiter_release(s_touch);
+    CHECK(i2c_arbiter_acquire(s_sensor, 0) == ESP_OK);
+    i2c_arbiter_release(s_sensor);
+
+    // 传输本身超时时也要释放总线
+    s_xfer_ret = ESP_ERR_TIMEOUT;
+    uint8_t frame[6];
+    CHECK(i2c_arbiter_transfer(s_touch, TOUCH_ADDR, NULL, 0, frame, sizeof(frame), 5000) == ESP_ERR_TIMEOUT);
+    s_xfer_ret = ESP_OK;
+    CHECK(i2c_arbiter_acquire(s_eeprom, 0) == ESP_OK);
+    i2c_arbiter_release(s_eeprom);
+
+    // 持有总线时重复申请被拒绝，不会覆盖排队状态
+    CHECK(i2c_arbiter_acquire(s_eeprom, 0) == ESP_OK);
+    CHECK(i2c_arbiter_acquire(s_eeprom, 0) == ESP_ERR_INVALID_STATE);
+    i2c_arbiter_release(s_eeprom);
+}
+
+static void *sensor_task(void *arg)
+{
+    (void)arg;
+    if (i2c_arbiter_acquire(s_sensor, 2000000) == ESP_OK) {
+        i2c_arbiter_release(s_sensor);
+    }
+    return NULL;
+}
+
+// 注入已知的等待时间，直方图落在对应的格中
+static void check_wait_histogram(void)
+{
+    static const struct {
+        uint32_t wait_us;
+        int bin;
+    } cases[] = {
+        {20, 1},            // [16, 32)
+        {100, 3},           // [64, 128)
+        {3000, 8},          // [2048, 4096)
+        {10000, 10},        // [8192, 16384)
+        {100000, I2C_ARB_HIST_BINS - 1},    // 最后一格不封顶
+    };
+    i2c_arb_stats_t before, after;
+    sim_reset();
+    i2c_arbiter_get_stats(s_sensor, &before);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        pthread_t thread;
+        CHECK(i2c_arbiter_acquire(s_eeprom, 0) == ESP_OK);
+        pthread_create(&thread, NULL, sensor_task, NULL);
+        usleep(QUEUE_SETTLE_US);
+        sim_advance(cases[i].wait_us);
+        i2c_arbiter_release(s_eeprom);
+        pthread_join(thread, NULL);
+    }
+
+    i2c_arbiter_get_stats(s_sensor, &after);
+    uint32_t expected[I2C_ARB_HIST_BINS] = {0};
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        expected[cases[i].bin]++;
+    }
+    for (int b = 0; b < I2C_ARB_HIST_BINS; b++) {
+        CHECK(after.wait_hist[b] - before.wait_hist[b] == expected[b]);
+    }
+    CHECK(after.transfers - before.transfers == sizeof(cases) / sizeof(cases[0]));
+    CHECK(after.max_wait_us == 100000);
+    CHECK(after.timeouts == before.timeouts);
+}
+
+int main(void)
+{
+    CHECK(i2c_arbiter_init() == ESP_OK);
+    s_touch = i2c_arbiter_register("vk3809ip", I2C_ARB_PRIO_TOUCH);
+    s_eeprom = i2c_arbiter_register("eeprom", I2C_ARB_PRIO_LOW);
+    s_sensor = i2c_arbiter_register("sensor", I2C_ARB_PRIO_NORMAL);
+    CHECK(s_touch >= 0 && s_eeprom >= 0 && s_sensor >= 0);
+
+    check_packet_boundary_preemption();
+    check_write_packets_split();
+    check_timeout_releases_bus();
+    check_wait_histogram();
+    if (failures != 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file i2c.h
+ * @brief 主机检查用的旧版 I2C 驱动接口子集，传输由检查程序模拟
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int i2c_port_t;
+typedef int i2c_ack_type_t;
+typedef int gpio_num_t;
+
+#define I2C_NUM_0           0
+#define I2C_MASTER_WRITE    0
+#define I2C_MASTER_READ     1
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t dev_addr, const uint8_t *wr, size_t wr_len,
+                                       uint8_t *rd, size_t rd_len, TickType_t ticks);
+esp_err_t i2c_master_read_from_device(i2c_port_t port, uint8_t dev_addr, uint8_t *rd, size_t rd_len, TickType_t ticks);
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t dev_addr, const uint8_t *wr, size_t wr_len, TickType_t ticks);
@@ -0,0 +1,14 @@
+/**
+ * @file esp_err.h
+ * @brief 主机检查用的 ESP-IDF 错误码子集
+ */
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_TIMEOUT         0x107
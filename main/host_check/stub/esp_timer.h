@@ -0,0 +1,9 @@
+/**
+ * @file esp_timer.h
+ * @brief 主机检查用的时间源，由检查程序实现(模拟时钟)
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,16 @@
+/**
+ * @file FreeRTOS.h
+ * @brief 主机检查用的 FreeRTOS 类型子集，1个tick为1ms
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  1
+#define portMAX_DELAY       0xffffffffu
+#define pdTRUE              1
+#define pdFALSE             0
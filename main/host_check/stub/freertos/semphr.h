@@ -0,0 +1,16 @@
+/**
+ * @file semphr.h
+ * @brief 主机检查用的信号量，由检查程序用 pthread 实现
+ * 互斥量按计数为1的信号量处理，没有优先级继承
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_semaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
@@ -0,0 +1,5 @@
+/**
+ * @file sdkconfig.h
+ * @brief 主机检查不使用 menuconfig 配置
+ */
+#pragma once
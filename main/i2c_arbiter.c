@@ -0,0 +1,302 @@
+/**
+ * @file i2c_arbiter.c
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief priority-aware arbiter for the shared I2C_MASTER_NUM bus
+ * 总线同时只有一个使用者。释放总线时交给优先级最高、等待最久的请求，而不是谁先调用
+ * i2c_master_cmd_begin 谁先传输；大块传输按包拆分，每包之间让出总线，触摸读取最多等待一个包。
+ * ! 一个包(例如 vk3809ip 的3~4字节配置包)是一次完整的起始到停止传输，包内不会被打断。
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "i2c_arbiter.h"
+#include "i2c_port.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+typedef struct {
+    i2c_arb_stats_t stats;
+    SemaphoreHandle_t grant;        /*!< 轮到该使用者时释放 */
+    bool waiting;
+    uint32_t order;                 /*!< 请求顺序，同优先级先到先得 */
+    int64_t request_time;
+} i2c_arb_client_t;
+
+static const char *TAG = "i2c_arb";
+
+static SemaphoreHandle_t s_lock = NULL;         /*!< 保护以下状态 */
+static i2c_arb_client_t s_clients[I2C_ARB_MAX_CLIENTS];
+static int s_client_num = 0;
+static int s_owner = -1;                        /*!< 当前占用总线的使用者，-1 为空闲 */
+static uint32_t s_order = 0;
+
+/**
+ * @brief 超时时间(us)转换为tick，与 i2c_port.c 一致向上取整后再加1个tick
+ */
+static TickType_t arb_ticks(uint32_t timeout_us)
+{
+    // 按 configTICK_RATE_HZ 计算，tick 短于1ms时 portTICK_PERIOD_MS 为0
+    return (TickType_t)(((uint64_t)timeout_us * configTICK_RATE_HZ + 999999) / 1000000 + 1);
+}
+
+static uint32_t arb_remaining_us(int64_t deadline)
+{
+    int64_t left = deadline - esp_timer_get_time();
+    return (left > 0) ? (uint32_t)left : 0;
+}
+
+static void arb_record_wait(i2c_arb_client_t *c, uint32_t wait_us)
+{
+    int bin = 0;
+    while (bin < I2C_ARB_HIST_BINS - 1 && wait_us >= (16u << bin)) {
+        bin++;
+    }
+    c->stats.wait_hist[bin]++;
+    c->stats.transfers++;
+    if (wait_us > c->stats.max_wait_us) {
+        c->stats.max_wait_us = wait_us;
+    }
+}
+
+/**
+ * @brief 选出下一个获得总线的请求：优先级最高，同优先级中请求最早
+ */
+static int arb_pick_next(void)
+{
+    int best = -1;
+    for (int i = 0; i < s_client_num; i++) {
+        i2c_arb_client_t *c = &s_clients[i];
+        if (!c->waiting) {
+            continue;
+        }
+        if (best < 0 || c->stats.prio < s_clients[best].stats.prio ||
+            (c->stats.prio == s_clients[best].stats.prio && (int32_t)(c->order - s_clients[best].order) < 0)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief 初始化仲裁器，在 i2c_master_init() 中调用
+ */
+esp_err_t i2c_arbiter_init(void)
+{
+    if (s_lock != NULL) {
+        return ESP_OK;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    return (s_lock != NULL) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief 注册一个总线使用者，每个使用者同一时刻只能有一个未完成的请求
+ *
+ * @param name 统计输出时显示的名称
+ * @param prio 优先级
+ * @return int 使用者编号，失败返回-1
+ */
+int i2c_arbiter_register(const char *name, i2c_arb_prio_t prio)
+{
+    if (s_lock == NULL) {
+        return -1;
+    }
+    SemaphoreHandle_t grant = xSemaphoreCreateBinary();
+    if (grant == NULL) {
+        return -1;
+    }
+    int id = -1;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_client_num < I2C_ARB_MAX_CLIENTS) {
+        id = s_client_num++;
+        i2c_arb_client_t *c = &s_clients[id];
+        memset(c, 0, sizeof(*c));
+        c->stats.name = name;
+        c->stats.prio = prio;
+        c->grant = grant;
+    }
+    xSemaphoreGive(s_lock);
+    if (id < 0) {
+        vSemaphoreDelete(grant);
+    }
+    return id;
+}
+
+/**
+ * @brief 申请总线:
+ * 总线空闲时立即获得；否则排队，由当前使用者释放时按优先级交接。
+ * 每个使用者只能有一个未完成的请求，多个任务共用同一个使用者编号时要由调用者串行
+ *
+ * @param client 使用者编号
+ * @param timeout_us 等待上限
+ * @return esp_err_t ESP_ERR_TIMEOUT 表示截止时间内没有轮到，
+ *                   ESP_ERR_INVALID_STATE 表示该使用者已经持有总线或正在排队
+ */
+esp_err_t i2c_arbiter_acquire(int client, uint32_t timeout_us)
+{
+    if (client < 0 || client >= s_client_num) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_arb_client_t *c = &s_clients[client];
+    int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (c->waiting || s_owner == client) {
+        // 覆盖 waiting/order 会让正在等待的任务永远收不到交接
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_owner < 0) {
+        s_owner = client;
+        arb_record_wait(c, 0);
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+    c->waiting = true;
+    c->order = s_order++;
+    c->request_time = now;
+    xSemaphoreGive(s_lock);
+
+    if (xSemaphoreTake(c->grant, arb_ticks(timeout_us)) == pdTRUE) {
+        return ESP_OK;
+    }
+    // 超时后撤回请求；撤回前刚好被交接时照常使用总线
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!c->waiting) {
+        xSemaphoreGive(s_lock);
+        xSemaphoreTake(c->grant, portMAX_DELAY);
+        return ESP_OK;
+    }
+    c->waiting = false;
+    c->stats.timeouts++;
+    xSemaphoreGive(s_lock);
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief 释放总线并交给下一个请求
+ *
+ * @param client 使用者编号
+ */
+void i2c_arbiter_release(int client)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_owner != client) {
+        xSemaphoreGive(s_lock);
+        return;
+    }
+    int next = arb_pick_next();
+    s_owner = next;
+    if (next >= 0) {
+        i2c_arb_client_t *n = &s_clients[next];
+        n->waiting = false;
+        arb_record_wait(n, (uint32_t)(esp_timer_get_time() - n->request_time));
+        xSemaphoreGive(n->grant);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/**
+ * @brief 一次不可拆分的传输：写、读或写后重复起始再读
+ *
+ * @param client 使用者编号
+ * @param dev_addr 7位设备地址
+ * @param wr 写入数据，可以为NULL
+ * @param wr_len
+ * @param rd 读取缓冲，可以为NULL
+ * @param rd_len
+ * @param timeout_us 包括排队与传输的总时间
+ * @return esp_err_t
+ */
+esp_err_t i2c_arbiter_transfer(int client, uint8_t dev_addr, const uint8_t *wr, size_t wr_len,
+                               uint8_t *rd, size_t rd_len, uint32_t timeout_us)
+{
+    int64_t deadline = esp_timer_get_time() + timeout_us;
+    esp_err_t ret = i2c_arbiter_acquire(client, timeout_us);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    TickType_t ticks = arb_ticks(arb_remaining_us(deadline));
+    if (wr_len > 0 && rd_len > 0) {
+        ret = i2c_master_write_read_device(I2C_MASTER_NUM, dev_addr, wr, wr_len, rd, rd_len, ticks);
+    } else if (rd_len > 0) {
+        ret = i2c_master_read_from_device(I2C_MASTER_NUM, dev_addr, rd, rd_len, ticks);
+    } else {
+        ret = i2c_master_write_to_device(I2C_MASTER_NUM, dev_addr, wr, wr_len, ticks);
+    }
+    i2c_arbiter_release(client);
+    return ret;
+}
+
+/**
+ * @brief 按包写入大块数据:
+ * data 由若干个完整的包顺序排列(例如 EEPROM 每页前带地址)，每包是一次独立传输，包之间让出总线。
+ * 需要写入周期的设备应在下一包前自行等待或轮询应答
+ *
+ * @param client 使用者编号
+ * @param dev_addr 7位设备地址
+ * @param data
+ * @param len 总长度
+ * @param packet_len 每包长度，最后一包可以不足
+ * @param timeout_us 整个写入的总时间
+ * @return esp_err_t
+ */
+esp_err_t i2c_arbiter_write_packets(int client, uint8_t dev_addr, const uint8_t *data, size_t len,
+                                    size_t packet_len, uint32_t timeout_us)
+{
+    if (data == NULL || packet_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t deadline = esp_timer_get_time() + timeout_us;
+    for (size_t offset = 0; offset < len; offset += packet_len) {
+        size_t n = (len - offset < packet_len) ? (len - offset) : packet_len;
+        uint32_t left = arb_remaining_us(deadline);
+        if (left == 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+        esp_err_t ret = i2c_arbiter_transfer(client, dev_addr, data + offset, n, NULL, 0, left);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_arbiter_get_stats(int client, i2c_arb_stats_t *stats)
+{
+    if (client < 0 || client >= s_client_num || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_clients[client].stats;
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief 输出每个使用者的等待时间直方图
+ */
+void i2c_arbiter_print_stats(void)
+{
+    for (int i = 0; i < s_client_num; i++) {
+        i2c_arb_stats_t st;
+        i2c_arbiter_get_stats(i, &st);
+        ESP_LOGI(TAG, "%s prio %d: %lu transfers, %lu timeouts, max wait %lu us",
+                 st.name, st.prio, (unsigned long)st.transfers, (unsigned long)st.timeouts, (unsigned long)st.max_wait_us);
+        for (int b = 0; b < I2C_ARB_HIST_BINS; b++) {
+            if (st.wait_hist[b] == 0) {
+                continue;
+            }
+            if (b < I2C_ARB_HIST_BINS - 1) {
+                ESP_LOGI(TAG, "  < %6u us: %lu", 16u << b, (unsigned long)st.wait_hist[b]);
+            } else {
+                ESP_LOGI(TAG, "  >=%6u us: %lu", 16u << (b - 1), (unsigned long)st.wait_hist[b]);
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file i2c_arbiter.h
+ * @author by mondraker (https://oshwhub.com/mondraker)(https://github.com/HwzLoveDz)
+ * @brief priority-aware arbiter for the shared I2C_MASTER_NUM bus
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define I2C_ARB_MAX_CLIENTS         8                                       /*!< Max devices sharing the bus */
+#define I2C_ARB_HIST_BINS           12                                      /*!< Wait histogram bins, bin n < 16us << n */
+
+/**
+ * @brief 总线使用者优先级，数值越小越先获得总线；同优先级按请求先后
+ */
+typedef enum {
+    I2C_ARB_PRIO_TOUCH = 0,         /*!< 触摸状态帧读取 */
+    I2C_ARB_PRIO_HIGH,
+    I2C_ARB_PRIO_NORMAL,
+    I2C_ARB_PRIO_LOW,               /*!< EEPROM 等大块传输 */
+} i2c_arb_prio_t;
+
+/**
+ * @brief 每个使用者的等待统计
+ */
+typedef struct {
+    const char *name;
+    i2c_arb_prio_t prio;
+    uint32_t transfers;             /*!< 获得总线的次数(分块传输每块计一次) */
+    uint32_t timeouts;              /*!< 在截止时间内没有获得总线的次数 */
+    uint32_t max_wait_us;
+    uint32_t wait_hist[I2C_ARB_HIST_BINS];  /*!< bin0 < 16us，之后每格翻倍，最后一格不封顶 */
+} i2c_arb_stats_t;
+
+esp_err_t i2c_arbiter_init(void);
+int i2c_arbiter_register(const char *name, i2c_arb_prio_t prio);
+
+esp_err_t i2c_arbiter_acquire(int client, uint32_t timeout_us);
+void i2c_arbiter_release(int client);
+
+esp_err_t i2c_arbiter_transfer(int client, uint8_t dev_addr, const uint8_t *wr, size_t wr_len,
+                               uint8_t *rd, size_t rd_len, uint32_t timeout_us);
+esp_err_t i2c_arbiter_write_packets(int client, uint8_t dev_addr, const uint8_t *data, size_t len,
+                                    size_t packet_len, uint32_t timeout_us);
+
+esp_err_t i2c_arbiter_get_stats(int client, i2c_arb_stats_t *stats);
+void i2c_arbiter_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
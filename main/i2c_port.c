@@ -9,6 +9,16 @@
  * 
  */
 #include "i2c_port.h"
+#include "i2c_arbiter.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+
+static int s_touch_client = -1;     /*!< vk3809ip 在总线仲裁器中的编号，状态帧读取优先 */
+static SemaphoreHandle_t s_touch_lock = NULL;   /*!< 仲裁器中每个使用者只能有一个请求，多个任务调用 twi_* 时先在这里排队 */
+static i2c_config_t *s_conf = NULL; /*!< i2c_master_init() 中的配置，切换总线频率时重新写入 */
+
+static esp_err_t i2c_touch_acquire(uint32_t timeout_us);
+static void i2c_touch_release(void);
 
 /**
  * @brief i2c master initialization
@@ -28,7 +38,99 @@ esp_err_t i2c_master_init(void)
     conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
     conf.master.clk_speed = I2C_MASTER_FREQ_HZ;
     i2c_param_config(i2c_master_port, &conf);
-    return i2c_driver_install(i2c_master_port, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 0);
+    s_conf = &conf;
+    esp_err_t ret = i2c_driver_install(i2c_master_port, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // 同一总线上的其它设备通过 i2c_arbiter_register() 注册后用 i2c_arbiter_transfer() 访问
+    ret = i2c_arbiter_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (s_touch_lock == NULL) {
+        s_touch_lock = xSemaphoreCreateMutex();
+        if (s_touch_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_touch_client = i2c_arbiter_register("vk3809ip", I2C_ARB_PRIO_TOUCH);
+    return (s_touch_client >= 0) ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief 切换总线频率，在总线仲裁器中以触摸客户端身份独占总线后重新写入配置
+ * 
+ * @param hz 新的SCL频率
+ * @return esp_err_t 
+ */
+esp_err_t i2c_master_set_speed(uint32_t hz)
+{
+    if (s_conf == NULL || hz == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = i2c_touch_acquire(I2C_MASTER_TIMEOUT_MS * 1000);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s_conf->master.clk_speed = hz;
+    ret = i2c_param_config(I2C_MASTER_NUM, s_conf);
+    i2c_touch_release();
+    return ret;
+}
+
+/**
+ * @brief 当前总线频率，未初始化时为 I2C_MASTER_FREQ_HZ
+ */
+uint32_t i2c_master_get_speed(void)
+{
+    return (s_conf != NULL) ? s_conf->master.clk_speed : I2C_MASTER_FREQ_HZ;
+}
+
+/**
+ * @brief 超时时间(us)转换为tick:
+ * 向上取整后再加1个tick，保证在tick边界附近调用时也至少等待完整的超时时间
+ */
+static TickType_t i2c_timeout_ticks(uint32_t timeout_us)
+{
+    // 按 configTICK_RATE_HZ 计算，tick 短于1ms时 portTICK_PERIOD_MS 为0
+    return (TickType_t)(((uint64_t)timeout_us * configTICK_RATE_HZ + 999999) / 1000000 + 1);
+}
+
+/**
+ * @brief 截止时间剩余的tick，已到期时仍保留1个tick用于完成当前命令
+ */
+static TickType_t i2c_remaining_ticks(TickType_t deadline)
+{
+    TickType_t now = xTaskGetTickCount();
+    return ((int32_t)(deadline - now) > 0) ? (deadline - now) : 1;
+}
+
+/**
+ * @brief 以触摸客户端身份申请总线:
+ * 先在 s_touch_lock 上排队，保证仲裁器中同一时刻只有一个触摸请求，排队与仲裁共用同一个截止时间
+ */
+static esp_err_t i2c_touch_acquire(uint32_t timeout_us)
+{
+    if (s_touch_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t deadline = esp_timer_get_time() + timeout_us;
+    if (xSemaphoreTake(s_touch_lock, i2c_timeout_ticks(timeout_us)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    int64_t remaining = deadline - esp_timer_get_time();
+    esp_err_t ret = i2c_arbiter_acquire(s_touch_client, (remaining > 0) ? (uint32_t)remaining : 0);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(s_touch_lock);
+    }
+    return ret;
+}
+
+static void i2c_touch_release(void)
+{
+    i2c_arbiter_release(s_touch_client);
+    xSemaphoreGive(s_touch_lock);
 }
 
 /**
@@ -36,6 +138,23 @@ esp_err_t i2c_master_init(void)
  * 
  */
 uint32_t twi_read(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len)   //! 类型错误：uint16_t
+{
+    return twi_read_timeout(dev_addr, reg_addr, data, len, I2C_MASTER_TIMEOUT_MS * 1000);
+}
+
+/**
+ * @brief apx library i2c write callback
+ */
+uint32_t twi_write(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len)  //! 类型错误：uint16_t
+{
+    return twi_write_timeout(dev_addr, reg_addr, data, len, I2C_MASTER_TIMEOUT_MS * 1000);
+}
+
+/**
+ * @brief vk3809ip library i2c read callback with deadline
+ * 寻址与读取两次传输共用同一个截止时间
+ */
+uint32_t twi_read_timeout(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
 {
     if (len == 0) {
         return ESP_OK;
@@ -43,7 +162,12 @@ uint32_t twi_read(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len
     if (data == NULL) {
         return ESP_FAIL;
     }
+    TickType_t deadline = xTaskGetTickCount() + i2c_timeout_ticks(timeout_us);
     i2c_cmd_handle_t cmd;
+    esp_err_t ret = i2c_touch_acquire(timeout_us);   // 寻址与读取之间不让出总线
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
     cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
@@ -52,10 +176,11 @@ uint32_t twi_read(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len
         i2c_master_write_byte(cmd, reg_addr, ACK_CHECK_EN); //Single Read and Write
     }
     i2c_master_stop(cmd);
-    esp_err_t ret =  i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 1000 / portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, i2c_remaining_ticks(deadline));
     i2c_cmd_link_delete(cmd);
     if (ret != ESP_OK) {
-        return ESP_FAIL;
+        i2c_touch_release();
+        return ret;
     }
     cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
@@ -65,19 +190,26 @@ uint32_t twi_read(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len
     }
     i2c_master_read_byte(cmd, &data[len - 1], NACK_VAL);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 1000 / portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, i2c_remaining_ticks(deadline));
     i2c_cmd_link_delete(cmd);
+    i2c_touch_release();
     return ret;
 }
 
 /**
- * @brief apx library i2c write callback
+ * @brief vk3809ip library i2c write callback with deadline
  */
-uint32_t twi_write(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len)  //! 类型错误：uint16_t
+uint32_t twi_write_timeout(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len, uint32_t timeout_us)
 {
     if (data == NULL) {
         return ESP_FAIL;
     }
+    TickType_t deadline = xTaskGetTickCount() + i2c_timeout_ticks(timeout_us);
+    // 配置包是一次完整的传输，获得总线后不会被其它设备打断
+    esp_err_t ret = i2c_touch_acquire(timeout_us);
+    if (ret != ESP_OK) {
+        return ret;
+    }
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (dev_addr << 1) | WRITE_BIT, ACK_CHECK_EN);
@@ -86,8 +218,8 @@ uint32_t twi_write(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t le
     }
     i2c_master_write(cmd, data, len, ACK_CHECK_EN);
     i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 1000 / portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, i2c_remaining_ticks(deadline));
     i2c_cmd_link_delete(cmd);
+    i2c_touch_release();
     return ret;
 }
-
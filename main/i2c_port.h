@@ -29,9 +29,10 @@ extern "C" {
 #define I2C_MASTER_SCL_IO           40//CONFIG_I2C_MASTER_SCL                   /*!< gpio number for I2C master clock */
 #define I2C_MASTER_SDA_IO           41//CONFIG_I2C_MASTER_SDA                   /*!< gpio number for I2C master data  */
 #define I2C_MASTER_NUM              I2C_NUM_0//I2C_NUMBER(I2C_NUM_0)            /*!< I2C port number for master dev */
-#define I2C_MASTER_FREQ_HZ          400*1000                                    /*!< I2C master clock frequency */
+#define I2C_MASTER_FREQ_HZ          400*1000                                    /*!< I2C master clock frequency, 自检选速时为初始频率 */
 #define I2C_MASTER_TX_BUF_DISABLE   0                                       /*!< I2C master doesn't need buffer */
 #define I2C_MASTER_RX_BUF_DISABLE   0                                       /*!< I2C master doesn't need buffer */
+#define I2C_MASTER_TIMEOUT_MS       1000                                    /*!< I2C timeout for callers without a deadline */
 
 #define WRITE_BIT                   I2C_MASTER_WRITE                        /*!< I2C master write 0 */
 #define READ_BIT                    I2C_MASTER_READ                         /*!< I2C master read 1 */
@@ -41,8 +42,12 @@ extern "C" {
 #define NACK_VAL                    (i2c_ack_type_t)0x1                     /*!< I2C nack value */
 
 esp_err_t i2c_master_init(void);
+esp_err_t i2c_master_set_speed(uint32_t hz);
+uint32_t i2c_master_get_speed(void);
 uint32_t twi_read(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len);   //! 类型错误：uint16_t
 uint32_t twi_write(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len);  //! 类型错误：uint16_t
+uint32_t twi_read_timeout(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len, uint32_t timeout_us);
+uint32_t twi_write_timeout(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint8_t len, uint32_t timeout_us);
 
 #ifdef __cplusplus
 }